@@ -1,6 +1,6 @@
 //forward declarations
+void evalFitAtData(const parameters *, const data *, const fit_results *, long double *);
 void generateSums(data *,const parameters *);
-void refitFilter2Par(const parameters *, const data *, fit_results *, plot_data *, long double);
 
 //evaluates the fit function at the specified point
 long double eval2Par(long double x,long double y, const fit_results * fr)
@@ -10,59 +10,26 @@ long double eval2Par(long double x,long double y, const fit_results * fr)
 	+ fr->a[4]*y + fr->a[5];
 }
 
-//determine uncertainty ellipse bounds for the vertex by intersection of fit function with plane defining values at min + delta
+//determine uncertainty ellipse bounds for the vertex from the region where the
+//fit function is within delta of its value at the vertex (see quad_ci.c)
 //delta is the desired confidence level (2.30 for 1-sigma in 2 parameters)
-//derived by: 
-//1) setting f(x,y)=delta+min
-//2) deriving x values as a function of y and vice versa via the quadratic formula
-//3) setting the expression under the sqrts obtained to 0 to define bounds for x,y
-//4) solving for upper and lower x,y bounds using the quadratic formula (calculated below)
 void fit2ParChisqConf(const parameters * p, fit_results * fr)
 {
-  
-  long double a,b,c;
-  long double delta=p->ciDelta;
-  long double minPtVal = eval2Par(fr->fitVert[0],fr->fitVert[1],fr);
-  fr->vertBoundsFound[0]=1;
-  
-  //find x bounds
-  a=4.*fr->a[1]*fr->a[0] - fr->a[2]*fr->a[2];
-  b=4.*fr->a[1]*fr->a[3] - 2.*fr->a[2]*fr->a[4];
-  c=4.*fr->a[1]*(fr->a[5] - delta - minPtVal) - fr->a[4]*fr->a[4];
-  if((b*b - 4*a*c)<0.) 
-    c=4.*fr->a[1]*(fr->a[5] + delta - minPtVal) - fr->a[4]*fr->a[4];//try flipping delta
-  if((b*b - 4*a*c)<0.)  
-    fr->vertBoundsFound[0]=0;
-  else
-    {
-      fr->vertUBound[0]=(-1.*b + (long double)sqrt((double)(b*b - 4.*a*c)))/(2.*a);
-      fr->vertLBound[0]=(-1.*b - (long double)sqrt((double)(b*b - 4.*a*c)))/(2.*a);
-    }
-  
-  //find y bounds
-  a=4.*fr->a[0]*fr->a[1] - fr->a[2]*fr->a[2];
-  b=4.*fr->a[0]*fr->a[4] - 2.*fr->a[2]*fr->a[3];
-  c=4.*fr->a[0]*(fr->a[5] - delta - minPtVal) - fr->a[3]*fr->a[3];
-  if((b*b - 4*a*c)<0.) 
-    c=4.*fr->a[0]*(fr->a[5] + delta - minPtVal) - fr->a[3]*fr->a[3];//try flipping delta
-  if((b*b - 4*a*c)<0.)  
-    fr->vertBoundsFound[0]=0;
-  else
-    {
-      fr->vertUBound[1]=(-1.*b + (long double)sqrt((double)(b*b - 4.*a*c)))/(2.*a);
-      fr->vertLBound[1]=(-1.*b - (long double)sqrt((double)(b*b - 4.*a*c)))/(2.*a);
-    }
-
-  //swap bound order if needed
-  int i;
-  for(i=0;i<2;i++)
-    if(fr->vertLBound[i]>fr->vertUBound[i])
-      {
-        a=fr->vertUBound[i];
-        fr->vertUBound[i]=fr->vertLBound[i];
-        fr->vertLBound[i]=a;
-      }
-
+  quad_ci_type ci;
+  ci.dim=2;
+  ci.hess[0][0]=2.*fr->a[0];
+  ci.hess[0][1]=fr->a[2];
+  ci.hess[1][0]=fr->a[2];
+  ci.hess[1][1]=2.*fr->a[1];
+  ci.grad[0]=fr->a[3];
+  ci.grad[1]=fr->a[4];
+  ci.c=fr->a[5];
+  ci.delta=p->ciDelta;
+  ci.useRefVal=1;
+  ci.refVal=eval2Par(fr->fitVert[0],fr->fitVert[1],fr);
+  getQuadCI(&ci);
+  setQuadCIBounds(&ci,fr);
+  fr->ciContourSize=getQuadCIContour2D(&ci,fr->ciContour);//for plotting
 }
 
 void printFitVertex2Par(const data * d, const parameters * p, const fit_results * fr)
@@ -93,7 +60,7 @@ void printFitVertex2Par(const data * d, const parameters * p, const fit_results
     {
       printf(" at:\nx0 = %LE\n",fr->fitVert[0]);
     }
-  if(fr->vertBoundsFound[0]==1)
+  if(fr->vertBoundsFound[1]==1)
     {
       if ((float)(fr->fitVert[1]-fr->vertLBound[1])==(float)(fr->vertUBound[1]-fr->fitVert[1]))
         printf("y0 = %LE +/- %LE\n",fr->fitVert[1],fr->vertUBound[1]-fr->fitVert[1]);
@@ -145,12 +112,14 @@ void print2Par(const data * d, const parameters * p, const fit_results * fr)
 
   if((p->findMinGridPoint == 1)||(p->findMaxGridPoint == 1)){
     printf("\n");
+    long double *fitVal=(long double*)malloc(d->lines*sizeof(long double));
+    evalFitAtData(p,d,fr,fitVal); //see fit_eval_batch.c
     if(p->findMinGridPoint == 1){
       long double currentVal;
       long double minVal = BIG_NUMBER;
       int minPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = eval2Par(d->x[0][i],d->x[1][i],fr);
+        currentVal = fitVal[i];
         if(currentVal < minVal){
           minVal = currentVal;
           minPt = i;
@@ -165,7 +134,7 @@ void print2Par(const data * d, const parameters * p, const fit_results * fr)
       long double maxVal = -1.0*BIG_NUMBER;
       int maxPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = eval2Par(d->x[0][i],d->x[1][i],fr);
+        currentVal = fitVal[i];
         if(currentVal > maxVal){
           maxVal = currentVal;
           maxPt = i;
@@ -175,6 +144,7 @@ void print2Par(const data * d, const parameters * p, const fit_results * fr)
         printf("Grid point corresponding to the highest value (%LE) of the fitted function is at [ %0.3LE %0.3LE ].\n",maxVal,d->x[0][maxPt],d->x[1][maxPt]);
       }
     }
+    free(fitVal);
   }
   
 }
@@ -200,7 +170,7 @@ void fit2Par(const parameters * p, const data * d, fit_results * fr, plot_data *
 {
 
   int numFitPar = 6;
-  fr->ndf=d->lines-numFitPar;
+  fr->ndf=getNumFitLines(d)-numFitPar; //see generate_sums.c
   if(fr->ndf < 0)
     {
       printf("\nERROR: not enough data points for a fit (NDF < 0) using the %s function.\n",p->fitType);
@@ -216,53 +186,13 @@ void fit2Par(const parameters * p, const data * d, fit_results * fr, plot_data *
         }
     }
 
-  //construct equations (n=2 specific case)
+  //construct equations from the moment table (see poly_basis.c)
   int i,j;
   lin_eq_type linEq;
-  linEq.dim=6;
-  
-  for(i=0;i<2;i++)//loop over free parameters
-    for(j=i;j<2;j++)//loop over free parameters
-      linEq.matrix[i][j]=d->xxpowsum[i][2][j][2];//top-left 2x2 entries
-      
-  linEq.matrix[0][2]=d->xxpowsum[0][3][1][1];
-  linEq.matrix[0][3]=d->xpowsum[0][3];
-  linEq.matrix[0][4]=d->xxpowsum[0][2][1][1];
-  linEq.matrix[0][5]=d->xpowsum[0][2];
-  
-  linEq.matrix[1][2]=d->xxpowsum[0][1][1][3];
-  linEq.matrix[1][3]=d->xxpowsum[0][1][1][2];
-  linEq.matrix[1][4]=d->xpowsum[1][3];
-  linEq.matrix[1][5]=d->xpowsum[1][2];
-  
-  linEq.matrix[2][2]=d->xxpowsum[0][2][1][2];
-  linEq.matrix[2][3]=d->xxpowsum[0][2][1][1];
-  linEq.matrix[2][4]=d->xxpowsum[0][1][1][2];
-  linEq.matrix[2][5]=d->xxpowsum[0][1][1][1];
-  
-  linEq.matrix[3][3]=d->xpowsum[0][2];
-  linEq.matrix[3][4]=d->xxpowsum[0][1][1][1];
-  linEq.matrix[3][5]=d->xpowsum[0][1];
-  
-  linEq.matrix[4][4]=d->xpowsum[1][2];
-  linEq.matrix[4][5]=d->xpowsum[1][1];
-      
-  linEq.matrix[5][5]=d->xpowsum[0][0];//bottom right entry
-  
-  //mirror the matrix (top right half mirrored to bottom left half)
-  for(i=1;i<linEq.dim;i++)
-    for(j=0;j<i;j++)
-      linEq.matrix[i][j]=linEq.matrix[j][i];
-  
-  for(i=0;i<2;i++)
-    linEq.vector[i]=d->mxpowsum[i][2];
-  linEq.vector[2]=d->mxxpowsum[0][1][1][1];
-  for(i=3;i<5;i++)
-    linEq.vector[i]=d->mxpowsum[i-3][1];
-  linEq.vector[5]=d->msum;
+  buildNormalEq(p,d,&linEq);
     
 	//solve system of equations and assign values
-	if(!(solve_lin_eq(&linEq)==1))
+	if(!(solveNormalEq(p,fr,&linEq)==1))
 		{
 			printf("ERROR: Could not determine fit parameters (2parpoly2).\n");
 			printf("Perhaps there are not enough data points to perform a fit?\n");
@@ -273,19 +203,9 @@ void fit2Par(const parameters * p, const data * d, fit_results * fr, plot_data *
   //save fit parameters  
   for(i=0;i<linEq.dim;i++)
     fr->a[i]=linEq.solution[i];
-  //refit filter  
-  if(p->refitFilter==1)
-    {
-      refitFilter2Par(p,d,fr,pd,p->refitFilterDist);
-      return;
-    }
-  long double f;
-  fr->chisq=0;
-  for(i=0;i<d->lines;i++)//loop over data points to get chisq
-    {
-      f=fr->a[0]*d->x[0][i]*d->x[0][i] + fr->a[1]*d->x[1][i]*d->x[1][i] + fr->a[2]*d->x[0][i]*d->x[1][i] + fr->a[3]*d->x[0][i] + fr->a[4]*d->x[1][i] + fr->a[5];
-      fr->chisq+=(d->x[2][i] - f)*(d->x[2][i] - f)/(d->x[2+1][i]*d->x[2+1][i]);
-    }
+  residual_stats_type rs;
+  getResiduals(p,d,fr,&rs,NULL); //see residuals.c
+  fr->chisq=rs.chisq;
   //Calculate covariances and uncertainties, see J. Wolberg 
   //'Data Analysis Using the Method of Least Squares' sec 2.5
   for(i=0;i<linEq.dim;i++)
@@ -473,48 +393,5 @@ void fit2Par(const parameters * p, const data * d, fit_results * fr, plot_data *
     }
       
 
-	if((p->plotData==1)&&(p->verbose<1))
-		{
-			preparePlotData(d,p,fr,pd);
-			plotForm2Par(p,fr,pd);
-			plotData(p,fr,pd);
-		}
   
 }
-
-//generate a new data set and refit
-void refitFilter2Par(const parameters * p, const data * d, fit_results * fr, plot_data * pd, long double distance){
-  int i,j;
-
-  //generate a new data set containing only filtered data
-  data *nd=(data*)calloc(1,sizeof(data));
-  parameters *np=(parameters*)calloc(1,sizeof(parameters));
-  memcpy(np,p,sizeof(parameters));
-  np->refitFilter=0;
-  nd->lines=0;
-
-  for (i=0;i<d->lines;i++){
-    long double diff = fabs(d->x[p->numVar][i] - eval2Par(d->x[0][i],d->x[1][i],fr));
-    if(diff<=distance){
-      //keep this data point (remember to copy weight as well)
-      for(j=0;j<=p->numVar+1;j++)
-        nd->x[j][nd->lines] = d->x[j][i];
-      nd->lines++;
-    }
-  }
-
-  nd->max_m=d->max_m;
-  nd->min_m=d->min_m;
-  for(i=0;i<p->numVar;i++)
-    nd->max_x[i]=d->max_x[i];
-
-  if(p->verbose<1)
-    printf("\nRefit filter: %i of %i data point(s) retained.\n",nd->lines,d->lines);
-  //printDataInfo(nd,np); //see print_data_info.c
-
-  generateSums(nd,np); //construct sums for fitting (see generate_sums.c)
-  fit2Par(np,nd,fr,pd,1);
-
-  free(nd);
-  free(np);
-}
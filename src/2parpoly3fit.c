@@ -1,6 +1,6 @@
 //forward declarations
+void evalFitAtData(const parameters *, const data *, const fit_results *, long double *);
 void generateSums(data *,const parameters *);
-void refitFilter2ParPoly3(const parameters *, const data *, fit_results *, plot_data *, long double);
 
 //evaluates the fit function at the specified point
 long double eval2ParPoly3(long double x,long double y, const fit_results * fr)
@@ -11,134 +11,227 @@ long double eval2ParPoly3(long double x,long double y, const fit_results * fr)
 					+ fr->a[6]*x*y + fr->a[7]*x + fr->a[8]*y + fr->a[9];
 }
 
-//determine the minimum and maximum bounds in each variable by generating 2 
-//polynomials, one in each variable
-//done by taking the minimum value of the fit function available 
-//for various values of the variable of interest (projecting the 
-//minimum values on the variable axis)
+//evaluates the profile of the fit function in the specified variable: the
+//local minimum of the fit function in the other variable, with the variable
+//of interest fixed at val (found from the roots of the derivative in the
+//other variable, which is a quadratic)
+//var: variable of interest (0=x, 1=y)
+//returns 1 if successful, 0 if the fit function has no local minimum in the
+//other variable at val
+int eval2ParPoly3Profile(const fit_results * fr, int var, long double val, long double * profVal)
+{
+  long double a,b,c,sqrtval,r1;
+  if(var==0)
+    {
+      a=3.*fr->a[1];
+      b=2.*fr->a[3]*val + 2.*fr->a[5];
+      c=fr->a[2]*val*val + fr->a[6]*val + fr->a[8];
+    }
+  else
+    {
+      a=3.*fr->a[0];
+      b=2.*fr->a[2]*val + 2.*fr->a[4];
+      c=fr->a[3]*val*val + fr->a[6]*val + fr->a[7];
+    }
+  if(a==0.)
+    {
+      //derivative is linear in the other variable, minimum exists if the fit function is convex in it
+      if(b<=0.)
+        return 0;
+      r1=-1.*c/b;
+    }
+  else
+    {
+      sqrtval=b*b - 4.*a*c;
+      if(sqrtval<0.)
+        return 0;
+      //the local minimum is the root with positive second derivative (2*a*r + b)
+      r1=(-1.*b + sqrtl(sqrtval))/(2.*a);
+    }
+  if(var==0)
+    *profVal=eval2ParPoly3(val,r1,fr);
+  else
+    *profVal=eval2ParPoly3(r1,val,fr);
+  return 1;
+}
+
+//finds the local minimum of the profile of the fit function in the specified
+//variable, starting from the lowest profile value on a grid over the data
+//range (extending past the range if the profile is still decreasing there),
+//and refining by golden section search
+//returns 1 if successful, 0 if no local minimum was found
+int get2ParPoly3ProfileMin(const data * d, const fit_results * fr, int var, long double * minPos)
+{
+  int j,minj;
+  long double pVal,minPVal;
+  long double step=(d->max_x[var] - d->min_x[var])/100.;
+  if(step<=0.)
+    return 0;
+
+  //coarse search over the data range
+  minj=-1;
+  minPVal=0.;
+  for(j=0;j<=100;j++)
+    if(eval2ParPoly3Profile(fr,var,d->min_x[var] + j*step,&pVal)==1)
+      if((minj<0)||(pVal<minPVal))
+        {
+          minj=j;
+          minPVal=pVal;
+        }
+  if(minj<0)
+    return 0;
+
+  //extend the search past the data range, if needed
+  int dir=0;
+  if(minj==0)
+    dir=-1;
+  else if(minj==100)
+    dir=1;
+  if(dir!=0)
+    for(j=0;j<=1000;j++)
+      {
+        if(j==1000)
+          return 0;//profile decreases indefinitely
+        if(eval2ParPoly3Profile(fr,var,d->min_x[var] + (minj+dir)*step,&pVal)==0)
+          break;
+        if(pVal>=minPVal)
+          break;
+        minj+=dir;
+        minPVal=pVal;
+      }
+
+  //golden section search on the bracketing interval
+  long double lo=d->min_x[var] + (minj-1)*step;
+  long double hi=d->min_x[var] + (minj+1)*step;
+  long double gr=(sqrtl(5.)-1.)/2.;
+  long double x1=hi - gr*(hi-lo);
+  long double x2=lo + gr*(hi-lo);
+  long double f1,f2;
+  if(eval2ParPoly3Profile(fr,var,x1,&f1)==0)
+    f1=BIG_NUMBER;
+  if(eval2ParPoly3Profile(fr,var,x2,&f2)==0)
+    f2=BIG_NUMBER;
+  for(j=0;j<200;j++)
+    {
+      if((hi-lo)<=1.0E-15*(fabsl(lo)+fabsl(hi)+step))
+        break;
+      if(f1<f2)
+        {
+          hi=x2;
+          x2=x1;
+          f2=f1;
+          x1=hi - gr*(hi-lo);
+          if(eval2ParPoly3Profile(fr,var,x1,&f1)==0)
+            f1=BIG_NUMBER;
+        }
+      else
+        {
+          lo=x1;
+          x1=x2;
+          f1=f2;
+          x2=lo + gr*(hi-lo);
+          if(eval2ParPoly3Profile(fr,var,x2,&f2)==0)
+            f2=BIG_NUMBER;
+        }
+    }
+  *minPos=(lo+hi)/2.;
+  return 1;
+}
+
+//finds where the profile of the fit function in the specified variable
+//reaches the target value, searching outward from start in steps of 1/100 of
+//the data range until the target is passed, then refining by bisection
+//dir: search direction, 1 for increasing values, 0 for decreasing values
+//returns 1 if successful, 0 if the target was not reached (or the profile
+//became undefined) within 10 data ranges of start
+int get2ParPoly3ProfileCrossing(const data * d, const fit_results * fr, int var, long double start, long double target, int dir, long double * result)
+{
+  int j;
+  long double pVal;
+  long double step=(d->max_x[var] - d->min_x[var])/100.;
+  if(dir==0)
+    step*=-1.;
+  if(step==0.)
+    return 0;
+
+  long double prev=start;
+  long double cur=start;
+  for(j=1;j<=1000;j++)
+    {
+      cur=start + j*step;
+      if(eval2ParPoly3Profile(fr,var,cur,&pVal)==0)
+        return 0;
+      if(pVal>=target)
+        break;
+      prev=cur;
+    }
+  if(j>1000)
+    return 0;
+
+  //bisect between the last point below and the first point above the target
+  long double mid;
+  for(j=0;j<200;j++)
+    {
+      mid=(prev+cur)/2.;
+      if((mid==prev)||(mid==cur))
+        break;
+      if(eval2ParPoly3Profile(fr,var,mid,&pVal)==0)
+        return 0;
+      if(pVal>=target)
+        cur=mid;
+      else
+        prev=mid;
+    }
+  *result=(prev+cur)/2.;
+  return 1;
+}
+
+//determine the minimum and the confidence bounds in each variable from the
+//profile of the fit function in that variable (the minimum value of the fit
+//function over the other variable, for each value of the variable of interest)
+//the bounds are where the profile crosses the minimum value + delta
 //fixZero - 0: don't fix minimum to 0, 1: fix minimum in x to 0, 
 //             2: fix minimum in y to 0, 3: fix minimum in x and y to 0 
 void fit2ParPoly3ChisqConf(const data * d, const parameters * p, fit_results * fr, int fixZero)
 {
-  int i,j;
-	
-  //allocate fit structures
-  parameters *svarp=(parameters*)calloc(1,sizeof(parameters));
-  data *svard=(data*)calloc(1,sizeof(data));
-  fit_results *svarfr=(fit_results*)calloc(1,sizeof(fit_results));
-  plot_data *svarpd=(plot_data*)calloc(1,sizeof(plot_data));
-  //setup fit
-  svarp->numVar=1;
-  svarp->ciDelta=p->ciDelta;
-  strcpy(svarp->plotMode,"1d");
-  strcpy(svarp->fitType,"poly3");
-  if(strcmp(p->dataType,"chisq")==0)
-    strcpy(svarp->dataType,"chisq");
-  	
-	long double val,a,b,c,sqrtval;
-	for(i=0;i<2;i++)//variable #
-		{
-			svard->lines=0;
-			for(j=0;j<=100;j++)//number of data points to compute
-				{
-					val=d->min_x[i] + (j/100.)*(d->max_x[i] - d->min_x[i]);
-          //printf("val: %Lf, min: %Lf, max: %Lf\n",val,d->min_x[i],d->max_x[i]);
-					if(i==0)
-						{
-							a=3.*fr->a[1];
-							b=2.*fr->a[3]*val + 2.*fr->a[5];
-							c=fr->a[2]*val*val + fr->a[6]*val + fr->a[8];
-						}
-					else
-						{
-							a=3.*fr->a[0];
-							b=2.*fr->a[2]*val + 2.*fr->a[4];
-							c=fr->a[3]*val*val + fr->a[6]*val + fr->a[7];
-						}
-					sqrtval=b*b - 4.*a*c;			
-					if(sqrtval==0)
-						{
-							if(i==0)
-								svard->x[1][svard->lines]=eval2ParPoly3(val,-1.*b/(2.*a),fr);
-							else
-								svard->x[1][svard->lines]=eval2ParPoly3(-1.*b/(2.*a),val,fr);
-						}
-					else if(sqrtval>0)
-						{
-							if(i==0)
-								{
-									if(eval2ParPoly3(val,(-1.*b - sqrt(sqrtval))/(2.*a),fr)>eval2ParPoly3(val,(-1.*b + sqrt(sqrtval))/(2.*a),fr))
-										svard->x[1][svard->lines]=eval2ParPoly3(val,(-1.*b + sqrt(sqrtval))/(2.*a),fr);
-									else
-										svard->x[1][svard->lines]=eval2ParPoly3(val,(-1.*b - sqrt(sqrtval))/(2.*a),fr);
-								}
-							else
-								{
-									if(eval2ParPoly3((-1.*b - sqrt(sqrtval))/(2.*a),val,fr)>eval2ParPoly3((-1.*b + sqrt(sqrtval))/(2.*a),val,fr))
-										svard->x[1][svard->lines]=eval2ParPoly3((-1.*b + sqrt(sqrtval))/(2.*a),val,fr);
-									else
-										svard->x[1][svard->lines]=eval2ParPoly3((-1.*b - sqrt(sqrtval))/(2.*a),val,fr);
-								}
-						}//don't take any action (skip data point) if the roots are not real
-					
-					if(sqrtval>=0)
-						{
-							svard->x[0][svard->lines]=val;
-							svard->x[2][svard->lines]=1.;//set weight
-              //printf("%Lf %Lf\n",svard->x[0][svard->lines],svard->x[1][svard->lines]);
-							svard->lines++;
-						}
+  int i;
+  long double minPos,minVal,bound;
 
-          //printf("i=%i, sqrtval=%Lf\n",i,sqrtval);
-					
-				}
-      
-      //check that a fit is possible
-      if(svard->lines>=4)
+  for(i=0;i<2;i++)//variable #
+    {
+      fr->vertBoundsFound[i]=0;
+
+      //get the minimum of the profile
+      if((fixZero==i+1)||(fixZero==3))
+        minPos=0.;
+      else if(get2ParPoly3ProfileMin(d,fr,i,&minPos)==0)
         {
-          //fit and find critical points of this data
-          generateSums(svard,svarp);
-          fitPoly3(svarp,svard,svarfr,svarpd,0);//fit but don't print data
+          fr->fitVert[i]=NAN;
+          continue;
+        }
+      fr->fitVert[i]=minPos;
+      if(eval2ParPoly3Profile(fr,i,minPos,&minVal)==0)
+        continue;
 
-          //compute confidence interval with variable fixed to 0 if requested
-          if(strcmp(p->dataType,"chisq")==0)
+      //get confidence bounds
+      //(with the minimum fixed to 0, only the upper bound is searched for and is mirrored)
+      if(strcmp(p->dataType,"chisq")==0)
+        if(get2ParPoly3ProfileCrossing(d,fr,i,minPos,minVal+p->ciDelta,1,&bound)==1)
+          {
+            fr->vertUBound[i]=bound;
             if((fixZero==i+1)||(fixZero==3))
-              fitPoly3ChisqConf(svarp,svarfr,0.,1,0);
-
-          //save critical point corresponding to minimum
-          int minInd = getPoly3LocalMinIndex(svarfr);
-          if((fixZero==i+1)||(fixZero==3))
-            fr->fitVert[i]=0.;
-          else
-            fr->fitVert[i]=svarfr->fitVert[minInd];
-          //save confidence bounds, if applicable
-          if((strcmp(p->dataType,"chisq")==0)&&(svarfr->vertBoundsFound[minInd]==1))
-            {
-              fr->vertBoundsFound[i]=1;
-              fr->vertLBound[i]=svarfr->vertLBound[minInd];
-              fr->vertUBound[i]=svarfr->vertUBound[minInd];
-              //printf("i: %i, vert: %Lf, lbound: %Lf, ubound: %Lf\n",i,fr->fitVert[i],fr->vertLBound[i],fr->vertUBound[i]);
-            }
-          else if((strcmp(p->dataType,"chisq")==0) && ((fixZero==i+1)||(fixZero==3)))
-            {
-              //fallback for minimum fixed to zero
-              fr->vertUBound[i]=evalPoly3X(evalPoly3(0.0,svarfr)+svarp->ciDelta, svarfr,0.0,1);
-              fr->vertLBound[i]=-1.0*fr->vertUBound[i];
-              fr->vertBoundsFound[i]=1;
-            }
-          else
-            fr->vertBoundsFound[i]=0;
-        }
-      else
-        fr->vertBoundsFound[i]=0;
-      
+              {
+                fr->vertLBound[i]=-1.*bound;
+                fr->vertBoundsFound[i]=1;
+              }
+            else if(get2ParPoly3ProfileCrossing(d,fr,i,minPos,minVal+p->ciDelta,0,&bound)==1)
+              {
+                fr->vertLBound[i]=bound;
+                fr->vertBoundsFound[i]=1;
+              }
+          }
     }
 
-	//free fit structures
-	free(svarp);
-	free(svard);
-	free(svarfr);
-	free(svarpd);
 }
 
 void printFitVertex2ParPoly3(const data * d, const parameters * p, const fit_results * fr)
@@ -246,12 +339,14 @@ void print2ParPoly3(const data * d, const parameters * p, const fit_results * fr
   
   if((p->findMinGridPoint == 1)||(p->findMaxGridPoint == 1)){
     printf("\n");
+    long double *fitVal=(long double*)malloc(d->lines*sizeof(long double));
+    evalFitAtData(p,d,fr,fitVal); //see fit_eval_batch.c
     if(p->findMinGridPoint == 1){
       long double currentVal;
       long double minVal = BIG_NUMBER;
       int minPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = eval2ParPoly3(d->x[0][i],d->x[1][i],fr);
+        currentVal = fitVal[i];
         if(currentVal < minVal){
           minVal = currentVal;
           minPt = i;
@@ -266,7 +361,7 @@ void print2ParPoly3(const data * d, const parameters * p, const fit_results * fr
       long double maxVal = -1.0*BIG_NUMBER;
       int maxPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = eval2ParPoly3(d->x[0][i],d->x[1][i],fr);
+        currentVal = fitVal[i];
         if(currentVal > maxVal){
           maxVal = currentVal;
           maxPt = i;
@@ -276,6 +371,7 @@ void print2ParPoly3(const data * d, const parameters * p, const fit_results * fr
         printf("Grid point corresponding to the highest value (%LE) of the fitted function is at [ %0.3LE %0.3LE ].\n",maxVal,d->x[0][maxPt],d->x[1][maxPt]);
       }
     }
+    free(fitVal);
   }
 		
     
@@ -301,7 +397,7 @@ void fit2ParPoly3(const parameters * p, const data * d, fit_results * fr, plot_d
 {
 
   int numFitPar = 10;
-  fr->ndf=d->lines-numFitPar;
+  fr->ndf=getNumFitLines(d)-numFitPar; //see generate_sums.c
   if(fr->ndf < 0)
     {
       printf("\nERROR: not enough data points for a fit (NDF < 0) using the %s function.\n",p->fitType);
@@ -317,92 +413,11 @@ void fit2ParPoly3(const parameters * p, const data * d, fit_results * fr, plot_d
         }
     }
 
-  //construct equations
+  //construct equations from the moment table (see poly_basis.c)
   int i,j;
   lin_eq_type linEq;
-  linEq.dim=10;
-  
-  linEq.matrix[0][0]=d->xxpowsum[0][3][0][3];//x^6
-  linEq.matrix[0][1]=d->xxpowsum[0][3][1][3];//x^3y^3
-  linEq.matrix[0][2]=d->xxpowsum[0][5][1][1];
-  linEq.matrix[0][3]=d->xxpowsum[0][4][1][2];
-  linEq.matrix[0][4]=d->xpowsum[0][5];//x^5
-  linEq.matrix[0][5]=d->xxpowsum[0][3][1][2];
-  linEq.matrix[0][6]=d->xxpowsum[0][4][1][1];
-  linEq.matrix[0][7]=d->xpowsum[0][4];
-  linEq.matrix[0][8]=d->xxpowsum[0][3][1][1];
-  linEq.matrix[0][9]=d->xpowsum[0][3];
-  
-  linEq.matrix[1][1]=d->xxpowsum[1][3][1][3];//y^6
-  linEq.matrix[1][2]=d->xxpowsum[0][2][1][4];
-  linEq.matrix[1][3]=d->xxpowsum[0][1][1][5];
-  linEq.matrix[1][4]=d->xxpowsum[0][2][1][3];
-  linEq.matrix[1][5]=d->xpowsum[1][5];
-  linEq.matrix[1][6]=d->xxpowsum[0][1][1][4];
-  linEq.matrix[1][7]=d->xxpowsum[0][1][1][3];
-  linEq.matrix[1][8]=d->xpowsum[1][4];
-  linEq.matrix[1][9]=d->xpowsum[1][3];
-  
-  linEq.matrix[2][2]=d->xxpowsum[0][4][1][2];
-  linEq.matrix[2][3]=d->xxpowsum[0][3][1][3];
-  linEq.matrix[2][4]=d->xxpowsum[0][4][1][1];
-  linEq.matrix[2][5]=d->xxpowsum[0][2][1][3];
-  linEq.matrix[2][6]=d->xxpowsum[0][3][1][2];
-  linEq.matrix[2][7]=d->xxpowsum[0][3][1][1];
-  linEq.matrix[2][8]=d->xxpowsum[0][2][1][2];
-  linEq.matrix[2][9]=d->xxpowsum[0][2][1][1];
-
-  linEq.matrix[3][3]=d->xxpowsum[0][2][1][4];  
-  linEq.matrix[3][4]=d->xxpowsum[0][3][1][2];
-  linEq.matrix[3][5]=d->xxpowsum[0][1][1][4];
-  linEq.matrix[3][6]=d->xxpowsum[0][2][1][3];
-  linEq.matrix[3][7]=d->xxpowsum[0][2][1][2];
-  linEq.matrix[3][8]=d->xxpowsum[0][1][1][3];
-  linEq.matrix[3][9]=d->xxpowsum[0][1][1][2];
-  
-  linEq.matrix[4][4]=d->xpowsum[0][4];
-  linEq.matrix[4][5]=d->xxpowsum[0][2][1][2];
-  linEq.matrix[4][6]=d->xxpowsum[0][3][1][1];
-  linEq.matrix[4][7]=d->xpowsum[0][3];
-  linEq.matrix[4][8]=d->xxpowsum[0][2][1][1];
-  linEq.matrix[4][9]=d->xpowsum[0][2];
-  
-  linEq.matrix[5][5]=d->xpowsum[1][4];
-  linEq.matrix[5][6]=d->xxpowsum[0][1][1][3];
-  linEq.matrix[5][7]=d->xxpowsum[0][1][1][2];
-  linEq.matrix[5][8]=d->xpowsum[1][3];
-  linEq.matrix[5][9]=d->xpowsum[1][2];
-  
-  linEq.matrix[6][6]=d->xxpowsum[0][2][1][2];
-  linEq.matrix[6][7]=d->xxpowsum[0][2][1][1];
-  linEq.matrix[6][8]=d->xxpowsum[0][1][1][2];
-  linEq.matrix[6][9]=d->xxpowsum[0][1][1][1];
-  
-  linEq.matrix[7][7]=d->xpowsum[0][2];
-  linEq.matrix[7][8]=d->xxpowsum[0][1][1][1];
-  linEq.matrix[7][9]=d->xpowsum[0][1];
-  
-  linEq.matrix[8][8]=d->xpowsum[1][2];
-  linEq.matrix[8][9]=d->xpowsum[1][1];
-      
-  linEq.matrix[9][9]=d->xpowsum[0][0];//bottom right entry
-  
-  //mirror the matrix (top right half mirrored to bottom left half)
-  for(i=1;i<linEq.dim;i++)
-    for(j=0;j<i;j++)
-      linEq.matrix[i][j]=linEq.matrix[j][i];
-  
-  linEq.vector[0]=d->mxpowsum[0][3];
-  linEq.vector[1]=d->mxpowsum[1][3];
-  linEq.vector[2]=d->mxxpowsum[0][2][1][1];
-  linEq.vector[3]=d->mxxpowsum[0][1][1][2];
-  linEq.vector[4]=d->mxpowsum[0][2];
-  linEq.vector[5]=d->mxpowsum[1][2];
-  linEq.vector[6]=d->mxxpowsum[0][1][1][1];
-  linEq.vector[7]=d->mxpowsum[0][1];
-  linEq.vector[8]=d->mxpowsum[1][1];
-  linEq.vector[9]=d->msum;
-
+  buildNormalEq(p,d,&linEq);
+    
   /*printf("Matrix:\n");
   for(i=0;i<linEq.dim;i++)
     {
@@ -417,7 +432,7 @@ void fit2ParPoly3(const parameters * p, const data * d, fit_results * fr, plot_d
     }*/
 
 	//solve system of equations and assign values
-	if(!(solve_lin_eq(&linEq)==1))
+	if(!(solveNormalEq(p,fr,&linEq)==1))
 		{
 			printf("ERROR: Could not determine fit parameters (2parpoly3).\n");
 			printf("Perhaps there are not enough data points to perform a fit?\n");
@@ -428,23 +443,9 @@ void fit2ParPoly3(const parameters * p, const data * d, fit_results * fr, plot_d
   //save fit parameters  
   for(i=0;i<linEq.dim;i++)
     fr->a[i]=linEq.solution[i];
-  //refit filter  
-  if(p->refitFilter==1)
-    {
-      refitFilter2ParPoly3(p,d,fr,pd,p->refitFilterDist);
-      return;
-    }
-  //evaluate chisq
-  long double f;
-  fr->chisq=0;
-  for(i=0;i<d->lines;i++)//loop over data points for chisq
-    {
-      f=fr->a[0]*d->x[0][i]*d->x[0][i]*d->x[0][i] + fr->a[1]*d->x[1][i]*d->x[1][i]*d->x[1][i]
-       + fr->a[2]*d->x[0][i]*d->x[0][i]*d->x[1][i] + fr->a[3]*d->x[0][i]*d->x[1][i]*d->x[1][i]
-        + fr->a[4]*d->x[0][i]*d->x[0][i] + fr->a[5]*d->x[1][i]*d->x[1][i]
-         + fr->a[6]*d->x[0][i]*d->x[1][i] + fr->a[7]*d->x[0][i] + fr->a[8]*d->x[1][i] + fr->a[9];
-      fr->chisq+=(d->x[2][i] - f)*(d->x[2][i] - f)/(d->x[2+1][i]*d->x[2+1][i]);
-    }
+  residual_stats_type rs;
+  getResiduals(p,d,fr,&rs,NULL); //see residuals.c
+  fr->chisq=rs.chisq;
   
   /*printf("Inverse matrix:\n");
   for(i=0;i<linEq.dim;i++)
@@ -570,48 +571,5 @@ void fit2ParPoly3(const parameters * p, const data * d, fit_results * fr, plot_d
 		
 
 	
-	if((p->plotData==1)&&(p->verbose<1))
-		{
-			preparePlotData(d,p,fr,pd);
-			plotForm2ParPoly3(p,fr,pd);
-			plotData(p,fr,pd);
-		}
 
 }
-
-//generate a new data set and refit
-void refitFilter2ParPoly3(const parameters * p, const data * d, fit_results * fr, plot_data * pd, long double distance){
-  int i,j;
-
-  //generate a new data set containing only filtered data
-  data *nd=(data*)calloc(1,sizeof(data));
-  parameters *np=(parameters*)calloc(1,sizeof(parameters));
-  memcpy(np,p,sizeof(parameters));
-  np->refitFilter=0;
-  nd->lines=0;
-
-  for (i=0;i<d->lines;i++){
-    long double diff = fabs(d->x[p->numVar][i] - eval2ParPoly3(d->x[0][i],d->x[1][i],fr));
-    if(diff<=distance){
-      //keep this data point (remember to copy weight as well)
-      for(j=0;j<=p->numVar+1;j++)
-        nd->x[j][nd->lines] = d->x[j][i];
-      nd->lines++;
-    }
-  }
-
-  nd->max_m=d->max_m;
-  nd->min_m=d->min_m;
-  for(i=0;i<p->numVar;i++)
-    nd->max_x[i]=d->max_x[i];
-
-  if(p->verbose<1)
-    printf("\nRefit filter: %i of %i data point(s) retained.\n",nd->lines,d->lines);
-  //printDataInfo(nd,np); //see print_data_info.c
-
-  generateSums(nd,np); //construct sums for fitting (see generate_sums.c)
-  fit2ParPoly3(np,nd,fr,pd,1);
-
-  free(nd);
-  free(np);
-}
\ No newline at end of file
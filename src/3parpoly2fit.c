@@ -1,6 +1,6 @@
 //forward declarations
+void evalFitAtData(const parameters *, const data *, const fit_results *, long double *);
 void generateSums(data *,const parameters *);
-void refitFilter3Par(const parameters *, const data *, fit_results *, plot_data *, long double);
 
 //evaluates the fit function at the specified point
 long double eval3Par(long double x,long double y,long double z, const fit_results * fr)
@@ -12,66 +12,31 @@ long double eval3Par(long double x,long double y,long double z, const fit_result
 }
 
 
-//determine uncertainty ellipsoid bounds for the vertex by from fit function values fixed at min + delta
-//derived using the same procedure as for 2 free variables (see 2parfit.c), with an extra step solving the quadratic formula in between
+//determine uncertainty ellipsoid bounds for the vertex from the region where the
+//fit function is within delta of its value at the vertex (see quad_ci.c)
 //delta is the desired confidence level (3.53 for 1-sigma in 3 parameters)
 void fit3ParChisqConf(const parameters * p, fit_results * fr)
 {
-  
-  long double a,b,c;
-  long double delta=p->ciDelta;
-  fr->vertBoundsFound[0]=1;
-  
-  a=(16.*fr->a[1]*fr->a[2] - 4.*fr->a[5]*fr->a[5])*(4.*fr->a[0]*fr->a[2] - fr->a[4]*fr->a[4]) - 16.*(fr->a[2]*fr->a[2]*fr->a[3]*fr->a[3] - fr->a[2]*fr->a[3]*fr->a[4]*fr->a[5]) - 4.*fr->a[4]*fr->a[4]*fr->a[5]*fr->a[5];
-  b=(16.*fr->a[1]*fr->a[2] - 4.*fr->a[5]*fr->a[5])*(4.*fr->a[2]*fr->a[6] - 2.*fr->a[4]*fr->a[8]) - 16.*(2.*fr->a[2]*fr->a[2]*fr->a[3]*fr->a[7] - fr->a[2]*fr->a[5]*(fr->a[3]*fr->a[8] + fr->a[7]*fr->a[4])) - 8.*fr->a[5]*fr->a[5]*fr->a[4]*fr->a[8];
-  c=(16.*fr->a[1]*fr->a[2] - 4.*fr->a[5]*fr->a[5])*(4.*fr->a[2]*(fr->a[9] - delta - fr->vertVal) - fr->a[8]*fr->a[8]) - 16.*(fr->a[2]*fr->a[2]*fr->a[7]*fr->a[7] - fr->a[2]*fr->a[5]*fr->a[7]*fr->a[8]) - 4.*fr->a[5]*fr->a[5]*fr->a[8]*fr->a[8]; 
-  if((b*b - 4*a*c)<0.)
-    c=(16.*fr->a[1]*fr->a[2] - 4.*fr->a[5]*fr->a[5])*(4.*fr->a[2]*(fr->a[9] + delta - fr->vertVal) - fr->a[8]*fr->a[8]) - 16.*(fr->a[2]*fr->a[2]*fr->a[7]*fr->a[7] - fr->a[2]*fr->a[5]*fr->a[7]*fr->a[8]) - 4.*fr->a[5]*fr->a[5]*fr->a[8]*fr->a[8];//try flipping delta
-  if((b*b - 4*a*c)<0.)
-    fr->vertBoundsFound[0]=0;
-  else
-    {
-      fr->vertUBound[0]=(-1.*b + (long double)sqrt((double)(b*b - 4.*a*c)))/(2.*a);
-      fr->vertLBound[0]=(-1.*b - (long double)sqrt((double)(b*b - 4.*a*c)))/(2.*a);
-    }
-
-  a=(16.*fr->a[0]*fr->a[2] - 4.*fr->a[4]*fr->a[4])*(4.*fr->a[0]*fr->a[1] - fr->a[3]*fr->a[3]) - 16.*(fr->a[0]*fr->a[0]*fr->a[5]*fr->a[5] - fr->a[0]*fr->a[3]*fr->a[4]*fr->a[5]) - 4.*fr->a[3]*fr->a[3]*fr->a[4]*fr->a[4];  
-  b=(16.*fr->a[0]*fr->a[2] - 4.*fr->a[4]*fr->a[4])*(4.*fr->a[0]*fr->a[7] - 2.*fr->a[3]*fr->a[6]) - 16.*(2.*fr->a[5]*fr->a[8]*fr->a[0]*fr->a[0] - fr->a[0]*fr->a[4]*(fr->a[5]*fr->a[6] + fr->a[8]*fr->a[3])) - 8.*fr->a[4]*fr->a[4]*fr->a[3]*fr->a[6];  
-  c=(16.*fr->a[0]*fr->a[2] - 4.*fr->a[4]*fr->a[4])*(4.*fr->a[0]*(fr->a[9] - delta - fr->vertVal) - fr->a[6]*fr->a[6]) - 16.*(fr->a[0]*fr->a[0]*fr->a[8]*fr->a[8] - fr->a[0]*fr->a[4]*fr->a[6]*fr->a[8]) - 4.*fr->a[4]*fr->a[4]*fr->a[6]*fr->a[6];
-  if((b*b - 4*a*c)<0.) 
-    c=(16.*fr->a[0]*fr->a[2] - 4.*fr->a[4]*fr->a[4])*(4.*fr->a[0]*(fr->a[9] + delta - fr->vertVal) - fr->a[6]*fr->a[6]) - 16.*(fr->a[0]*fr->a[0]*fr->a[8]*fr->a[8] - fr->a[0]*fr->a[4]*fr->a[6]*fr->a[8]) - 4.*fr->a[4]*fr->a[4]*fr->a[6]*fr->a[6];//try flipping delta
-  if((b*b - 4*a*c)<0.)  
-    fr->vertBoundsFound[0]=0;
-  else
-    {
-      fr->vertUBound[1]=(-1.*b + (long double)sqrt((double)(b*b - 4.*a*c)))/(2.*a);
-      fr->vertLBound[1]=(-1.*b - (long double)sqrt((double)(b*b - 4.*a*c)))/(2.*a);
-    }
-  
-  a=(16.*fr->a[0]*fr->a[1] - 4.*fr->a[3]*fr->a[3])*(4.*fr->a[0]*fr->a[2] - fr->a[4]*fr->a[4]) - 16.*(fr->a[0]*fr->a[0]*fr->a[5]*fr->a[5] - fr->a[0]*fr->a[3]*fr->a[4]*fr->a[5]) - 4.*fr->a[3]*fr->a[3]*fr->a[4]*fr->a[4];
-  b=(16.*fr->a[0]*fr->a[1] - 4.*fr->a[3]*fr->a[3])*(4.*fr->a[0]*fr->a[8] - 2.*fr->a[4]*fr->a[6]) - 16.*(2.*fr->a[5]*fr->a[7]*fr->a[0]*fr->a[0] - fr->a[0]*fr->a[3]*(fr->a[5]*fr->a[6] + fr->a[7]*fr->a[4])) - 8.*fr->a[3]*fr->a[3]*fr->a[4]*fr->a[6];
-  c=(16.*fr->a[0]*fr->a[1] - 4.*fr->a[3]*fr->a[3])*(4.*fr->a[0]*(fr->a[9] - delta - fr->vertVal) - fr->a[6]*fr->a[6]) - 16.*(fr->a[0]*fr->a[0]*fr->a[7]*fr->a[7] - fr->a[0]*fr->a[3]*fr->a[6]*fr->a[7]) - 4.*fr->a[3]*fr->a[3]*fr->a[6]*fr->a[6];  
-  if((b*b - 4*a*c)<0.) 
-    c=(16.*fr->a[0]*fr->a[1] - 4.*fr->a[3]*fr->a[3])*(4.*fr->a[0]*(fr->a[9] + delta - fr->vertVal) - fr->a[6]*fr->a[6]) - 16.*(fr->a[0]*fr->a[0]*fr->a[7]*fr->a[7] - fr->a[0]*fr->a[3]*fr->a[6]*fr->a[7]) - 4.*fr->a[3]*fr->a[3]*fr->a[6]*fr->a[6];//try flipping delta
-  if((b*b - 4*a*c)<0.)  
-    fr->vertBoundsFound[0]=0;
-  else
-    {
-      fr->vertUBound[2]=(-1.*b + (long double)sqrt((double)(b*b - 4.*a*c)))/(2.*a);
-      fr->vertLBound[2]=(-1.*b - (long double)sqrt((double)(b*b - 4.*a*c)))/(2.*a);
-    }
-  
-  //swap bounds if needed
-  int i;
-  for(i=0;i<3;i++)
-    if(fr->vertLBound[i]>fr->vertUBound[i])
-      {
-        a=fr->vertUBound[i];
-        fr->vertUBound[i]=fr->vertLBound[i];
-        fr->vertLBound[i]=a;
-      }
-    
-
+  quad_ci_type ci;
+  ci.dim=3;
+  ci.hess[0][0]=2.*fr->a[0];
+  ci.hess[0][1]=fr->a[3];
+  ci.hess[0][2]=fr->a[4];
+  ci.hess[1][1]=2.*fr->a[1];
+  ci.hess[1][2]=fr->a[5];
+  ci.hess[2][2]=2.*fr->a[2];
+  ci.hess[1][0]=ci.hess[0][1];
+  ci.hess[2][0]=ci.hess[0][2];
+  ci.hess[2][1]=ci.hess[1][2];
+  ci.grad[0]=fr->a[6];
+  ci.grad[1]=fr->a[7];
+  ci.grad[2]=fr->a[8];
+  ci.c=fr->a[9];
+  ci.delta=p->ciDelta;
+  ci.useRefVal=1;
+  ci.refVal=fr->vertVal;
+  getQuadCI(&ci);
+  setQuadCIBounds(&ci,fr);
 }
 
 //prints fit data
@@ -130,7 +95,7 @@ void print3Par(const data * d, const parameters * p, const fit_results * fr)
     printf("Minimum in y direction");
   else
     printf("Maximum in y direction");
-  if(fr->vertBoundsFound[0]==1)
+  if(fr->vertBoundsFound[1]==1)
     {
       printf(" (with %s confidence interval), ",p->ciSigmaDesc);
       if ((float)(fr->fitVert[1]-fr->vertLBound[1])==(float)(fr->vertUBound[1]-fr->fitVert[1]))
@@ -147,7 +112,7 @@ void print3Par(const data * d, const parameters * p, const fit_results * fr)
     printf("Minimum in z direction");
   else
     printf("Maximum in z direction");
-  if(fr->vertBoundsFound[0]==1)
+  if(fr->vertBoundsFound[2]==1)
     {
       printf(" (with %s confidence interval), ",p->ciSigmaDesc);
       if ((float)(fr->fitVert[2]-fr->vertLBound[2])==(float)(fr->vertUBound[2]-fr->fitVert[2]))
@@ -166,12 +131,14 @@ void print3Par(const data * d, const parameters * p, const fit_results * fr)
 
   if((p->findMinGridPoint == 1)||(p->findMaxGridPoint == 1)){
     printf("\n");
+    long double *fitVal=(long double*)malloc(d->lines*sizeof(long double));
+    evalFitAtData(p,d,fr,fitVal); //see fit_eval_batch.c
     if(p->findMinGridPoint == 1){
       long double currentVal;
       long double minVal = BIG_NUMBER;
       int minPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = eval3Par(d->x[0][i],d->x[1][i],d->x[2][i],fr);
+        currentVal = fitVal[i];
         if(currentVal < minVal){
           minVal = currentVal;
           minPt = i;
@@ -186,7 +153,7 @@ void print3Par(const data * d, const parameters * p, const fit_results * fr)
       long double maxVal = -1.0*BIG_NUMBER;
       int maxPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = eval3Par(d->x[0][i],d->x[1][i],d->x[2][i],fr);
+        currentVal = fitVal[i];
         if(currentVal > maxVal){
           maxVal = currentVal;
           maxPt = i;
@@ -196,6 +163,7 @@ void print3Par(const data * d, const parameters * p, const fit_results * fr)
         printf("Grid point corresponding to the highest value (%LE) of the fitted function is at [ %0.3LE %0.3LE %0.3LE ].\n",maxVal,d->x[0][maxPt],d->x[1][maxPt],d->x[2][maxPt]);
       }
     }
+    free(fitVal);
   }
     
 }
@@ -226,7 +194,7 @@ void fit3Par(const parameters * p, const data * d, fit_results * fr, plot_data *
 {
 
   int numFitPar = 10;
-  fr->ndf=d->lines-numFitPar;
+  fr->ndf=getNumFitLines(d)-numFitPar; //see generate_sums.c
   if(fr->ndf < 0)
     {
       printf("\nERROR: not enough data points for a fit (NDF < 0) using the %s function.\n",p->fitType);
@@ -242,90 +210,13 @@ void fit3Par(const parameters * p, const data * d, fit_results * fr, plot_data *
         }
     }
 
-  //construct equations (n=3 specific case)
+  //construct equations from the moment table (see poly_basis.c)
   int i,j;
   lin_eq_type linEq;
-  linEq.dim=10;
-  
-  for(i=0;i<3;i++)//loop over free parameters
-    for(j=i;j<3;j++)//loop over free parameters
-      linEq.matrix[i][j]=d->xxpowsum[i][2][j][2];//top-left 3x3 entries
-      
-  linEq.matrix[0][3]=d->xxpowsum[0][3][1][1];
-  linEq.matrix[0][4]=d->xxpowsum[0][3][2][1];
-  linEq.matrix[0][5]=d->xxxpowsum[0][2][1][1][2][1];
-  linEq.matrix[0][6]=d->xpowsum[0][3];
-  linEq.matrix[0][7]=d->xxpowsum[0][2][1][1];
-  linEq.matrix[0][8]=d->xxpowsum[0][2][2][1];
-  linEq.matrix[0][9]=d->xpowsum[0][2];
-  
-  linEq.matrix[1][3]=d->xxpowsum[0][1][1][3];
-  linEq.matrix[1][4]=d->xxxpowsum[0][1][1][2][2][1];
-  linEq.matrix[1][5]=d->xxpowsum[1][3][2][1];
-  linEq.matrix[1][6]=d->xxpowsum[0][1][1][2];
-  linEq.matrix[1][7]=d->xpowsum[1][3];
-  linEq.matrix[1][8]=d->xxpowsum[1][2][2][1];
-  linEq.matrix[1][9]=d->xpowsum[1][2];
-  
-  linEq.matrix[2][3]=d->xxxpowsum[0][1][1][1][2][2];
-  linEq.matrix[2][4]=d->xxpowsum[0][1][2][3];
-  linEq.matrix[2][5]=d->xxpowsum[1][1][2][3];
-  linEq.matrix[2][6]=d->xxpowsum[0][1][2][2];
-  linEq.matrix[2][7]=d->xxpowsum[1][1][2][2];
-  linEq.matrix[2][8]=d->xpowsum[2][3];
-  linEq.matrix[2][9]=d->xpowsum[2][2];
-
-  linEq.matrix[3][3]=d->xxpowsum[0][2][1][2];  
-  linEq.matrix[3][4]=d->xxxpowsum[0][2][1][1][2][1];
-  linEq.matrix[3][5]=d->xxxpowsum[0][1][1][2][2][1];
-  linEq.matrix[3][6]=d->xxpowsum[0][2][1][1];
-  linEq.matrix[3][7]=d->xxpowsum[0][1][1][2];
-  linEq.matrix[3][8]=d->xxxpowsum[0][1][1][1][2][1];
-  linEq.matrix[3][9]=d->xxpowsum[0][1][1][1];
-  
-  linEq.matrix[4][4]=d->xxpowsum[0][2][2][2];
-  linEq.matrix[4][5]=d->xxxpowsum[0][1][1][1][2][2];
-  linEq.matrix[4][6]=d->xxpowsum[0][2][2][1];
-  linEq.matrix[4][7]=d->xxxpowsum[0][1][1][1][2][1];
-  linEq.matrix[4][8]=d->xxpowsum[0][1][2][2];
-  linEq.matrix[4][9]=d->xxpowsum[0][1][2][1];
-  
-  linEq.matrix[5][5]=d->xxpowsum[1][2][2][2];
-  linEq.matrix[5][6]=d->xxxpowsum[0][1][1][1][2][1];
-  linEq.matrix[5][7]=d->xxpowsum[1][2][2][1];
-  linEq.matrix[5][8]=d->xxpowsum[1][1][2][2];
-  linEq.matrix[5][9]=d->xxpowsum[1][1][2][1];
-  
-  linEq.matrix[6][6]=d->xpowsum[0][2];
-  linEq.matrix[6][7]=d->xxpowsum[0][1][1][1];
-  linEq.matrix[6][8]=d->xxpowsum[0][1][2][1];
-  linEq.matrix[6][9]=d->xpowsum[0][1];
-  
-  linEq.matrix[7][7]=d->xpowsum[1][2];
-  linEq.matrix[7][8]=d->xxpowsum[1][1][2][1];
-  linEq.matrix[7][9]=d->xpowsum[1][1];
-  
-  linEq.matrix[8][8]=d->xpowsum[2][2];
-  linEq.matrix[8][9]=d->xpowsum[2][1];
-      
-  linEq.matrix[9][9]=d->xpowsum[0][0];//bottom right entry
-  
-  //mirror the matrix (top right half mirrored to bottom left half)
-  for(i=1;i<linEq.dim;i++)
-    for(j=0;j<i;j++)
-      linEq.matrix[i][j]=linEq.matrix[j][i];
-  
-  for(i=0;i<3;i++)
-    linEq.vector[i]=d->mxpowsum[i][2];
-  linEq.vector[3]=d->mxxpowsum[0][1][1][1];
-  linEq.vector[4]=d->mxxpowsum[0][1][2][1];
-  linEq.vector[5]=d->mxxpowsum[1][1][2][1];
-  for(i=6;i<9;i++)
-    linEq.vector[i]=d->mxpowsum[i-6][1];
-  linEq.vector[9]=d->msum;
+  buildNormalEq(p,d,&linEq);
     
 	//solve system of equations and assign values
-	if(!(solve_lin_eq(&linEq)==1))
+	if(!(solveNormalEq(p,fr,&linEq)==1))
 		{
 			printf("ERROR: Could not determine fit parameters (3parpoly2).\n");
 			printf("Perhaps there are not enough data points to perform a fit?\n");
@@ -336,19 +227,9 @@ void fit3Par(const parameters * p, const data * d, fit_results * fr, plot_data *
   //save fit parameters  
   for(i=0;i<linEq.dim;i++)
     fr->a[i]=linEq.solution[i];
-  //refit filter  
-  if(p->refitFilter==1)
-    {
-      refitFilter2Par(p,d,fr,pd,p->refitFilterDist);
-      return;
-    }
-  long double f;
-  fr->chisq=0;
-  for(i=0;i<d->lines;i++)//loop over data points for chisq
-    {
-      f=fr->a[0]*d->x[0][i]*d->x[0][i] + fr->a[1]*d->x[1][i]*d->x[1][i] + fr->a[2]*d->x[2][i]*d->x[2][i] + fr->a[3]*d->x[0][i]*d->x[1][i] + fr->a[4]*d->x[0][i]*d->x[2][i] + fr->a[5]*d->x[1][i]*d->x[2][i] + fr->a[6]*d->x[0][i] + fr->a[7]*d->x[1][i] + fr->a[8]*d->x[2][i] + fr->a[9];
-      fr->chisq+=(d->x[3][i] - f)*(d->x[3][i] - f)/(d->x[3+1][i]*d->x[3+1][i]);
-    }
+  residual_stats_type rs;
+  getResiduals(p,d,fr,&rs,NULL); //see residuals.c
+  fr->chisq=rs.chisq;
   //Calculate covariances and uncertainties, see J. Wolberg 
   //'Data Analysis Using the Method of Least Squares' sec 2.5
   for(i=0;i<linEq.dim;i++)
@@ -394,48 +275,5 @@ void fit3Par(const parameters * p, const data * d, fit_results * fr, plot_data *
   if(print==1)
 		print3Par(d,p,fr);
 		
-	if((p->plotData==1)&&(p->verbose<1))
-		{
-			preparePlotData(d,p,fr,pd);
-			plotForm3Par(p,fr,pd);
-			plotData(p,fr,pd);
-		}
   
 }
-
-//generate a new data set and refit
-void refitFilter3Par(const parameters * p, const data * d, fit_results * fr, plot_data * pd, long double distance){
-  int i,j;
-
-  //generate a new data set containing only filtered data
-  data *nd=(data*)calloc(1,sizeof(data));
-  parameters *np=(parameters*)calloc(1,sizeof(parameters));
-  memcpy(np,p,sizeof(parameters));
-  np->refitFilter=0;
-  nd->lines=0;
-
-  for (i=0;i<d->lines;i++){
-    long double diff = fabs(d->x[p->numVar][i] - eval3Par(d->x[0][i],d->x[1][i],d->x[2][i],fr));
-    if(diff<=distance){
-      //keep this data point (remember to copy weight as well)
-      for(j=0;j<=p->numVar+1;j++)
-        nd->x[j][nd->lines] = d->x[j][i];
-      nd->lines++;
-    }
-  }
-
-  nd->max_m=d->max_m;
-  nd->min_m=d->min_m;
-  for(i=0;i<p->numVar;i++)
-    nd->max_x[i]=d->max_x[i];
-
-  if(p->verbose<1)
-    printf("\nRefit filter: %i of %i data point(s) retained.\n",nd->lines,d->lines);
-  //printDataInfo(nd,np); //see print_data_info.c
-
-  generateSums(nd,np); //construct sums for fitting (see generate_sums.c)
-  fit3Par(np,nd,fr,pd,1);
-
-  free(nd);
-  free(np);
-}
@@ -0,0 +1,227 @@
+//evaluation of the fit function at a (possibly very large) list of query
+//points after fitting (EVAL_POINTS option)
+//points are read and evaluated in batches (see fit_eval_batch.c), and for
+//fit functions linear in their coefficients the confidence band of the fit
+//at each point is found from the covariance matrix of the coefficients,
+//f(x) +/- sqrt(delta*var(f(x))), with var(f(x)) = b(x)^T*C*b(x) for basis
+//function values b(x) and delta for a single degree of freedom (ie. the
+//band at each point separately, at the level set by SET_CI_SIGMA or the delta
+//set by SET_CI_DELTA)
+
+//writes a value to buf in the same format as printf's %.9E, without the
+//overhead of printf (which dominates the time taken to write millions of
+//values)
+//returns the number of characters written
+int formatEvalVal(char * buf, double v)
+{
+  static const double pow10[23]={1E0,1E1,1E2,1E3,1E4,1E5,1E6,1E7,1E8,1E9,1E10,1E11,
+                                  1E12,1E13,1E14,1E15,1E16,1E17,1E18,1E19,1E20,1E21,1E22};
+  int i,e,k,len;
+  unsigned long long m;
+  double s;
+
+  if((v!=v)||(v==INFINITY)||(v==-INFINITY))
+    return sprintf(buf,"%.9E",v);
+  len=0;
+  if(signbit(v))
+    {
+      buf[len++]='-';
+      v=-v;
+    }
+  if(v==0.)
+    {
+      memcpy(buf+len,"0.000000000E+00",15);
+      return len+15;
+    }
+
+  //scale the value to 10 digits before the decimal point, using exactly
+  //representable powers of 10 so that only a single rounding occurs
+  e=(int)floor(log10(v));
+  k=9-e;
+  if((k<-22)||(k>22))
+    return len + sprintf(buf+len,"%.9E",v);
+  s=(k>=0) ? v*pow10[k] : v/pow10[-k];
+  if(s<1.0E9)//log10 rounded up
+    {
+      e--;
+      k++;
+      if(k>22)
+        return len + sprintf(buf+len,"%.9E",v);
+      s=(k>=0) ? v*pow10[k] : v/pow10[-k];
+    }
+  if(fabs(s - floor(s) - 0.5)<1.0E-5)//too close to halfway between two digits to round reliably
+    return len + sprintf(buf+len,"%.9E",v);
+  m=(unsigned long long)llround(s);
+  if(m>=10000000000ULL)//log10 rounded down, or rounding carried into another digit
+    {
+      m=(m+5)/10;
+      e++;
+    }
+
+  for(i=10;i>=2;i--)
+    {
+      buf[len+i]='0'+(char)(m%10);
+      m/=10;
+    }
+  buf[len]='0'+(char)m;
+  buf[len+1]='.';
+  len+=11;
+  buf[len++]='E';
+  buf[len++]=(e<0) ? '-' : '+';
+  if(e<0)
+    e=-e;
+  if(e>=100)
+    buf[len++]='0'+(char)(e/100);
+  buf[len++]='0'+(char)((e/10)%10);
+  buf[len++]='0'+(char)(e%10);
+  return len;
+}
+
+//reads the query points, evaluates the fit function at each of them, and
+//writes the results (one line per point: the variable values, fit value,
+//and the lower and upper pointwise confidence band)
+void evalPoints(const parameters * p, const fit_results * fr)
+{
+  int i,j,k,n,numBasis;
+  char str[1024];
+  char *pos,*end;
+  long double x[POWSIZE],basis[MAX_DIM];
+  double bd[MAX_DIM],cv[MAX_DIM][MAX_DIM];
+  double var,hw;
+  long long numPts=0;
+  long long numInvalid=0;
+
+  //the confidence band is only available for fit functions linear in their
+  //coefficients, with uncertainties from the fit
+  int band=((p->model->linearCoeff==1)&&(fr->ndf>0));
+  for(i=0;i<MAX_DIM;i++)
+    for(j=0;j<MAX_DIM;j++)
+      cv[i][j]=(double)fr->covar[i][j];
+
+  FILE *inp,*out;
+  if(strcmp(p->evalPointsFile,"-")==0)
+    inp=stdin;
+  else if((inp=fopen(p->evalPointsFile,"r"))==NULL)
+    {
+      printf("ERROR: query point file %s can not be opened.\n",p->evalPointsFile);
+      exit(-1);
+    }
+  if(strcmp(p->evalOutFile,"-")==0)
+    {
+      fflush(stdout);
+      out=stdout;
+    }
+  else if((out=fopen(p->evalOutFile,"w"))==NULL)
+    {
+      printf("ERROR: evaluated point output file %s can not be opened.\n",p->evalOutFile);
+      exit(-1);
+    }
+
+  double *col[POWSIZE];
+  for(k=0;k<p->numVar;k++)
+    col[k]=(double*)malloc(EVAL_BATCH_SIZE*sizeof(double));
+  double *f=(double*)malloc(EVAL_BATCH_SIZE*sizeof(double));
+  //output buffer, with room for each value (at most 17 characters) and a separator
+  char *buf=(char*)malloc((size_t)EVAL_BATCH_SIZE*(p->numVar+3)*18 + 1);
+  int len;
+
+  fprintf(out,"#");
+  for(k=0;k<p->numVar;k++)
+    fprintf(out," par%i",k+1);
+  if(band)
+    fprintf(out," value lower_pointwise upper_pointwise\n");
+  else
+    fprintf(out," value\n");
+
+  int done=0;
+  while(done==0)
+    {
+      //read a batch of points
+      n=0;
+      while(n<EVAL_BATCH_SIZE)
+        {
+          if(fgets(str,1024,inp)==NULL)
+            {
+              done=1;
+              break;
+            }
+          pos=str;
+          while((*pos==' ')||(*pos=='\t'))
+            pos++;
+          if((*pos=='#')||(*pos=='\n')||(*pos=='\r')||(*pos=='\0'))
+            continue;//comment or blank line
+          for(k=0;k<p->numVar;k++)
+            {
+              col[k][n]=strtod(pos,&end);
+              if(end==pos)
+                break;
+              pos=end;
+            }
+          if(k<p->numVar)
+            {
+              numInvalid++;
+              continue;
+            }
+          n++;
+        }
+      if(n==0)
+        continue;
+
+      //evaluate the fit function
+      p->model->evalBatchDouble(p,fr,(const double * const *)col,n,f);
+
+      //write the results
+      len=0;
+      for(i=0;i<n;i++)
+        {
+          for(k=0;k<p->numVar;k++)
+            {
+              len+=formatEvalVal(buf+len,col[k][i]);
+              buf[len++]=' ';
+            }
+          len+=formatEvalVal(buf+len,f[i]);
+          if(band)
+            {
+              for(k=0;k<p->numVar;k++)
+                x[k]=col[k][i];
+              numBasis=getFitBasis(p,x,basis);
+              for(j=0;j<numBasis;j++)
+                bd[j]=(double)basis[j];
+              var=0.;
+              for(j=0;j<numBasis;j++)
+                for(k=0;k<numBasis;k++)
+                  var+=bd[j]*cv[j][k]*bd[k];
+              hw=(var>0.) ? sqrt((double)p->ciBandDelta*var) : 0.;
+              buf[len++]=' ';
+              len+=formatEvalVal(buf+len,f[i]-hw);
+              buf[len++]=' ';
+              len+=formatEvalVal(buf+len,f[i]+hw);
+            }
+          buf[len++]='\n';
+        }
+      fwrite(buf,1,len,out);
+      numPts+=n;
+    }
+
+  for(k=0;k<p->numVar;k++)
+    free(col[k]);
+  free(f);
+  free(buf);
+  if(inp!=stdin)
+    fclose(inp);
+  if(out!=stdout)
+    fclose(out);
+  else
+    fflush(stdout);
+
+  if((p->verbose<1)&&(out!=stdout))
+    {
+      printf("\nFit evaluated at %lli point(s), written to: %s\n",numPts,p->evalOutFile);
+      if(band)
+        printf("Pointwise confidence band (each point separately, for 1 degree of freedom, delta=%0.3LE) given at the %s level.\n",p->ciBandDelta,p->ciSigmaDesc);
+      else
+        printf("Confidence band not available for the %s fit type.\n",p->fitType);
+    }
+  if(numInvalid>0)
+    printf("WARNING: %lli line(s) of the query point file could not be read (each line must contain %i value(s)).\n",numInvalid,p->numVar);
+}
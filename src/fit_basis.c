@@ -0,0 +1,29 @@
+//gets the values of the basis functions (the terms multiplied by each fit
+//coefficient) of the fit function at the specified point, in the same order
+//as the fit coefficients (fr->a)
+//x: array of variable values at the point (indexed by variable #)
+//basis: array to store the basis function values in (length of at least MAX_DIM)
+//returns the number of basis functions, or 0 if the fit function is not
+//linear in its coefficients (eg. Deming regression)
+int getFitBasis(const parameters * p, const long double * x, long double * basis)
+{
+  if(p->model->linearCoeff==0)
+    return 0;
+  return evalPolyBasis(&p->basis,x,basis); //see poly_basis.c
+}
+
+//copies the variable values of the specified data point into an array
+//(for use with getFitBasis)
+void getDataPoint(const data * d, const parameters * p, int ind, long double * x)
+{
+  int i;
+  for(i=0;i<p->numVar;i++)
+    x[i]=d->x[i][ind];
+}
+
+//evaluates the fit function at the specified point
+//x: array of variable values at the point (indexed by variable #)
+long double evalFit(const parameters * p, const fit_results * fr, const long double * x)
+{
+  return p->model->eval(p,fr,x); //see fit_models.c
+}
@@ -0,0 +1,153 @@
+//evaluation of the fit function of each fit type at many points at once
+//points are given as columns of variable values (x[variable #][point #]),
+//and the fit functions are evaluated in nested (Horner) form, which needs
+//fewer multiplications than the term by term form used for single points
+//the long double versions are used wherever the result feeds back into the
+//fit (eg. residuals), the double versions (eg. for plotting) are written so
+//that the compiler can vectorize them, see SIMD_CLONES in gridlock.h
+
+void evalLinBatch(const parameters * p, const fit_results * fr, const long double * const * x, int n, long double * f)
+{
+  int i;
+  const long double *xc=x[0];
+  for(i=0;i<n;i++)
+    f[i]=fr->a[0]*xc[i] + fr->a[1];
+}
+SIMD_CLONES void evalLinBatchDouble(const parameters * p, const fit_results * fr, const double * const * x, int n, double * restrict f)
+{
+  int i;
+  const double * restrict xc=x[0];
+  double a0=(double)fr->a[0],a1=(double)fr->a[1];
+  for(i=0;i<n;i++)
+    f[i]=a0*xc[i] + a1;
+}
+
+void eval1ParBatch(const parameters * p, const fit_results * fr, const long double * const * x, int n, long double * f)
+{
+  int i;
+  const long double *xc=x[0];
+  for(i=0;i<n;i++)
+    f[i]=(fr->a[0]*xc[i] + fr->a[1])*xc[i] + fr->a[2];
+}
+SIMD_CLONES void eval1ParBatchDouble(const parameters * p, const fit_results * fr, const double * const * x, int n, double * restrict f)
+{
+  int i;
+  const double * restrict xc=x[0];
+  double a0=(double)fr->a[0],a1=(double)fr->a[1],a2=(double)fr->a[2];
+  for(i=0;i<n;i++)
+    f[i]=(a0*xc[i] + a1)*xc[i] + a2;
+}
+
+void evalPoly3Batch(const parameters * p, const fit_results * fr, const long double * const * x, int n, long double * f)
+{
+  int i;
+  const long double *xc=x[0];
+  for(i=0;i<n;i++)
+    f[i]=((fr->a[0]*xc[i] + fr->a[1])*xc[i] + fr->a[2])*xc[i] + fr->a[3];
+}
+SIMD_CLONES void evalPoly3BatchDouble(const parameters * p, const fit_results * fr, const double * const * x, int n, double * restrict f)
+{
+  int i;
+  const double * restrict xc=x[0];
+  double a0=(double)fr->a[0],a1=(double)fr->a[1],a2=(double)fr->a[2],a3=(double)fr->a[3];
+  for(i=0;i<n;i++)
+    f[i]=((a0*xc[i] + a1)*xc[i] + a2)*xc[i] + a3;
+}
+
+void evalPoly4Batch(const parameters * p, const fit_results * fr, const long double * const * x, int n, long double * f)
+{
+  int i;
+  const long double *xc=x[0];
+  for(i=0;i<n;i++)
+    f[i]=(((fr->a[0]*xc[i] + fr->a[1])*xc[i] + fr->a[2])*xc[i] + fr->a[3])*xc[i] + fr->a[4];
+}
+SIMD_CLONES void evalPoly4BatchDouble(const parameters * p, const fit_results * fr, const double * const * x, int n, double * restrict f)
+{
+  int i;
+  const double * restrict xc=x[0];
+  double a0=(double)fr->a[0],a1=(double)fr->a[1],a2=(double)fr->a[2],a3=(double)fr->a[3],a4=(double)fr->a[4];
+  for(i=0;i<n;i++)
+    f[i]=(((a0*xc[i] + a1)*xc[i] + a2)*xc[i] + a3)*xc[i] + a4;
+}
+
+//f(x,y) = x*(a0*x + a2*y + a3) + y*(a1*y + a4) + a5
+void eval2ParBatch(const parameters * p, const fit_results * fr, const long double * const * x, int n, long double * f)
+{
+  int i;
+  const long double *xc=x[0];
+  const long double *yc=x[1];
+  for(i=0;i<n;i++)
+    f[i]=xc[i]*(fr->a[0]*xc[i] + fr->a[2]*yc[i] + fr->a[3]) + yc[i]*(fr->a[1]*yc[i] + fr->a[4]) + fr->a[5];
+}
+SIMD_CLONES void eval2ParBatchDouble(const parameters * p, const fit_results * fr, const double * const * x, int n, double * restrict f)
+{
+  int i;
+  const double * restrict xc=x[0];
+  const double * restrict yc=x[1];
+  double a[6];
+  for(i=0;i<6;i++)
+    a[i]=(double)fr->a[i];
+  for(i=0;i<n;i++)
+    f[i]=xc[i]*(a[0]*xc[i] + a[2]*yc[i] + a[3]) + yc[i]*(a[1]*yc[i] + a[4]) + a[5];
+}
+
+//f(x,y) = x*(x*(a0*x + a2*y + a4) + y*(a3*y + a6) + a7) + y*(y*(a1*y + a5) + a8) + a9
+void eval2ParPoly3Batch(const parameters * p, const fit_results * fr, const long double * const * x, int n, long double * f)
+{
+  int i;
+  const long double *xc=x[0];
+  const long double *yc=x[1];
+  for(i=0;i<n;i++)
+    f[i]=xc[i]*(xc[i]*(fr->a[0]*xc[i] + fr->a[2]*yc[i] + fr->a[4]) + yc[i]*(fr->a[3]*yc[i] + fr->a[6]) + fr->a[7])
+        + yc[i]*(yc[i]*(fr->a[1]*yc[i] + fr->a[5]) + fr->a[8]) + fr->a[9];
+}
+SIMD_CLONES void eval2ParPoly3BatchDouble(const parameters * p, const fit_results * fr, const double * const * x, int n, double * restrict f)
+{
+  int i;
+  const double * restrict xc=x[0];
+  const double * restrict yc=x[1];
+  double a[10];
+  for(i=0;i<10;i++)
+    a[i]=(double)fr->a[i];
+  for(i=0;i<n;i++)
+    f[i]=xc[i]*(xc[i]*(a[0]*xc[i] + a[2]*yc[i] + a[4]) + yc[i]*(a[3]*yc[i] + a[6]) + a[7])
+        + yc[i]*(yc[i]*(a[1]*yc[i] + a[5]) + a[8]) + a[9];
+}
+
+//f(x,y,z) = x*(a0*x + a3*y + a4*z + a6) + y*(a1*y + a5*z + a7) + z*(a2*z + a8) + a9
+void eval3ParBatch(const parameters * p, const fit_results * fr, const long double * const * x, int n, long double * f)
+{
+  int i;
+  const long double *xc=x[0];
+  const long double *yc=x[1];
+  const long double *zc=x[2];
+  for(i=0;i<n;i++)
+    f[i]=xc[i]*(fr->a[0]*xc[i] + fr->a[3]*yc[i] + fr->a[4]*zc[i] + fr->a[6])
+        + yc[i]*(fr->a[1]*yc[i] + fr->a[5]*zc[i] + fr->a[7])
+        + zc[i]*(fr->a[2]*zc[i] + fr->a[8]) + fr->a[9];
+}
+SIMD_CLONES void eval3ParBatchDouble(const parameters * p, const fit_results * fr, const double * const * x, int n, double * restrict f)
+{
+  int i;
+  const double * restrict xc=x[0];
+  const double * restrict yc=x[1];
+  const double * restrict zc=x[2];
+  double a[10];
+  for(i=0;i<10;i++)
+    a[i]=(double)fr->a[i];
+  for(i=0;i<n;i++)
+    f[i]=xc[i]*(a[0]*xc[i] + a[3]*yc[i] + a[4]*zc[i] + a[6])
+        + yc[i]*(a[1]*yc[i] + a[5]*zc[i] + a[7])
+        + zc[i]*(a[2]*zc[i] + a[8]) + a[9];
+}
+
+//evaluates the fit function at every data point
+//f: array of (at least) d->lines values
+void evalFitAtData(const parameters * p, const data * d, const fit_results * fr, long double * f)
+{
+  int k;
+  const long double *col[POWSIZE];
+  for(k=0;k<p->numVar;k++)
+    col[k]=d->x[k];
+  p->model->evalBatch(p,fr,col,d->lines,f);
+}
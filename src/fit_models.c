@@ -0,0 +1,113 @@
+//table of fit models (fit types), describing the fit function of each fit
+//type and the routines used to fit and evaluate it
+//the model is looked up from the fit type once, when the data file is read
+//(see getFitModel), and is used wherever the behaviour depends on the fit
+//type, so that adding a fit type only needs a fit routine and an entry here
+
+//evaluate the fit function of each fit type at the specified point, with a
+//common signature
+long double evalFitLin(const parameters * p, const fit_results * fr, const long double * x)
+{
+  return evalLin(x[0],fr);
+}
+long double evalFit1Par(const parameters * p, const fit_results * fr, const long double * x)
+{
+  return eval1Par(x[0],fr);
+}
+long double evalFitPoly3(const parameters * p, const fit_results * fr, const long double * x)
+{
+  return evalPoly3(x[0],fr);
+}
+long double evalFitPoly4(const parameters * p, const fit_results * fr, const long double * x)
+{
+  return evalPoly4(x[0],fr);
+}
+long double evalFit2Par(const parameters * p, const fit_results * fr, const long double * x)
+{
+  return eval2Par(x[0],x[1],fr);
+}
+long double evalFit2ParPoly3(const parameters * p, const fit_results * fr, const long double * x)
+{
+  return eval2ParPoly3(x[0],x[1],fr);
+}
+long double evalFit3Par(const parameters * p, const fit_results * fr, const long double * x)
+{
+  return eval3Par(x[0],x[1],x[2],fr);
+}
+
+//set the functional forms of the plotted fit function of each fit type, with
+//a common signature
+void plotFormLinModel(const parameters * p, fit_results * fr, const plot_data * pd)
+{
+  plotFormLin(p,fr);
+}
+void plotFormLinDemingModel(const parameters * p, fit_results * fr, const plot_data * pd)
+{
+  plotFormLinDeming(p,fr);
+}
+void plotForm1ParModel(const parameters * p, fit_results * fr, const plot_data * pd)
+{
+  plotForm1Par(p,fr);
+}
+void plotFormPoly3Model(const parameters * p, fit_results * fr, const plot_data * pd)
+{
+  plotFormPoly3(p,fr);
+}
+void plotFormPoly4Model(const parameters * p, fit_results * fr, const plot_data * pd)
+{
+  plotFormPoly4(p,fr);
+}
+
+//evaluates the fit function at n points, given as columns of variable values
+//(x[variable #][point #]), using the model's single point evaluation
+//used for fit types without batch evaluation routines of their own
+void evalFitBatch(const parameters * p, const fit_results * fr, const long double * const * x, int n, long double * f)
+{
+  int i,k;
+  long double pt[POWSIZE];
+  for(i=0;i<n;i++)
+    {
+      for(k=0;k<p->numVar;k++)
+        pt[k]=x[k][i];
+      f[i]=p->model->eval(p,fr,pt);
+    }
+}
+void evalFitBatchDouble(const parameters * p, const fit_results * fr, const double * const * x, int n, double * f)
+{
+  int i,k;
+  long double pt[POWSIZE];
+  for(i=0;i<n;i++)
+    {
+      for(k=0;k<p->numVar;k++)
+        pt[k]=x[k][i];
+      f[i]=(double)p->model->eval(p,fr,pt);
+    }
+}
+
+const fit_model_type fitModels[]=
+{
+  //name, # of variables, # of coefficients, terms, linear in coefficients, plot confidence bands, mark vertex on 3d plots, evaluation, batch evaluation (long double, double), fit routine, plotted functional form
+  {"lin",1,2,linTerms,1,1,0,evalFitLin,evalLinBatch,evalLinBatchDouble,fitLin,plotFormLinModel},//see linfit.c
+  {"lin_deming",1,2,linTerms,0,0,0,evalFitLin,evalLinBatch,evalLinBatchDouble,fitLinDeming,plotFormLinDemingModel},//see linfit_deming.c
+  {"poly2",1,3,poly2Terms,1,0,0,evalFit1Par,eval1ParBatch,eval1ParBatchDouble,fit1Par,plotForm1ParModel},//see poly2fit.c
+  {"poly3",1,4,poly3Terms,1,0,0,evalFitPoly3,evalPoly3Batch,evalPoly3BatchDouble,fitPoly3,plotFormPoly3Model},//see poly3fit.c
+  {"poly4",1,5,poly4Terms,1,0,0,evalFitPoly4,evalPoly4Batch,evalPoly4BatchDouble,fitPoly4,plotFormPoly4Model},//see poly4fit.c
+  {"2parpoly2",2,6,par2Poly2Terms,1,0,0,evalFit2Par,eval2ParBatch,eval2ParBatchDouble,fit2Par,plotForm2Par},//see 2parpoly2fit.c
+  {"2parpoly3",2,10,par2Poly3Terms,1,0,0,evalFit2ParPoly3,eval2ParPoly3Batch,eval2ParPoly3BatchDouble,fit2ParPoly3,plotForm2ParPoly3},//see 2parpoly3fit.c
+  {"3parpoly2",3,10,par3Poly2Terms,1,0,1,evalFit3Par,eval3ParBatch,eval3ParBatchDouble,fit3Par,plotForm3Par},//see 3parpoly2fit.c
+  //fit types of the form NparpolyD, or user-defined terms (FIT_TERMS option), see nparpolyfit.c
+  //the terms are set up (and the fit type validated) by setPolyBasis
+  {"NparpolyD",0,0,NULL,1,0,0,evalNParPoly,evalFitBatch,evalFitBatchDouble,fitNParPoly,NULL}
+};
+#define NUM_FIT_MODELS (int)(sizeof(fitModels)/sizeof(fit_model_type))
+
+//gets the model for the specified fit type
+//fit types without an entry of their own use the general polynomial model
+const fit_model_type * getFitModel(const char * fitType)
+{
+  int i;
+  for(i=0;i<NUM_FIT_MODELS-1;i++)
+    if(strcmp(fitType,fitModels[i].name)==0)
+      return &fitModels[i];
+  return &fitModels[NUM_FIT_MODELS-1];
+}
@@ -1,65 +1,279 @@
-//generates the sums that will be used when fitting
-void generateSums(data * d,const parameters * p)
+//gets the number of data points which contribute to the sums used when
+//fitting, for the degrees of freedom of the fit (data points given zero
+//robust weight are left out, see robust_fit.c)
+int getNumFitLines(const data * d)
+{
+  int i;
+  int n=d->lines;
+  if(d->robustWt!=NULL)
+    for(i=0;i<d->lines;i++)
+      n-=(d->robustWt[i]<=0.);
+  return n;
+}
+
+//adds the contribution of a single data point to the sums used when fitting
+//(the moment table of the fit function basis, see poly_basis.c)
+//the data point is weighted by its data weight, and its robust weight if any
+//i: index of the data point
+//sign: 1 to add the data point to the sums, -1 to remove it
+void addPointToSums(data * d,const parameters * p,int i,int sign)
 {
 
   //indicies
-  int i,j,k,l,m,n,o,q;
+  int j,k;
+  const poly_basis_type * b=&p->basis;
 
   //128-bit: high precision needed for intermediate calculations
+  __float128 xPow[POWSIZE][2*MAX_DIM];//powers of each variable
   __float128 powVal=0.0L;
   __float128 w=1.0L;
   
-  //initialize sums (in case this function is called more than once)
-	d->msum=0.0L;
-  memset(d->xpowsum,0,POWSIZE*POWSIZE*sizeof(long double));
-  memset(d->mxpowsum,0,POWSIZE*POWSIZE*sizeof(long double));
-  memset(d->mxxpowsum,0,POWSIZE*POWSIZE*POWSIZE*POWSIZE*sizeof(long double));
-  memset(d->xxpowsum,0,POWSIZE*POWSIZE*POWSIZE*POWSIZE*sizeof(long double));
-  memset(d->xxxpowsum,0,POWSIZE*POWSIZE*POWSIZE*POWSIZE*POWSIZE*POWSIZE*sizeof(long double));
+  w=d->x[p->numVar+1][i]*d->x[p->numVar+1][i];
+  if(d->robustWt!=NULL)
+    {
+      if(d->robustWt[i]<=0.)
+        return;//data point has no weight in the fit
+      w=w/d->robustWt[i];
+    }
+  if(sign<0)
+    w=-1.0L*w;//subtract the contributions of this data point
   
-  for(i=0;i<d->lines;i++)//loop over data points
+  if(b->pairMoments==1)
+    {
+      //moments are products of pairs of terms
+      long double basis[MAX_DIM];
+      evalPolyBasisAtData(b,d,i,basis); //see poly_basis.c
+      for(k=0;k<b->numMoments;k++)//loop over moments
+        {
+          powVal=basis[b->momentTerm[k][0]];
+          if(b->momentTerm[k][1]>=0)
+            powVal=powVal*basis[b->momentTerm[k][1]];
+          d->moment[k] += powVal/w;
+          if(k<b->numTermMoments)
+            d->mMoment[k] += d->x[p->numVar][i]*powVal/w;
+        }
+      return;
+    }
+  
+  for(j=0;j<b->numVar;j++)//loop over free parameters
+    {
+      xPow[j][0]=1.0L;
+      for(k=1;k<=b->maxPow;k++)//loop over powers
+        xPow[j][k]=xPow[j][k-1]*d->x[j][i];
+    }
+  
+  for(k=0;k<b->numMoments;k++)//loop over moments
+    {
+      powVal=1.0L;
+      for(j=0;j<b->numVar;j++)
+        if(b->momentPow[k][j]>0)
+          powVal=powVal*xPow[j][b->momentPow[k][j]];
+      d->moment[k] += powVal/w;
+      if(k<b->numTermMoments)
+        d->mMoment[k] += d->x[p->numVar][i]*powVal/w;
+    }
+    
+}
+
+//adds the contributions of a batch of consecutive data points to the sums,
+//for a basis where each product of terms is a separate moment
+//the terms (columns of the design matrix) are evaluated over the whole batch,
+//and the products of each pair of columns accumulated in turn (a blocked
+//update of the Gram matrix)
+//terms in mapped variables (FIT_BASIS option) are of order 1 and keep the
+//equations well conditioned, so their sums are accumulated at the regular
+//precision
+//start: index of the first data point
+//n: number of data points (at most SUMS_BATCH_SIZE)
+void addBatchToSums(data * d,const parameters * p,int start,int n)
+{
+  
+  int i,k,t1,t2;
+  const poly_basis_type * b=&p->basis;
+  long double col[MAX_DIM][SUMS_BATCH_SIZE];//term values
+  long double wInv[SUMS_BATCH_SIZE],mwInv[SUMS_BATCH_SIZE];//inverse weights, data values times inverse weights
+  
+  //128-bit: high precision needed for intermediate calculations
+  __float128 sum,mSum;
+  long double lSum,lmSum;
+  
+  evalPolyBasisBatch(b,d,start,n,col); //see poly_basis.c
+  for(i=0;i<n;i++)
+    {
+      wInv[i]=1.0L/(d->x[p->numVar+1][start+i]*d->x[p->numVar+1][start+i]);
+      if(d->robustWt!=NULL)
+        wInv[i]*=d->robustWt[start+i];
+      mwInv[i]=d->x[p->numVar][start+i]*wInv[i];
+    }
+  
+  for(k=0;k<b->numMoments;k++)//loop over moments
+    {
+      t1=b->momentTerm[k][0];
+      t2=b->momentTerm[k][1];
+      if(b->mapBasis>0)
+        {
+          lSum=0.0L;
+          lmSum=0.0L;
+          if(t2<0)
+            for(i=0;i<n;i++)
+              {
+                lSum += col[t1][i]*wInv[i];
+                lmSum += col[t1][i]*mwInv[i];
+              }
+          else
+            for(i=0;i<n;i++)
+              lSum += col[t1][i]*col[t2][i]*wInv[i];
+          d->moment[k] += lSum;
+          if(k<b->numTermMoments)
+            d->mMoment[k] += lmSum;
+          continue;
+        }
+      sum=0.0L;
+      mSum=0.0L;
+      if(t2<0)
+        for(i=0;i<n;i++)
+          {
+            sum += (__float128)col[t1][i]*wInv[i];
+            mSum += (__float128)col[t1][i]*mwInv[i];
+          }
+      else
+        for(i=0;i<n;i++)
+          sum += (__float128)col[t1][i]*col[t2][i]*wInv[i];
+      d->moment[k] += sum;
+      if(k<b->numTermMoments)
+        d->mMoment[k] += mSum;
+    }
+  
+}
+
+//generates the sums in double precision, which is much faster than the full
+//precision path but only accurate enough for well conditioned fits
+void generateSumsDouble(data * d,const parameters * p)
+{
+  
+  int i,j,k,l,n,t1,t2;
+  const poly_basis_type * b=&p->basis;
+  double sum[MAX_MOMENTS],mSum[MAX_MOMENTS];
+  double wInv[SUMS_BATCH_SIZE],mwInv[SUMS_BATCH_SIZE];//inverse weights, data values times inverse weights
+  
+  memset(sum,0,sizeof(sum));
+  memset(mSum,0,sizeof(mSum));
+  
+  if(b->pairMoments==1)
     {
-    	w=d->x[p->numVar+1][i]*d->x[p->numVar+1][i];
-      d->msum+=d->x[p->numVar][i]/w;
-      for(j=0;j<p->numVar;j++)//loop over free parameters
+      long double col[MAX_DIM][SUMS_BATCH_SIZE];//term values
+      double dcol[MAX_DIM][SUMS_BATCH_SIZE];
+      for(i=0;i<d->lines;i+=SUMS_BATCH_SIZE)//loop over batches of data points
         {
-          powVal=1.0L;
-          for(k=0;k<6;k++)//loop over powers
+          n=(d->lines-i < SUMS_BATCH_SIZE) ? d->lines-i : SUMS_BATCH_SIZE;
+          evalPolyBasisBatch(b,d,i,n,col); //see poly_basis.c
+          for(j=0;j<b->numTerms;j++)
+            for(l=0;l<n;l++)
+              dcol[j][l]=(double)col[j][l];
+          for(l=0;l<n;l++)
+            {
+              wInv[l]=1.0/(double)(d->x[p->numVar+1][i+l]*d->x[p->numVar+1][i+l]);
+              if(d->robustWt!=NULL)
+                wInv[l]*=d->robustWt[i+l];
+              mwInv[l]=(double)d->x[p->numVar][i+l]*wInv[l];
+            }
+          for(k=0;k<b->numMoments;k++)//loop over moments
             {
-              d->xpowsum[j][k] += powVal/w;
-              d->mxpowsum[j][k] += d->x[p->numVar][i]*powVal/w;
-              powVal=powVal*d->x[j][i];
+              t1=b->momentTerm[k][0];
+              t2=b->momentTerm[k][1];
+              if(t2<0)
+                for(l=0;l<n;l++)
+                  {
+                    sum[k] += dcol[t1][l]*wInv[l];
+                    mSum[k] += dcol[t1][l]*mwInv[l];
+                  }
+              else
+                for(l=0;l<n;l++)
+                  sum[k] += dcol[t1][l]*dcol[t2][l]*wInv[l];
             }
-            
-          for(k=0;k<p->numVar;k++)//loop over free parameters
-            for(l=0;l<6;l++)//loop over powers (corresponding to parameter indexed by j)
-              for(m=0;m<6;m++)//loop over powers (corresponding to parameter indexed by k)
-                {
-                  powVal=1.0L;
-                  for(q=0;q<l;q++)
-                    powVal=powVal*d->x[j][i];
-                  for(q=0;q<m;q++)
-                    powVal=powVal*d->x[k][i];
-                  d->xxpowsum[j][l][k][m] += powVal/w;
-                  d->mxxpowsum[j][l][k][m] += d->x[p->numVar][i]*powVal/w;
-                }
-          
-          for(k=0;k<p->numVar;k++)//loop over free parameters
-            for(l=0;l<p->numVar;l++)//loop over free parameters
-              for(m=0;m<3;m++)//loop over powers (corresponding to parameter indexed by j)
-                for(n=0;n<3;n++)//loop over powers (corresponding to parameter indexed by k)
-                  for(o=0;o<3;o++)//loop over powers (corresponding to parameter indexed by l)
-                    {
-                      powVal=1.0L;
-                      for(q=0;q<m;q++)
-                        powVal=powVal*d->x[j][i];
-                      for(q=0;q<n;q++)
-                        powVal=powVal*d->x[k][i];
-                      for(q=0;q<o;q++)
-                        powVal=powVal*d->x[l][i];
-                      d->xxxpowsum[j][m][k][n][l][o] += powVal/w;         
-                    }
         }
     }
+  else
+    {
+      double xPow[POWSIZE][2*MAX_DIM];//powers of each variable
+      double powVal,w,m;
+      for(i=0;i<d->lines;i++)//loop over data points
+        {
+          w=1.0/(double)(d->x[p->numVar+1][i]*d->x[p->numVar+1][i]);
+          if(d->robustWt!=NULL)
+            w*=d->robustWt[i];
+          m=(double)d->x[p->numVar][i];
+          for(j=0;j<b->numVar;j++)//loop over free parameters
+            {
+              xPow[j][0]=1.0;
+              for(k=1;k<=b->maxPow;k++)//loop over powers
+                xPow[j][k]=xPow[j][k-1]*(double)d->x[j][i];
+            }
+          for(k=0;k<b->numMoments;k++)//loop over moments
+            {
+              powVal=w;
+              for(j=0;j<b->numVar;j++)
+                if(b->momentPow[k][j]>0)
+                  powVal*=xPow[j][b->momentPow[k][j]];
+              sum[k] += powVal;
+              if(k<b->numTermMoments)
+                mSum[k] += m*powVal;
+            }
+        }
+    }
+  
+  for(k=0;k<b->numMoments;k++)
+    {
+      d->moment[k]=sum[k];
+      d->mMoment[k]=mSum[k];
+    }
+  
+}
+
+//gets the condition number of the fit equations from the sums, without
+//solving them (see get_cond_lu in lin_eq_solver.c), or -1 if they can't be
+//solved
+long double getSumsCond(const data * d,const parameters * p)
+{
+  lin_eq_type linEq;
+  buildNormalEq(p,d,&linEq); //see poly_basis.c
+  return get_cond_lu(&linEq);
+}
+
+//generates the sums that will be used when fitting
+//unless full precision is requested (FULL_PRECISION option), the sums are
+//first generated in double precision, and only regenerated in full precision
+//if the fit equations are too badly conditioned for this to be accurate
+void generateSums(data * d,const parameters * p)
+{
+
+  int i;
+  long double cond;
+  
+  if(p->fullPrecision==0)
+    {
+      generateSumsDouble(d,p);
+      cond=getSumsCond(d,p);
+      if((cond>=0.)&&(cond<SUMS_COND_LIMIT))
+        {
+          d->sumsPrecision=0;
+          return;
+        }
+    }
+  d->sumsPrecision=1;
+  
+  //initialize sums (in case this function is called more than once)
+  memset(d->moment,0,sizeof(d->moment));
+  memset(d->mMoment,0,sizeof(d->mMoment));
+  
+  if(p->basis.pairMoments==1)
+    {
+      for(i=0;i<d->lines;i+=SUMS_BATCH_SIZE)//loop over batches of data points
+        addBatchToSums(d,p,i,(d->lines-i < SUMS_BATCH_SIZE) ? d->lines-i : SUMS_BATCH_SIZE);
+      return;
+    }
+  
+  for(i=0;i<d->lines;i++)//loop over data points
+    addPointToSums(d,p,i,1);
     
 }
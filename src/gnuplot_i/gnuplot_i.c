@@ -48,28 +48,26 @@
  ---------------------------------------------------------------------------*/
 
 /**
- * Creates a temporary file name for writing
+ * Adds a data item to the current plot, then redraws the plot with all of
+ * its items (unless drawing is deferred, see gnuplot_setdeferred).
  *
- * @author Peter (12/9/2011)
+ * The data is sent inline through the pipe to gnuplot in binary format,
+ * which avoids temporary files and formatting/parsing the values as text.
+ * Since inline data can't be replotted, the data of each item is kept
+ * until the plot is reset, and resent with each redraw.
  *
  * @param handle
- *
- * @return char const * Pointer to file name string.
- */
-char const * gnuplot_tmpfile(gnuplot_ctrl * handle);
-
-/**
- * Plot a temporary file.
- *
- * @author Peter (12/9/2011)
- *
- * @param handle
- * @param tmp_filename
+ * @param splot   1 for a 3d plot (splot), 0 for a 2d plot
+ * @param ncol    Number of values per data point
+ * @param record  Binary record dimensions (eg. "100", or "20x5" for a grid)
+ * @param data    Data values, ncol per point (the item takes ownership)
+ * @param nval    Number of data values
+ * @param using   Columns to plot (eg. "1:2")
  * @param title
+ * @param palette 1 to color points by the last column
  */
-void gnuplot_plot_atmpfile(gnuplot_ctrl * handle, char const* tmp_filename, char const* title);
-void gnuplot_splot_atmpfile(gnuplot_ctrl * handle, char const* tmp_filename, char const* title);
-void gnuplot_splot4d_atmpfile(gnuplot_ctrl * handle, char const* tmp_filename, char const* title);
+void gnuplot_plot_binary(gnuplot_ctrl * handle, int splot, int ncol, char const* record,
+                         double * data, int nval, char const* using, char const* title, int palette);
 
 /*---------------------------------------------------------------------------
                             Function codes
@@ -88,13 +86,13 @@ void gnuplot_splot4d_atmpfile(gnuplot_ctrl * handle, char const* tmp_filename, c
  */
 /*--------------------------------------------------------------------------*/
 
-gnuplot_ctrl * gnuplot_init(void)
+static gnuplot_ctrl * gnuplot_open(int check_display)
 {
     gnuplot_ctrl *  handle ;
     int i;
 
 #ifndef WIN32
-    if (getenv("DISPLAY") == NULL) {
+    if (check_display && (getenv("DISPLAY") == NULL)) {
         fprintf(stderr, "cannot find DISPLAY variable: is it set?\n") ;
     }
 #endif // #ifndef WIN32
@@ -108,7 +106,9 @@ gnuplot_ctrl * gnuplot_init(void)
     handle->colSet = 0 ;
     handle->smooth = 0 ;
     gnuplot_setstyle(handle, "points") ;
-    handle->ntmp = 0 ;
+    handle->nitems = 0 ;
+    handle->splot = 0 ;
+    handle->deferred = 0 ;
 
     handle->gnucmd = popen("gnuplot", "w") ;
     if (handle->gnucmd == NULL) {
@@ -117,13 +117,25 @@ gnuplot_ctrl * gnuplot_init(void)
         return NULL ;
     }
 
-    for (i=0;i<GP_MAX_TMP_FILES; i++)
+    for (i=0;i<GP_MAX_PLOT_ITEMS; i++)
     {
-        handle->tmp_filename_tbl[i] = NULL;
+        handle->item_spec_tbl[i] = NULL;
+        handle->item_data_tbl[i] = NULL;
     }
     return handle;
 }
 
+gnuplot_ctrl * gnuplot_init(void)
+{
+    return gnuplot_open(1) ;
+}
+
+//open a gnuplot session without checking for a display
+gnuplot_ctrl * gnuplot_init_headless(void)
+{
+    return gnuplot_open(0) ;
+}
+
 
 /*-------------------------------------------------------------------------*/
 /**
@@ -131,29 +143,20 @@ gnuplot_ctrl * gnuplot_init(void)
   @param    handle Gnuplot session control handle.
   @return   void
 
-  Kills the child PID and deletes all opened temporary files.
+  Kills the child PID and frees the data of all plot items.
   It is mandatory to call this function to close the handle, otherwise
-  temporary files are not cleaned and child process might survive.
+  the child process might survive.
 
  */
 /*--------------------------------------------------------------------------*/
 
 void gnuplot_close(gnuplot_ctrl * handle)
 {
-    int     i ;
-
     if (pclose(handle->gnucmd) == -1) {
         fprintf(stderr, "problem closing communication to gnuplot\n") ;
         return ;
     }
-    if (handle->ntmp) {
-        for (i=0 ; i<handle->ntmp ; i++) {
-            remove(handle->tmp_filename_tbl[i]) ;
-            free(handle->tmp_filename_tbl[i]);
-            handle->tmp_filename_tbl[i] = NULL;
-
-        }
-    }
+    gnuplot_resetplot(handle) ;
     free(handle) ;
     return ;
 }
@@ -249,6 +252,15 @@ void gnuplot_setsmooth(gnuplot_ctrl * h, int val)
     return ;
 }
 
+//set whether plot items are drawn as they are added
+//val=1 : only drawn by gnuplot_draw
+//val=0 : drawn as added
+void gnuplot_setdeferred(gnuplot_ctrl * h, int val)
+{
+    h->deferred=val;
+    return ;
+}
+
 void gnuplot_setcolor(gnuplot_ctrl * h, char * color)
 {
     if (strcmp(color, "black") && strcmp(color, "blue")) {
@@ -313,15 +325,13 @@ void gnuplot_set_ylabel(gnuplot_ctrl * h, char * label)
 void gnuplot_resetplot(gnuplot_ctrl * h)
 {
     int     i ;
-    if (h->ntmp) {
-        for (i=0 ; i<h->ntmp ; i++) {
-            remove(h->tmp_filename_tbl[i]) ;
-            free(h->tmp_filename_tbl[i]);
-            h->tmp_filename_tbl[i] = NULL;
-
-        }
+    for (i=0 ; i<h->nitems ; i++) {
+        free(h->item_spec_tbl[i]);
+        free(h->item_data_tbl[i]);
+        h->item_spec_tbl[i] = NULL;
+        h->item_data_tbl[i] = NULL;
     }
-    h->ntmp = 0 ;
+    h->nitems = 0 ;
     h->nplots = 0 ;
     return ;
 }
@@ -364,28 +374,17 @@ void gnuplot_plot_x(
     char            *   title
 )
 {
-    int     i ;
-    FILE*   tmpfd ;
-    char const * tmpfname;
+    double* buf ;
+    char    record[32] ;
 
     if (handle==NULL || d==NULL || (n<1)) return ;
 
-    /* Open temporary file for output   */
-    tmpfname = gnuplot_tmpfile(handle);
-    tmpfd = fopen(tmpfname, "w");
+    buf = (double*)malloc(n*sizeof(double));
+    if (buf == NULL) return ;
+    memcpy(buf, d, n*sizeof(double));
 
-    if (tmpfd == NULL) {
-        fprintf(stderr,"cannot create temporary file: exiting plot") ;
-        return ;
-    }
-
-    /* Write data to this file  */
-    for (i=0 ; i<n ; i++) {
-      fprintf(tmpfd, "%.18e\n", d[i]);
-    }
-    fclose(tmpfd) ;
-
-    gnuplot_plot_atmpfile(handle,tmpfname,title);
+    sprintf(record, "%d", n);
+    gnuplot_plot_binary(handle, 0, 1, record, buf, n, "0:1", title, 0);
     return ;
 }
 
@@ -432,27 +431,21 @@ void gnuplot_plot_xy(
 )
 {
     int     i ;
-    FILE*   tmpfd ;
-    char const * tmpfname;
+    double* buf ;
+    char    record[32] ;
 
     if (handle==NULL || x==NULL || y==NULL || (n<1)) return ;
 
-    /* Open temporary file for output   */
-    tmpfname = gnuplot_tmpfile(handle);
-    tmpfd = fopen(tmpfname, "w");
-
-    if (tmpfd == NULL) {
-        fprintf(stderr,"cannot create temporary file: exiting plot") ;
-        return ;
-    }
-
-    /* Write data to this file  */
+    /* Interleave the data into binary records */
+    buf = (double*)malloc(2*n*sizeof(double));
+    if (buf == NULL) return ;
     for (i=0 ; i<n; i++) {
-        fprintf(tmpfd, "%.18e %.18e\n", x[i], y[i]) ;
+        buf[2*i] = x[i] ;
+        buf[2*i+1] = y[i] ;
     }
-    fclose(tmpfd) ;
 
-    gnuplot_plot_atmpfile(handle,tmpfname,title);
+    sprintf(record, "%d", n);
+    gnuplot_plot_binary(handle, 0, 2, record, buf, 2*n, "1:2", title, 0);
     return ;
 }
 
@@ -473,40 +466,30 @@ void gnuplot_plot_xygrid(
     char            *   title
 )
 {
-    int     i,k ;
-    FILE*   tmpfd ;
-    char const * tmpfname;
+    int     i,k,m ;
+    double* buf ;
+    char    record[32] ;
 
     if (handle==NULL || x==NULL || y==NULL || (n<1)) return ;
 
-    /* Open temporary file for output   */
-    tmpfname = gnuplot_tmpfile(handle);
-    tmpfd = fopen(tmpfname, "w");
+    buf = (double*)malloc(2*n*sizeof(double));
+    if (buf == NULL) return ;
 
-    if (tmpfd == NULL) {
-        fprintf(stderr,"cannot create temporary file: exiting plot") ;
-        return ;
-    }
-
-    /* Write data to this file  */
+    /* Interleave the selected data into binary records */
+    m=0;
     k=ndim*nblockskip;
     for (i=0 ; i<n; i++) {
-        if(nskip>0) {
-            if(i%nskip==0) {
-                fprintf(tmpfd, "%.18e %.18e\n", x[i], y[i]) ;
-            }  
-        }else if(nblockskip>0){
-            if(i%k<ndim) {
-                fprintf(tmpfd, "%.18e %.18e\n", x[i], y[i]) ;
-            }   
-        }else{
-            fprintf(tmpfd, "%.18e %.18e\n", x[i], y[i]) ;
+        if(((nskip>0)&&(i%nskip==0)) ||
+           ((nskip<=0)&&(nblockskip>0)&&(i%k<ndim)) ||
+           ((nskip<=0)&&(nblockskip<=0))) {
+            buf[2*m] = x[i] ;
+            buf[2*m+1] = y[i] ;
+            m++;
         }
     }
-    
-    fclose(tmpfd) ;
 
-    gnuplot_plot_atmpfile(handle,tmpfname,title);
+    sprintf(record, "%d", m);
+    gnuplot_plot_binary(handle, 0, 2, record, buf, 2*m, "1:2", title, 0);
     return ;
 }
 
@@ -555,32 +538,28 @@ void gnuplot_plot_xyz(
 )
 {
     int     i ;
-    FILE*   tmpfd ;
-    char const * tmpfname;
+    double* buf ;
+    char    record[32] ;
 
     if (handle==NULL || x==NULL || y==NULL || z==NULL || (n<1)) return ;
 
-    /* Open temporary file for output   */
-    tmpfname = gnuplot_tmpfile(handle);
-    tmpfd = fopen(tmpfname, "w");
-
-    if (tmpfd == NULL) {
-        fprintf(stderr,"cannot create temporary file: exiting plot") ;
-        return ;
-    }
-
-    /* Write data to this file  */
+    /* Interleave the data into binary records */
+    buf = (double*)malloc(3*n*sizeof(double));
+    if (buf == NULL) return ;
     for (i=0 ; i<n; i++) {
-        fprintf(tmpfd, "%.18e %.18e %.18e\n", x[i], y[i], z[i]) ;
+        buf[3*i] = x[i] ;
+        buf[3*i+1] = y[i] ;
+        buf[3*i+2] = z[i] ;
     }
-    fclose(tmpfd) ;
 
-    gnuplot_splot_atmpfile(handle,tmpfname,title);
+    sprintf(record, "%d", n);
+    gnuplot_plot_binary(handle, 1, 3, record, buf, 3*n, "1:2:3", title, 0);
     return ;
 }
 
 //JW: same as the above function but modified to allow plotting of grid data as a mesh
-//gnuplot requires empty lines between each block of data for all x values in the grid
+//the data is sent as a 2d binary record (ndim points per block), so that gnuplot
+//draws it as a grid
 //ndim = # of points in each dimension of the grid = # of data points in each 'block' of x values
 //nskip = take only every nskipth data point
 void gnuplot_plot_xyzgrid(
@@ -595,49 +574,49 @@ void gnuplot_plot_xyzgrid(
     char            *   title
 )
 {
-    int     i,j,k ;
-    FILE*   tmpfd ;
-    char const * tmpfname;
+    int     i,j,k,m,nblock,sel ;
+    double* buf ;
+    char    record[32] ;
 
-    if (handle==NULL || x==NULL || y==NULL || z==NULL || (n<1)) return ;
+    if (handle==NULL || x==NULL || y==NULL || z==NULL || (n<1) || (ndim<1)) return ;
 
-    /* Open temporary file for output   */
-    tmpfname = gnuplot_tmpfile(handle);
-    tmpfd = fopen(tmpfname, "w");
+    buf = (double*)malloc(3*n*sizeof(double));
+    if (buf == NULL) return ;
 
-    if (tmpfd == NULL) {
-        fprintf(stderr,"cannot create temporary file: exiting plot") ;
-        return ;
-    }
-
-    /* Write data to this file  */
+    /* Interleave the selected data into binary records
+       a block ends after every ndim points (or every ndim selected points
+       when skipping blocks) */
     j=0;
+    m=0;
+    nblock=0;
     k=ndim*nblockskip;
     for (i=0 ; i<n; i++) {
-        if(nskip>0) {
-            if(i%nskip==0) {
-                fprintf(tmpfd, "%.18e %.18e %.18e\n", x[i], y[i], z[i]) ;
-            }  
-            j++;
-        }else if(nblockskip>0){
-            if(i%k<ndim) {
-                fprintf(tmpfd, "%.18e %.18e %.18e\n", x[i], y[i], z[i]) ;
-                j++;
-            }   
-        }else{
-            fprintf(tmpfd, "%.18e %.18e %.18e\n", x[i], y[i], z[i]) ;
-            j++;
+        if(nskip>0)
+            sel = (i%nskip==0) ;
+        else if(nblockskip>0)
+            sel = (i%k<ndim) ;
+        else
+            sel = 1 ;
+        if(sel) {
+            buf[3*m] = x[i] ;
+            buf[3*m+1] = y[i] ;
+            buf[3*m+2] = z[i] ;
+            m++;
         }
-        
-        
+        if((nskip>0)||sel)
+            j++;
         if(j>=ndim) {
-            fprintf(tmpfd, "\n"); //insert blank line
+            nblock++;
             j=0;
         }
     }
-    fclose(tmpfd) ;
 
-    gnuplot_splot_atmpfile(handle,tmpfname,title);
+    /* Send as a grid if every block has the same number of points */
+    if((nblock>0)&&(j==0)&&(m%nblock==0))
+        sprintf(record, "%dx%d", m/nblock, nblock);
+    else
+        sprintf(record, "%d", m);
+    gnuplot_plot_binary(handle, 1, 3, record, buf, 3*m, "1:2:3", title, 0);
     return ;
 }
 
@@ -652,27 +631,23 @@ void gnuplot_plot_xyza(
 )
 {
     int     i ;
-    FILE*   tmpfd ;
-    char const * tmpfname;
+    double* buf ;
+    char    record[32] ;
 
     if (handle==NULL || x==NULL || y==NULL || z==NULL || a==NULL || (n<1)) return ;
 
-    /* Open temporary file for output   */
-    tmpfname = gnuplot_tmpfile(handle);
-    tmpfd = fopen(tmpfname, "w");
-
-    if (tmpfd == NULL) {
-        fprintf(stderr,"cannot create temporary file: exiting plot") ;
-        return ;
-    }
-
-    /* Write data to this file  */
+    /* Interleave the data into binary records */
+    buf = (double*)malloc(4*n*sizeof(double));
+    if (buf == NULL) return ;
     for (i=0 ; i<n; i++) {
-        fprintf(tmpfd, "%.18e %.18e %.18e %.18e\n", x[i], y[i], z[i], a[i]) ;
+        buf[4*i] = x[i] ;
+        buf[4*i+1] = y[i] ;
+        buf[4*i+2] = z[i] ;
+        buf[4*i+3] = a[i] ;
     }
-    fclose(tmpfd) ;
 
-    gnuplot_splot4d_atmpfile(handle,tmpfname,title);
+    sprintf(record, "%d", n);
+    gnuplot_plot_binary(handle, 1, 4, record, buf, 4*n, "1:2:3:4", title, 1);
     return ;
 }
 
@@ -905,96 +880,71 @@ int gnuplot_write_multi_csv(
     return 0;
 }
 
-char const * gnuplot_tmpfile(gnuplot_ctrl * handle)
+void gnuplot_plot_binary(gnuplot_ctrl * handle, int splot, int ncol, char const* record,
+                         double * data, int nval, char const* using, char const* title, int palette)
 {
-    static char const * tmp_filename_template = "gnuplot_tmpdatafile_XXXXXX";
-    char *              tmp_filename = NULL;
-    int                 tmp_filelen = strlen(tmp_filename_template);
+    int     i,j ;
+    char    spec[512] ;
+    char    format[64] ;
 
-#ifndef WIN32
-    int                 unx_fd;
-#endif // #ifndef WIN32
-
-    assert(handle->tmp_filename_tbl[handle->ntmp] == NULL);
-
-    /* Open one more temporary file? */
-    if (handle->ntmp == GP_MAX_TMP_FILES - 1) {
+    if (handle->nitems == GP_MAX_PLOT_ITEMS) {
         fprintf(stderr,
-                "maximum # of temporary files reached (%d): cannot open more",
-                GP_MAX_TMP_FILES) ;
-        return NULL;
+                "maximum # of plot items reached (%d): cannot plot more",
+                GP_MAX_PLOT_ITEMS) ;
+        free(data) ;
+        return ;
     }
-
-    tmp_filename = (char*) malloc(tmp_filelen+1);
-    if (tmp_filename == NULL)
-    {
-        return NULL;
+    /* Items of a 2d plot can't be added to a 3d plot, or vice versa */
+    if ((handle->nitems > 0) && (handle->splot != splot)) {
+        gnuplot_resetplot(handle) ;
     }
-    strcpy(tmp_filename, tmp_filename_template);
+    handle->splot = splot ;
 
-#ifdef WIN32
-    if (_mktemp(tmp_filename) == NULL)
-    {
-        return NULL;
+    /* Data source and style of the item */
+    title = (title == NULL) ? "(none)" : title;
+    strcpy(format, "") ;
+    for (i=0 ; i<ncol ; i++) {
+        strcat(format, "%double") ;
     }
-#else // #ifdef WIN32
-    unx_fd = mkstemp(tmp_filename);
-    if (unx_fd == -1)
-    {
-        return NULL;
+    j = sprintf(spec, "'-' binary record=%s format='%s' using %s title \"%s\"",
+                record, format, using, title) ;
+    if (palette) {
+        j += sprintf(spec+j, " with %s lc palette", handle->pstyle) ;
+    } else {
+        if (handle->colSet && !splot)
+            j += sprintf(spec+j, " lt rgb \"%s\"", handle->col) ;
+        j += sprintf(spec+j, " with %s", handle->pstyle) ;
+        if (handle->smooth)
+            j += sprintf(spec+j, " smooth bezier") ;
     }
-    //close(unx_fd);
 
-#endif // #ifdef WIN32
-
-    handle->tmp_filename_tbl[handle->ntmp] = tmp_filename;
-    handle->ntmp ++;
-    return tmp_filename;
-}
+    handle->item_spec_tbl[handle->nitems] = strdup(spec) ;
+    handle->item_data_tbl[handle->nitems] = data ;
+    handle->item_nval_tbl[handle->nitems] = nval ;
+    handle->nitems ++ ;
 
-void gnuplot_plot_atmpfile(gnuplot_ctrl * handle, char const* tmp_filename, char const* title)
-{
-    char const *    cmd    = (handle->nplots > 0) ? "replot" : "plot";
-    title                  = (title == NULL)      ? "(none)" : title;
-    if(handle->colSet==0)
-        {
-            if(handle->smooth)
-                gnuplot_cmd(handle, "%s \"%s\" title \"%s\" with %s smooth bezier", cmd, tmp_filename,title, handle->pstyle) ;
-            else
-                gnuplot_cmd(handle, "%s \"%s\" title \"%s\" with %s", cmd, tmp_filename,title, handle->pstyle) ;
-        }
-    else
-        {
-            if(handle->smooth)
-                gnuplot_cmd(handle, "%s \"%s\" title \"%s\" lt rgb \"%s\" with %s smooth bezier", cmd, tmp_filename,title, handle->col, handle->pstyle) ;
-            else
-                gnuplot_cmd(handle, "%s \"%s\" title \"%s\" lt rgb \"%s\" with %s", cmd, tmp_filename,title, handle->col, handle->pstyle) ;
-        }
-        
-    handle->nplots++ ;
+    if (!handle->deferred) {
+        gnuplot_draw(handle) ;
+    }
     return ;
 }
 
-void gnuplot_splot_atmpfile(gnuplot_ctrl * handle, char const* tmp_filename, char const* title)
+//draw all items of the current plot, followed by their data
+void gnuplot_draw(gnuplot_ctrl * handle)
 {
-    char const *    cmd    = (handle->nplots > 0) ? "replot" : "splot";
-    title                  = (title == NULL)      ? "(none)" : title;
-
-    if(handle->smooth)
-        gnuplot_cmd(handle, "%s \"%s\" title \"%s\" with %s smooth bezier", cmd, tmp_filename,title, handle->pstyle) ;
-    else
-        gnuplot_cmd(handle, "%s \"%s\" title \"%s\" with %s", cmd, tmp_filename,title, handle->pstyle) ;
-
-    handle->nplots++ ;
-    return ;
-}
+    int     i ;
 
-void gnuplot_splot4d_atmpfile(gnuplot_ctrl * handle, char const* tmp_filename, char const* title)
-{
-    char const *    cmd    = (handle->nplots > 0) ? "replot" : "splot";
-    title                  = (title == NULL)      ? "(none)" : title;
+    if (handle->nitems == 0) return ;
 
-    gnuplot_cmd(handle, "%s \"%s\" title \"%s\" with %s lc palette", cmd, tmp_filename,title, handle->pstyle) ;
+    fprintf(handle->gnucmd, "%s ", handle->splot ? "splot" : "plot") ;
+    for (i=0 ; i<handle->nitems ; i++) {
+        fprintf(handle->gnucmd, "%s%s", (i>0) ? ", " : "", handle->item_spec_tbl[i]) ;
+    }
+    fputs("\n", handle->gnucmd) ;
+    for (i=0 ; i<handle->nitems ; i++) {
+        fwrite(handle->item_data_tbl[i], sizeof(double), handle->item_nval_tbl[i], handle->gnucmd) ;
+    }
+    fflush(handle->gnucmd) ;
 
     handle->nplots++ ;
     return ;
@@ -30,8 +30,8 @@
  ---------------------------------------------------------------------------*/
 #include <stdio.h>
 
-/** Maximal number of simultaneous temporary files */
-#define GP_MAX_TMP_FILES    64
+/** Maximal number of data items in a plot */
+#define GP_MAX_PLOT_ITEMS   64
 
 /*---------------------------------------------------------------------------
                                 New Types
@@ -65,10 +65,16 @@ typedef struct _GNUPLOT_CTRL_ {
     /** Plotting color */
     char      col[32] ;
     int       colSet;
-    /** Pointer to table of names of temporary files */
-    char*      tmp_filename_tbl[GP_MAX_TMP_FILES] ;
-    /** Number of temporary files */
-    int       ntmp ;
+    /** 1 if the current plot is 3d (splot), 0 if 2d (plot) */
+    int       splot ;
+    /** Table of plot items: data source and style, binary data, number of values */
+    char*      item_spec_tbl[GP_MAX_PLOT_ITEMS] ;
+    double*    item_data_tbl[GP_MAX_PLOT_ITEMS] ;
+    int        item_nval_tbl[GP_MAX_PLOT_ITEMS] ;
+    /** Number of plot items */
+    int       nitems ;
+    /** 1 if plot items are only drawn by gnuplot_draw(), 0 if drawn as added */
+    int       deferred ;
 } gnuplot_ctrl ;
 
 /*---------------------------------------------------------------------------
@@ -90,15 +96,20 @@ typedef struct _GNUPLOT_CTRL_ {
 /*--------------------------------------------------------------------------*/
 gnuplot_ctrl * gnuplot_init(void);
 
+//Opens a gnuplot session which doesn't need a display, for plotting to
+//file terminals (eg. png, svg, pdf)
+//Added by J. Williams
+gnuplot_ctrl * gnuplot_init_headless(void);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Closes a gnuplot session previously opened by gnuplot_init()
   @param    handle Gnuplot session control handle.
   @return   void
 
-  Kills the child PID and deletes all opened temporary files.
+  Kills the child PID and frees the data of all plot items.
   It is mandatory to call this function to close the handle, otherwise
-  temporary files are not cleaned and child process might survive.
+  the child process might survive.
 
  */
 /*--------------------------------------------------------------------------*/
@@ -162,6 +173,14 @@ void gnuplot_setsmooth(gnuplot_ctrl * h, int val);
 void gnuplot_setcolor(gnuplot_ctrl * h, char * color);
 void gnuplot_unsetcolor(gnuplot_ctrl * h);
 
+//Functions for drawing all plot items at once (eg. when plotting to a file
+//terminal, where each redraw would write another image or page)
+//val=1 : plot items are only drawn by gnuplot_draw
+//val=0 : plot items are drawn as they are added
+//Added by J. Williams
+void gnuplot_setdeferred(gnuplot_ctrl * h, int val);
+void gnuplot_draw(gnuplot_ctrl * h);
+
 /*-------------------------------------------------------------------------*/
 /**
   @brief    Sets the x label of a gnuplot session.
@@ -0,0 +1,266 @@
+//index of the data points by the distinct values of each variable
+//gridlock data is usually a grid (lattice) of parameter values, so the
+//distinct values of each variable are few, and the data points sharing a
+//value of a variable (a bucket) form a slice of the grid
+//the index gives the lattice coordinate of each data point, lets the value of
+//a variable nearest to a given value be found by binary search, and lets a
+//slice of the data be extracted from the smallest bucket of its fixed
+//variables rather than by a scan over all data points
+//scattered (non-grid) data is handled the same way, with a bucket per value
+
+//frees the arrays of an index
+void freeGridIndex(grid_index_type * gi)
+{
+  int k;
+  for(k=0;k<POWSIZE;k++)
+    {
+      free(gi->val[k]);
+      free(gi->firstPt[k]);
+      free(gi->coord[k]);
+      free(gi->bucketStart[k]);
+      free(gi->bucketPts[k]);
+      gi->val[k]=NULL;
+      gi->firstPt[k]=NULL;
+      gi->coord[k]=NULL;
+      gi->bucketStart[k]=NULL;
+      gi->bucketPts[k]=NULL;
+      gi->numVal[k]=0;
+    }
+  gi->numVar=0;
+  gi->numPts=0;
+}
+
+//orders distinct values by value
+int compareGridIndexEntry(const void * a, const void * b)
+{
+  const grid_index_entry *ea=(const grid_index_entry*)a;
+  const grid_index_entry *eb=(const grid_index_entry*)b;
+  if(ea->val<eb->val)
+    return -1;
+  if(ea->val>eb->val)
+    return 1;
+  return ea->ind - eb->ind;
+}
+
+//hash of a value, for the table of distinct values (tableBits bits)
+//equal values (including 0 and -0) hash the same
+unsigned int hashGridVal(long double v, int tableBits)
+{
+  unsigned long long h;
+  double dv=(double)v;
+  if(dv==0.)
+    dv=0.;
+  memcpy(&h,&dv,sizeof(h));
+  return (unsigned int)((h*0x9E3779B97F4A7C15ULL)>>(64-tableBits));
+}
+
+//builds (or rebuilds) the index of the data, the index must be rebuilt
+//whenever data points are removed
+//the distinct values of each variable are found with a hash table, so that
+//only the m distinct values (rather than all n data points) need sorting,
+//and the data points are then placed in buckets by a counting sort, taking
+//O(n + m log m) time
+void buildGridIndex(const data * d, const parameters * p, grid_index_type * gi)
+{
+  int i,j,k,m,cap;
+  unsigned int h;
+  freeGridIndex(gi);
+  gi->numVar=p->numVar;
+  gi->numPts=d->lines;
+  if(d->lines<1)
+    return;
+
+  int tableBits=10;
+  int *table=(int*)malloc((1<<tableBits)*sizeof(int));
+  grid_index_entry *e=NULL;
+  int *rank=NULL;
+  for(k=0;k<p->numVar;k++)
+    {
+      cap=1024;
+      gi->val[k]=(long double*)malloc(cap*sizeof(long double));
+      gi->firstPt[k]=(int*)malloc(cap*sizeof(int));
+      gi->coord[k]=(int*)malloc(d->lines*sizeof(int));
+      gi->bucketPts[k]=(int*)malloc(d->lines*sizeof(int));
+      if((table==NULL)||(gi->val[k]==NULL)||(gi->firstPt[k]==NULL)||(gi->coord[k]==NULL)||(gi->bucketPts[k]==NULL))
+        {
+          printf("ERROR: could not allocate memory for the data index.\n");
+          exit(-1);
+        }
+
+      //find the distinct values, numbered in order of appearance
+      memset(table,-1,(1<<tableBits)*sizeof(int));
+      m=0;
+      for(j=0;j<d->lines;j++)
+        {
+          h=hashGridVal(d->x[k][j],tableBits);
+          while((table[h]>=0)&&(gi->val[k][table[h]]!=d->x[k][j]))
+            h=(h+1)&((1U<<tableBits)-1);
+          if(table[h]<0)
+            {
+              //new distinct value
+              if(m==cap)
+                {
+                  cap*=2;
+                  gi->val[k]=(long double*)realloc(gi->val[k],cap*sizeof(long double));
+                  gi->firstPt[k]=(int*)realloc(gi->firstPt[k],cap*sizeof(int));
+                  if((gi->val[k]==NULL)||(gi->firstPt[k]==NULL))
+                    {
+                      printf("ERROR: could not allocate memory for the data index.\n");
+                      exit(-1);
+                    }
+                }
+              gi->val[k][m]=d->x[k][j];
+              gi->firstPt[k][m]=j;
+              table[h]=m;
+              m++;
+              if(2*m>(1<<tableBits))
+                {
+                  //grow the table, keeping it at most half full
+                  tableBits++;
+                  table=(int*)realloc(table,(1<<tableBits)*sizeof(int));
+                  if(table==NULL)
+                    {
+                      printf("ERROR: could not allocate memory for the data index.\n");
+                      exit(-1);
+                    }
+                  memset(table,-1,(1<<tableBits)*sizeof(int));
+                  for(i=0;i<m;i++)
+                    {
+                      h=hashGridVal(gi->val[k][i],tableBits);
+                      while(table[h]>=0)
+                        h=(h+1)&((1U<<tableBits)-1);
+                      table[h]=i;
+                    }
+                }
+              gi->coord[k][j]=m-1;
+            }
+          else
+            gi->coord[k][j]=table[h];
+        }
+      gi->numVal[k]=m;
+
+      //sort the distinct values, and renumber the lattice coordinates in
+      //order of value
+      e=(grid_index_entry*)realloc(e,m*sizeof(grid_index_entry));
+      rank=(int*)realloc(rank,m*sizeof(int));
+      gi->bucketStart[k]=(int*)calloc(m+1,sizeof(int));
+      if((e==NULL)||(rank==NULL)||(gi->bucketStart[k]==NULL))
+        {
+          printf("ERROR: could not allocate memory for the data index.\n");
+          exit(-1);
+        }
+      for(i=0;i<m;i++)
+        {
+          e[i].val=gi->val[k][i];
+          e[i].ind=gi->firstPt[k][i];
+        }
+      qsort(e,m,sizeof(grid_index_entry),compareGridIndexEntry);
+      for(i=0;i<m;i++)
+        {
+          rank[gi->coord[k][e[i].ind]]=i;
+          gi->val[k][i]=e[i].val;
+          gi->firstPt[k][i]=e[i].ind;
+        }
+      gi->val[k]=(long double*)realloc(gi->val[k],m*sizeof(long double));
+      gi->firstPt[k]=(int*)realloc(gi->firstPt[k],m*sizeof(int));
+
+      //place the data points in buckets by value (counting sort), in 
+      //increasing order within each bucket
+      for(j=0;j<d->lines;j++)
+        {
+          gi->coord[k][j]=rank[gi->coord[k][j]];
+          gi->bucketStart[k][gi->coord[k][j]+1]++;
+        }
+      for(i=0;i<m;i++)
+        gi->bucketStart[k][i+1]+=gi->bucketStart[k][i];
+      for(i=0;i<m;i++)
+        rank[i]=gi->bucketStart[k][i];//next free position in each bucket
+      for(j=0;j<d->lines;j++)
+        gi->bucketPts[k][rank[gi->coord[k][j]]++]=j;
+    }
+  free(table);
+  free(e);
+  free(rank);
+}
+
+//gets the index of the distinct value of a variable nearest to v, in
+//O(log m) time for m distinct values
+//ties go to the value appearing first in the data, as for a scan over the
+//data points
+//returns -1 if there are no data points
+int getNearestGridVal(const grid_index_type * gi, int var, long double v)
+{
+  int lo=0;
+  int hi=gi->numVal[var];
+  int mid;
+  long double dl,du;
+  if(hi<1)
+    return -1;
+  
+  //find the first value not less than v
+  while(lo<hi)
+    {
+      mid=(lo+hi)/2;
+      if(gi->val[var][mid]<v)
+        lo=mid+1;
+      else
+        hi=mid;
+    }
+  if(lo==gi->numVal[var])
+    return lo-1;
+  if(lo==0)
+    return 0;
+  
+  dl=v - gi->val[var][lo-1];
+  du=gi->val[var][lo] - v;
+  if(dl<du)
+    return lo-1;
+  if(du<dl)
+    return lo;
+  return (gi->firstPt[var][lo-1]<gi->firstPt[var][lo]) ? lo-1 : lo;
+}
+
+//gets the data points in the slice of the data where each fixed variable 
+//(fixed[k]=1) has the distinct value with index fixedCoord[k]
+//the smallest bucket of the fixed variables is filtered by the others, taking
+//O(k) time for a bucket of k data points
+//pts: array of (at least) gi->numPts values, filled with the data point #s 
+//of the slice in increasing order
+//returns the number of data points in the slice
+int getGridSlice(const grid_index_type * gi, const int * fixed, const int * fixedCoord, int * pts)
+{
+  int j,k,pt,n,size;
+  int var=-1;
+  int minSize=gi->numPts+1;
+  for(k=0;k<gi->numVar;k++)
+    if(fixed[k]==1)
+      {
+        if((fixedCoord[k]<0)||(fixedCoord[k]>=gi->numVal[k]))
+          return 0;
+        size=gi->bucketStart[k][fixedCoord[k]+1] - gi->bucketStart[k][fixedCoord[k]];
+        if(size<minSize)
+          {
+            minSize=size;
+            var=k;
+          }
+      }
+  
+  n=0;
+  if(var<0)//no fixed variables, the slice is all of the data
+    {
+      for(j=0;j<gi->numPts;j++)
+        pts[n++]=j;
+      return n;
+    }
+  
+  for(j=gi->bucketStart[var][fixedCoord[var]];j<gi->bucketStart[var][fixedCoord[var]+1];j++)
+    {
+      pt=gi->bucketPts[var][j];
+      for(k=0;k<gi->numVar;k++)
+        if((fixed[k]==1)&&(gi->coord[k][pt]!=fixedCoord[k]))
+          break;
+      if(k==gi->numVar)
+        pts[n++]=pt;
+    }
+  return n;
+}
@@ -1,12 +1,20 @@
 //definitions
 #include "gridlock.h"
 //common functions
+#include "threads.c"
 #include "import_data.c"
 #include "print_data_info.c"
+#include "poly_basis.c"
 #include "generate_sums.c"
+#include "grid_index.c"
+#include "plot_downsample.c"
+#include "plot_sampling.c"
 #include "plot_data.c"
+#include "quad_ci.c"
+#include "residuals.c"
 //data filters
 #include "lin_filter.c"
+#include "ransac.c"
 //fitting routines
 #include "linfit.c"
 #include "linfit_deming.c"
@@ -16,6 +24,36 @@
 #include "poly3fit.c"
 #include "poly4fit.c"
 #include "2parpoly3fit.c"
+#include "nparpolyfit.c"
+#include "fit_eval_batch.c"
+#include "fit_models.c"
+//fit diagnostics
+#include "fit_basis.c"
+#include "jackknife.c"
+#include "refit_clip.c"
+#include "robust_fit.c"
+//evaluation of the fit at query points
+#include "eval_points.c"
+
+//call specific fitting routines depending on the fit type specified
+void fitData(parameters * p, data * d, fit_results * fr, plot_data * pd, int print)
+{
+	if((p->model->linearCoeff==0)&&(p->fitOpt==0.))//default ratio of variances for Deming regression
+		p->fitOpt=1.;
+	p->model->fit(p,d,fr,pd,print); //see fit_models.c
+	
+	//report the precision used to fit
+	if((print==1)&&(p->verbose<1)&&(p->model->linearCoeff==1))
+		{
+			printf("\nCondition number of the fit equations: %0.3LE (sums accumulated in %s precision).\n",fr->solveCond,(d->sumsPrecision==0) ? "double" : "full");
+			if(p->fullPrecision==1)
+				printf("Fit equations solved in full precision.\n");
+			else if(fr->solveRefineIter<0)
+				printf("Fit equations too badly conditioned for mixed precision, solved in full precision (relative residual %0.3LE).\n",fr->solveResidual);
+			else
+				printf("Fit equations solved in mixed precision with %i refinement step(s) (relative residual %0.3LE).\n",fr->solveRefineIter,fr->solveResidual);
+		}
+}
 
 int main(int argc, char *argv[])
 {
@@ -29,7 +67,7 @@ int main(int argc, char *argv[])
 		{
 			printf("usage: gridlock filename\n\n");
 			printf("Fits the data in the plaintext file specified by 'filename'.\nThe fit type and data should be specified in the file using the format:\n\nFIT  type\nVariableValue1  DataValue1\nVariableValue2  DataValue2\n...             ...\n");
-			printf("\nPossible values of 'type' are:\nlin (linear / 1st order polynomial)\nlin_deming (linear with errors in x)\npoly2 (2nd order polynomial)\npoly3 (3rd order polynomial)\npoly4 (4th order polynomial)\n2parpoly2 (2nd order bivariate polynomial)\n2parpoly3 (3rd order bivariate polynomial)\n3parpoly2 (2nd order trivariate polynomial)\n");
+			printf("\nPossible values of 'type' are:\nlin (linear / 1st order polynomial)\nlin_deming (linear with errors in x)\npoly2 (2nd order polynomial)\npoly3 (3rd order polynomial)\npoly4 (4th order polynomial)\n2parpoly2 (2nd order bivariate polynomial)\n2parpoly3 (3rd order bivariate polynomial)\n3parpoly2 (2nd order trivariate polynomial)\nNparpolyD (order D polynomial in N variables, eg. 4parpoly2)\n");
 			printf("\nSee the README for more details.\n");
 			exit(-1);
 		}
@@ -43,9 +81,9 @@ int main(int argc, char *argv[])
 	strcpy(p->filename,argv[1]);
 	importData(d,p); //see import_data.c
   
-	if((p->numVar<1)||(p->numVar>3))
+	if(p->numVar<1)
 		{
-			printf("ERROR: the number of free parameters (NUM_PAR) must be 3 or less, and cannot be negative.\n");
+			printf("ERROR: the number of free parameters (NUM_PAR) must be at least 1.\n");
 			exit(-1);
 		}
 	if(p->numVar>(POWSIZE-2))
@@ -56,38 +94,60 @@ int main(int argc, char *argv[])
   
 	if(p->filter==1)
   		linearFilter(d,p);
+	if(p->ransac==1)
+		ransac(d,p); //see ransac.c
   
 	if(p->verbose<1)
 		printDataInfo(d,p); //see print_data_info.c
 
-	generateSums(d,p); //construct sums for fitting (see generate_sums.c) 
-		
-	//Call specific fitting routines depending on the fit type specified
-	if(strcmp(p->fitType,"poly2")==0) //see poly2fit.c
-		fit1Par(p,d,fr,pd,1);
-	else if(strcmp(p->fitType,"2parpoly2")==0) //see 2parpoly2fit.c
-		fit2Par(p,d,fr,pd,1);
-	else if(strcmp(p->fitType,"3parpoly2")==0) //see 3parpoly2fit.c
-		fit3Par(p,d,fr,pd,1);
-	else if(strcmp(p->fitType,"lin")==0)
-		fitLin(p,d,fr,pd,1);
-	else if(strcmp(p->fitType,"lin_deming")==0)
+	//index the data points for plotting (see grid_index.c)
+	if((p->plotData==1)&&(p->verbose<1)&&(p->model->plotForm!=NULL))
+		buildGridIndex(d,p,&d->index);
+
+	if((p->jackknife==1)&&(p->model->linearCoeff==0))
+		{
+			printf("ERROR: Jackknife diagnostics (JACKKNIFE option) are not available for the %s fit type.\n",p->fitType);
+			exit(-1);
+		}
+
+	if((p->robustFit>0)&&(p->model->linearCoeff==0))
 		{
-			if(p->fitOpt==0.)//default value
-				p->fitOpt=1.;
-			fitLinDeming(p,d,fr,pd,1);
+			printf("ERROR: Robust fitting (FIT_ROBUST option) is not available for the %s fit type.\n",p->fitType);
+			exit(-1);
 		}
-	else if(strcmp(p->fitType,"poly3")==0)
-		fitPoly3(p,d,fr,pd,1);
-	else if(strcmp(p->fitType,"poly4")==0)
-		fitPoly4(p,d,fr,pd,1);
-	else if(strcmp(p->fitType,"2parpoly3")==0)
-		fit2ParPoly3(p,d,fr,pd,1);
+
+	generateSums(d,p); //construct sums for fitting (see generate_sums.c) 
+		
+	//fit the data
+	if(p->robustFit>0)
+		robustFit(p,d,fr,pd); //fit with robust weights (see robust_fit.c)
+	else if((p->refitFilter==1)||(p->refitClip==1))
+		refitClip(p,d,fr,pd); //fit with outlier rejection (see refit_clip.c)
+	else
+		fitData(p,d,fr,pd,1);
+
+	if(p->residuals==1)
+		printResiduals(p,d,fr); //see residuals.c
+	if(strcmp(p->evalPointsFile,"")!=0)
+		evalPoints(p,fr); //see eval_points.c
+	if(p->jackknife==1)
+		jackknife(p,d,fr); //see jackknife.c
+
+	//plot the results, once everything has been reported
+	if((p->plotData==1)&&(p->verbose<1))
+		plotFit(p,d,fr,pd); //see plot_data.c
 	
+	//close the gnuplot session, waiting for any exported plots to be written
+	if(plotOpen==1)
+		gnuplot_close(handle);
+
 	//free structures
+	freeGridIndex(&d->index);
+	free(d->robustWt);
 	free(d);
 	free(p);
 	free(fr);
+	freePlotData(pd);
 	free(pd);
 		
 	return 0; //great success
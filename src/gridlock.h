@@ -3,29 +3,87 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "gnuplot_i.h"
 #include "lin_eq_solver.h"
 
 #define POWSIZE         12
 #define MAXFILELENGTH   500000
-#define CI_EE_DIM				100 //# of data points to evaluate confidence interval error ellipse on
 #define CI_DIM					100 //# of data points to use when plotting confidence interval
 #define BIG_NUMBER      1E10
 #define NUM_LIST        5
 #define PI        			3.1415926535897932384626433832795028841971693993751
+#define MAX_MOMENTS     (MAX_DIM*(MAX_DIM+1)/2 + MAX_DIM) //maximum number of distinct monomials in the moment table
+#define MAX_TERM_FUNC   4 //maximum number of function factors (eg. log(x)) in a user-defined fit term
+#define SUMS_BATCH_SIZE 256 //number of data points evaluated at once when generating sums for user-defined fit terms
+#define SUMS_COND_LIMIT 1.0E6 //condition number of the fit equations above which sums are regenerated in full precision
+#define PLOT_MAX_POINTS 20000 //default maximum number of data points sent to gnuplot for each plot
+#define PLOT_FIT_MAX_POINTS 4096 //maximum number of points used to plot the fit function in each plot
+#define PLOT_FIT_TOLERANCE 1.0E-3 //maximum deviation of plotted fit curves/surfaces from the fit function, relative to its range over the plot
+#define EVAL_BATCH_SIZE 4096 //number of query points read and evaluated at once (EVAL_POINTS option)
+#define RESIDUAL_BATCH_SIZE 1024 //number of data points evaluated at once when getting the residuals of a fit
+#define RESIDUAL_HIST_BINS 20 //number of bins in the histogram of normalized residuals (RESIDUALS option)
+#define RESIDUAL_HIST_RANGE 5.0 //normalized residuals in the histogram range from -RESIDUAL_HIST_RANGE to RESIDUAL_HIST_RANGE
+#define MAX_THREADS 16 //maximum number of threads used for parallel work (see threads.c)
+#define RANSAC_MIN_WORK 100000 //minimum number of data points times hypotheses per RANSAC thread
+#define RANSAC_BATCH_SIZE 1024 //number of data points evaluated at once when scoring RANSAC hypotheses
+#define DATA_THREAD_MIN_POINTS 50000 //minimum number of data points per thread in parallel passes over the data
+
+//double precision batch evaluation loops are compiled for several instruction
+//sets (AVX-512, AVX2, and baseline SSE2), with the best one supported by the
+//CPU selected at run time
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__linux__)
+#define SIMD_CLONES __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define SIMD_CLONES
+#endif
+
+typedef struct
+{
+  int numVar;//number of variables
+  int degree;//maximum total degree of the terms
+  int numTerms;//number of terms (fit coefficients)
+  int pow[MAX_DIM][POWSIZE];//power of each variable in each term, in the same order as the fit coefficients
+  int monomial;//1 if all terms are monomials, 0 if some terms contain function factors
+  int mapBasis;//0=monomial terms, 1=fit using Chebyshev polynomials, 2=Legendre polynomials, 3=centered and scaled monomials (FIT_BASIS option)
+  long double varCenter[POWSIZE],varScale[POWSIZE];//center and scale of each mapped variable, (x - center)/scale
+  long double toMonomial[MAX_DIM][MAX_DIM];//converts coefficients of the mapped terms (columns) to coefficients of the monomial terms (rows)
+  int numFunc[MAX_DIM];//number of function factors in each term (user-defined terms only)
+  int func[MAX_DIM][MAX_TERM_FUNC];//function of each function factor (see termFuncName in poly_basis.c)
+  int funcVar[MAX_DIM][MAX_TERM_FUNC];//variable # that each function is applied to
+  long double funcScale[MAX_DIM][MAX_TERM_FUNC];//scale factor multiplying the variable in each function
+  int funcPow[MAX_DIM][MAX_TERM_FUNC];//power that each function factor is raised to
+  int numMoments;//number of distinct monomials in the moment table
+  int numTermMoments;//number of moments which are also terms (stored first in the moment table)
+  int maxPow;//maximum power of any variable in the moment table
+  int momentPow[MAX_MOMENTS][POWSIZE];//power of each variable in each moment
+  int pairMoment[MAX_DIM][MAX_DIM];//index of the moment corresponding to the product of two terms
+  int termMoment[MAX_DIM];//index of the moment corresponding to each term
+  int pairMoments;//0=moments are monomials, 1=each term and product of terms is a separate moment
+  int momentTerm[MAX_MOMENTS][2];//terms multiplied to get each moment (-1 for none), if the basis is not monomial
+}poly_basis_type;
 
 typedef struct
 {
   char filename[256];//name of the data file
   char fitType[128];//the type of fit (linear,parabola,etc)
+  const struct fit_model_struct * model;//description of the fit type, looked up once the fit type is read (see fit_models.c)
+  char fitTerms[256];//list of user-defined fit terms (FIT_TERMS option)
+  int fullPrecision;//0=generate sums in double and solve in mixed precision when accurate enough, 1=always use full precision (FULL_PRECISION option)
+  int fitBasis;//0=fit using monomial terms, 1=Chebyshev polynomials, 2=Legendre polynomials, 3=centered and scaled monomials (FIT_BASIS option)
   long double fitOpt;//fit option value (eg. delta for Deming regression) 
   char dataType[256];//the type of data provided (regular, chisq values, etc.)
   long double ciDelta;//delta value for confidence interval calculation
+  long double ciBandDelta;//delta value for the confidence band of the fit function at a single point (1 degree of freedom)
   char ciSigmaDesc[256];//description of sigma used for confidence interval calculation
   int plotData;//0=don't plot, 1=plot
   char plotMode[256];//the plotting style to be used
   int plotCI;//0=don't plot confidence interval, 1=plot it
+  int plotMaxPts;//maximum number of data points to plot before downsampling, 0=don't downsample (PLOT_MAX_POINTS option)
+  int plotExport;//0=show plots interactively, 1=export to png, 2=svg, 3=pdf (PLOT_EXPORT option)
+  char plotExportPath[256];//path of the exported plot files (without extension)
   int ignorePar[POWSIZE]; //flags to ignore data corresponding to specific parameters (x,y,z) (0=don't ignore,1=ignore,2=slice at specified value)
   long double sliceVal[POWSIZE]; //value to slice grid at for each parameter, if ignorePar==2 
   int numVar;
@@ -37,37 +95,74 @@ typedef struct
   long double uniWeightVal;//value specified for uniform weights
   int filter;//0=no filter,1=linear filter
   double filterSigma;//sigma value to be used for filter
+  int ransac;//0=don't use RANSAC, 1=use RANSAC to select the data to fit
+  int ransacIter;//number of RANSAC hypotheses (iterations)
+  long double ransacThreshold;//maximum distance from a RANSAC hypothesis for data to be counted as an inlier
   int refitFilter;//0=don't refit fiter, 1=refit filter
   long double refitFilterDist;//distance used when refit filtering
+  int refitClip;//0=don't use iterative refit clipping, 1=use it
+  long double refitClipSigma;//number of sigma (RMS normalized residuals) beyond which data is rejected when refit clipping
+  int refitClipMaxIter;//maximum number of refit clipping iterations
   int forceZeroX,forceZeroY,forceZeroZ;//whether or not to attempt forcing the fitted minimum to zero for x,y,z
   int numCIEvalPts; //number of points to evaluate the confidence interval bounds at (where applicable)
   long double CIEvalPts[100]; //array of x values at which to evaluate the confidence interval at
+  char evalPointsFile[256];//file of points to evaluate the fit function at, '-' for standard input (EVAL_POINTS option, empty if not used)
+  char evalOutFile[256];//file to write the evaluated points to, '-' for standard output
   int findMinGridPoint,findMaxGridPoint;
+  int jackknife;//0=don't compute jackknife diagnostics, 1=compute them
+  char jackknifeFile[256];//file to write per-point jackknife diagnostics to (empty if not used)
+  int residuals;//0=don't report residual statistics, 1=report them (RESIDUALS option)
+  char residualFile[256];//file to write per-point residuals to (empty if not used)
+  int residualFileFormat;//0=text, 1=binary (doubles), -1=invalid
+  int robustFit;//0=don't use robust fitting, 1=Huber weights, 2=Tukey bisquare weights
+  long double robustConst;//tuning constant of the robust weight function
+  poly_basis_type basis;//terms of the fit function (see poly_basis.c)
 }parameters;
 
+//index of the data points by the distinct values of each variable (see grid_index.c)
+typedef struct
+{
+  int numVar;//number of variables indexed
+  int numPts;//number of data points indexed
+  int numVal[POWSIZE];//number of distinct values of each variable
+  long double *val[POWSIZE];//distinct values of each variable, in increasing order
+  int *firstPt[POWSIZE];//lowest data point # having each distinct value
+  int *coord[POWSIZE];//lattice coordinate of each data point (index into val), indexed by variable # then data point #
+  int *bucketStart[POWSIZE];//bucket of each distinct value (numVal+1 entries), the data points in bucket v of variable k are bucketPts[k][bucketStart[k][v]] to bucketPts[k][bucketStart[k][v+1]-1]
+  int *bucketPts[POWSIZE];//data point #s grouped by value, in increasing order within each bucket
+}grid_index_type;
+
+//entry used to sort the distinct values of a variable when building the index
+typedef struct
+{
+  long double val;//value of the variable
+  int ind;//first data point # with the value
+}grid_index_entry;
+
 typedef struct
 {
   int lines;//number of data points
   long double x[POWSIZE][MAXFILELENGTH];//array containing data points from the file, indexed by variable # then data point #
   long double max_x[POWSIZE],min_x[POWSIZE],max_m,min_m;//maximum and minimum values
-  long double msum;//sum of measurements
-  long double xpowsum[POWSIZE][POWSIZE];//sums of (x1)^0, (x1)^1, (x1)^2, etc. indexed first by variable # then by power #
-  long double mxpowsum[POWSIZE][POWSIZE];//sums of m*(x1)^0, m*(x1)^1, m*(x1)^2, etc. indexed first by variable # then by power #
-  long double mxxpowsum[POWSIZE][POWSIZE][POWSIZE][POWSIZE];//sums of m*(y1)*(x1)^0, m*(y1)*(x1)^1, m*(y1)*(x1)^2, etc. indexed by variable 1 #, variable 1 power #, variable 2 #, variable 2 power #
-  long double xxpowsum[POWSIZE][POWSIZE][POWSIZE][POWSIZE];//sums of (y1), (y1)*(x1), (y1)*(x1)^2, etc. indexed by variable 1 #, variable 1 power #, variable 2 #, variable 2 power #
-  long double xxxpowsum[POWSIZE][POWSIZE][POWSIZE][POWSIZE][POWSIZE][POWSIZE];//sums of (z1)*(y1)*(x1), (z1)*(y1)*(x1)^2, etc. indexed by variable 1 #, variable 1 power #, variable 2 #, variable 2 power #, variable 3 #, variable 3 power #
+  long double filterMean,filterM2;//running mean and sum of squared deviations of x/y, for the linear filter
+  int filterNum;//number of data points included in the linear filter statistics
+  long double moment[MAX_MOMENTS];//weighted sums of each monomial in the moment table over the data
+  long double mMoment[MAX_MOMENTS];//weighted sums of the data value times each monomial which is a term of the fit function
+  int sumsPrecision;//0=sums were accumulated in double precision, 1=in full precision
+  grid_index_type index;//index of the data points, built for plotting
+  double *robustWt;//robust weight of each data point, which multiplies its weight in the fit sums and chisq only (see robust_fit.c), NULL if not used
 }data;
 
 typedef struct
 {
   long double fixedParVal[POWSIZE];//values to fix parameters at when plotting in less dimensions than the data provides
-  double data[POWSIZE][POWSIZE][MAXFILELENGTH];//array containing data points to be plotted, indexed by plot # then variable # then data point #
+  double *data[POWSIZE][POWSIZE];//data points to be plotted, indexed by plot # then variable # then data point # (allocated when plotting)
   double max_m,min_m;//maximum and minimum values
-  double ciData[POWSIZE][POWSIZE][MAXFILELENGTH];//array containing confidence interval data points to be plotted, indexed by plot # then variable # then data point #
-  double fit[POWSIZE][POWSIZE][MAXFILELENGTH];//array containing fit data to be plotted, indexed by plot # then variable # then data point #
-  int numFitPlotPts;//number of data points reserved for plotting fit data
-  int numFitPtsPerVar;
+  double *fit[POWSIZE][POWSIZE];//fit data to be plotted, indexed by plot # then variable # then data point # (allocated when plotting)
+  int fitPlotSize[POWSIZE];//number of points used to plot the fit function in each plot
+  int fitPlotBlock[POWSIZE];//number of points in each block (row) of a fit surface plot
   int plotDataSize[POWSIZE];
+  int plotDataFullSize[POWSIZE];//number of data points available for each plot, before downsampling
   int numPlots;
   int axisLabelStyle[POWSIZE][POWSIZE];//0=normal,1=scientific notation
 }plot_data;
@@ -82,13 +177,16 @@ typedef struct
   long double vertUBound[POWSIZE],vertLBound[POWSIZE];//upper and lower bounds of the vertex
   long double vertVal; //value of the fit function at the vertex;
   long double chisq,ndf;
+  long double solveCond;//condition number of the normal equations (after diagonal scaling)
+  long double solveResidual;//relative residual of the solution of the normal equations (mixed precision solve)
+  int solveRefineIter;//number of refinement steps used to solve the normal equations (-1 if full precision was needed)
   int vertBoundsFound[POWSIZE];
   //confidence interval data
-  int ciEEValues;//number of values on the error ellipse/ellipsoid used to get confidence interval
-  double ciEEVal[POWSIZE][CI_EE_DIM];//values on the error ellipse/ellipsoid used to get confidence interval
   double ciUVal[POWSIZE][CI_DIM];//values on the upper confidence interval curve
   double ciLVal[POWSIZE][CI_DIM];//values on the lower confidence interval curve
   double ciXVal[POWSIZE][CI_DIM];//x values on the confidence interval curve
+  double ciContour[3][CI_DIM];//x, y, and fit values around the boundary of the confidence region of 2 parameter fits (see quad_ci.c)
+  int ciContourSize;//number of points in ciContour (0 if not found)
   //fit forms
   char fitForm[POWSIZE][256];//string containing form of the fitted equation
   /*char ciUForm[POWSIZE][256];//string containing form of the upper confidence interval
@@ -97,6 +195,112 @@ typedef struct
   char piLForm[POWSIZE][256];//string containing form of the lower prediction interval*/
 }fit_results;
 
+//range of RANSAC hypotheses evaluated by a thread, and the best of them (see ransac.c)
+typedef struct
+{
+  const parameters *p;
+  const data *d;
+  const double *xd,*yd;//data point values in double precision, for scoring hypotheses
+  int start,end;//hypotheses evaluated are start to end-1
+  int bestInliers;//number of inliers of the best hypothesis
+  double bestCost;//sum of squared inlier residuals of the best hypothesis
+  long double bestA[3];//model coefficients of the best hypothesis
+  int numDegenerate;//number of degenerate subsets drawn
+}ransac_thread_data;
+
+//range of data points reweighted by a thread during a robust fit (see robust_fit.c)
+typedef struct
+{
+  const parameters *p;
+  const data *d;
+  const fit_results *fr;
+  int start,end;//data points processed are start to end-1
+  long double *res;//normalized residuals of the data points
+  long double *absRes;//absolute values of the normalized residuals
+  double *u;//normalized residuals in units of the robust scale
+  double *wt;//robust weights
+  long double scale;//robust scale estimate
+  int numDownweighted,numRejected;//number of data points beyond the tuning constant, number with zero weight
+}robust_thread_data;
+
+//statistics of the residuals of a fit (see residuals.c)
+typedef struct
+{
+  long double chisq;//sum of squared normalized residuals
+  long double mean;//mean residual
+  long double rms;//RMS residual
+  long double rmsPull;//RMS normalized residual (residual divided by the data weight)
+  long double maxPull;//largest absolute normalized residual
+  int maxPullInd;//data point with the largest absolute normalized residual
+  int hist[RESIDUAL_HIST_BINS+2];//histogram of normalized residuals, the first and last bins count those outside of the range
+}residual_stats_type;
+
+//partial sums of the residuals of a batch of data points (see residuals.c)
+typedef struct
+{
+  long double chisq,sum,sumSq,sumPullSq;//sums of weighted squared residuals, residuals, squared residuals, squared normalized residuals
+  long double maxPull;//largest absolute normalized residual
+  int maxPullInd;//data point with the largest absolute normalized residual
+  int hist[RESIDUAL_HIST_BINS+2];//histogram of normalized residuals
+}residual_batch_type;
+
+//range of batches of data points whose residuals are found by a thread (see residuals.c)
+typedef struct
+{
+  const parameters *p;
+  const data *d;
+  const fit_results *fr;
+  int start,end;//batches processed are start to end-1
+  residual_batch_type *batch;//partial sums of each batch
+  FILE *out;//file to write each data point to (NULL if not used)
+}residual_thread_data;
+
+//function evaluating the fit function at the specified point (see fit_models.c)
+typedef long double (*fit_eval_func)(const parameters *, const fit_results *, const long double *);
+
+//function evaluating the fit function at n points, given as columns of
+//variable values (indexed by variable # then point #)
+typedef void (*fit_eval_batch_func)(const parameters *, const fit_results *, const long double * const *, int, long double *);
+//as above, in double precision (eg. for plotting)
+typedef void (*fit_eval_batch_double_func)(const parameters *, const fit_results *, const double * const *, int, double *);
+
+//description of a fit type (see fit_models.c)
+typedef struct fit_model_struct
+{
+  const char *name;//fit type, as specified with the FIT option
+  int numVar;//number of variables (0 if set by the fit function, eg. NparpolyD)
+  int numCoeff;//number of fit coefficients (0 if set by the fit function)
+  const int (*terms)[3];//terms of the fit function (power of each variable), NULL if set by the fit function
+  int linearCoeff;//1 if the fit function is linear in its coefficients (fit using the moment table), 0 otherwise (eg. Deming regression)
+  int plotCI;//1 if confidence bands are plotted by default
+  int plotVertex;//1 if the fit vertex is marked on 3d plots
+  fit_eval_func eval;//evaluates the fit function at a point
+  fit_eval_batch_func evalBatch;//evaluates the fit function at many points
+  fit_eval_batch_double_func evalBatchDouble;//evaluates the fit function at many points, in double precision
+  void (*fit)(const parameters *, const data *, fit_results *, plot_data *, int);//fits the data, printing the results if requested
+  void (*plotForm)(const parameters *, fit_results *, const plot_data *);//sets the functional forms of the plotted fit function, NULL if the fit type can't be plotted
+}fit_model_type;
+
+typedef struct
+{
+  //properties set by the user, describing a quadratic model f(x) = 0.5*x^T*H*x + g^T*x + c
+  int dim;//number of variables
+  long double hess[MAX_DIM][MAX_DIM];//Hessian matrix (H)
+  long double grad[MAX_DIM];//gradient at the origin (g)
+  long double c;//value at the origin
+  long double delta;//change in value from the reference value defining the confidence region
+  int useRefVal;//0=reference value is the value at the vertex, 1=reference value is refVal
+  long double refVal;//reference value (eg. the value at a constrained vertex)
+  //properties determined by getQuadCI
+  int type;//1=minimum, -1=maximum, 0=saddle point or degenerate
+  long double vert[MAX_DIM];//vertex (stationary point)
+  long double vertVal;//value at the vertex
+  long double eigVal[MAX_DIM];//eigenvalues of the Hessian
+  long double eigVec[MAX_DIM][MAX_DIM];//principal axes of the confidence region (eigenvectors of the Hessian, in columns)
+  long double axisLength[MAX_DIM];//semi-axis lengths of the confidence region along the principal axes
+  long double halfWidth[MAX_DIM];//half-widths of the confidence region projected onto each variable
+}quad_ci_type;
+
 //evil global variables
 gnuplot_ctrl *handle;
 int plotOpen;//1 if plots are being displayed, 0 otherwise
@@ -1,10 +1,69 @@
+//forward declarations
+void addPointToLinearFilterStats(data *, int);
+int setPolyBasis(parameters *);
+const fit_model_type * getFitModel(const char *);
+void setPolyBasisRange(poly_basis_type *, const data *);
+
+//delta values for confidence intervals at each confidence level, indexed by
+//the number of free parameters - 1
+static const long double ciDelta1Sigma[POWSIZE-2]={1.00,2.30,3.53,4.72,5.89,7.04,8.18,9.30,10.42,11.54};
+static const long double ciDelta2Sigma[POWSIZE-2]={4.00,6.17,8.02,9.72,11.3,12.8,14.3,15.8,17.2,18.6};
+static const long double ciDelta3Sigma[POWSIZE-2]={9.00,11.8,14.2,16.3,18.2,20.1,21.9,23.6,25.3,26.9};
+static const long double ciDelta90[POWSIZE-2]={2.71,4.61,6.25,7.78,9.24,10.6,12.0,13.4,14.7,16.0};
+
+//recomputes the maximum and minimum values of the data, after data points
+//have been removed (eg. by the data filters or refit clipping)
+void getDataRange(data * d, const parameters * p)
+{
+  int i,j;
+  for(i=0;i<p->numVar;i++)
+    {
+      d->max_x[i]=-1*BIG_NUMBER;
+      d->min_x[i]=BIG_NUMBER;
+    }
+  d->max_m=-1*BIG_NUMBER;
+  d->min_m=BIG_NUMBER;
+  for(j=0;j<d->lines;j++)
+    {
+      if(d->x[p->numVar][j] > d->max_m)
+        d->max_m=d->x[p->numVar][j];
+      if(d->x[p->numVar][j] < d->min_m)
+        d->min_m=d->x[p->numVar][j];
+      for(i=0;i<p->numVar;i++)
+        {
+          if(d->x[i][j] > d->max_x[i])
+            d->max_x[i]=d->x[i][j];
+          if(d->x[i][j] < d->min_x[i])
+            d->min_x[i]=d->x[i][j];
+        }
+    }
+}
+
+//reads numerical values from a line of the data file into the data point
+//with the specified index (one value per variable #), stopping at the first
+//value that can't be read
+//returns the number of values read
+int readDataLine(const char * str, data * d, int ind)
+{
+  int i;
+  char *end;
+  for(i=0;i<POWSIZE;i++)
+    {
+      d->x[i][ind]=strtold(str,&end);
+      if(end==str)
+        break;
+      str=end;
+    }
+  return i;
+}
+
 //imports data from file
 void importData(data * d, parameters * p)
 {
 
   FILE *inp;
   int i,j;
-  char str[256],str2[256],str3[256];
+  char str[256],str2[256],str3[256],str4[256];
   long double val;
   
   //initialize values
@@ -12,6 +71,7 @@ void importData(data * d, parameters * p)
   int lineValid;
   int linenum=0;
   p->plotData=0;
+  p->plotMaxPts=PLOT_MAX_POINTS;
   p->refitFilter=0;
   for(i=0;i<POWSIZE;i++)
     {
@@ -37,11 +97,57 @@ void importData(data * d, parameters * p)
     {
       if(fgets(str,256,inp)!=NULL)
         {
-        	if(sscanf(str,"%s %s %Lf",str2,str3,&val)==3)
+          if((sscanf(str,"%s%n",str2,&i)==1)&&(strcmp(str2,"FIT_TERMS")==0))
+            strcpy(p->fitTerms,str+i);//user-defined fit terms, read when setting up the fit function
+          else if((sscanf(str,"%s %s %s",str2,str3,str4)==3)&&(strcmp(str2,"PLOT_EXPORT")==0))
+            {
+              strcpy(p->plotExportPath,str4);
+              if(strcmp(str3,"png")==0)
+                p->plotExport=1;
+              else if(strcmp(str3,"svg")==0)
+                p->plotExport=2;
+              else if(strcmp(str3,"pdf")==0)
+                p->plotExport=3;
+              else
+                p->plotExport=-1;
+            }
+          else if((sscanf(str,"%s %s %s",str2,str3,str4)==3)&&(strcmp(str2,"EVAL_POINTS")==0))
+            {
+              strcpy(p->evalPointsFile,str3);
+              strcpy(p->evalOutFile,str4);
+            }
+          else if((sscanf(str,"%s %s %s",str2,str3,str4)==3)&&(strcmp(str2,"RESIDUALS")==0))
+            {
+              p->residuals=1;//report residual statistics
+              strcpy(p->residualFile,str3);
+              if(strcmp(str4,"text")==0)
+                p->residualFileFormat=0;
+              else if(strcmp(str4,"binary")==0)
+                p->residualFileFormat=1;
+              else
+                p->residualFileFormat=-1;
+            }
+        	else if(sscanf(str,"%s %s %Lf",str2,str3,&val)==3)
             {
               if(strcmp(str2,"FIT")==0){
                 strcpy(p->fitType,str3);
                 p->fitOpt = val;
+              }else if(strcmp(str2,"REFIT_CLIP")==0){
+                p->refitClip=1;
+                p->refitClipSigma=(long double)atof(str3);
+                p->refitClipMaxIter=(int)val;
+              }else if(strcmp(str2,"RANSAC")==0){
+                p->ransac=1;
+                p->ransacIter=atoi(str3);
+                p->ransacThreshold=val;
+              }else if(strcmp(str2,"FIT_ROBUST")==0){
+                if(strcmp(str3,"huber")==0)
+                  p->robustFit=1;
+                else if(strcmp(str3,"tukey")==0)
+                  p->robustFit=2;
+                else
+                  p->robustFit=-1;
+                p->robustConst=val;
               }else if(strcmp(str2,"SLICE_PAR")==0){
                 if(strcmp(str3,"x")==0){
                   p->ignorePar[0]=2;
@@ -75,6 +181,57 @@ void importData(data * d, parameters * p)
               		p->CIEvalPts[p->numCIEvalPts]=(long double)atof(str3);
                   p->numCIEvalPts++;
               	}
+              else if(strcmp(str2,"REFIT_CLIP")==0)
+              	{
+              		p->refitClip=1;//use iterative refit clipping
+              		p->refitClipSigma=(long double)atof(str3);
+              		p->refitClipMaxIter=10;//default maximum number of iterations
+              	}
+              else if(strcmp(str2,"FIT_ROBUST")==0)
+              	{
+              		//use default tuning constants (95% efficiency for normally distributed data)
+              		if(strcmp(str3,"huber")==0)
+              			{
+              				p->robustFit=1;
+              				p->robustConst=1.345;
+              			}
+              		else if(strcmp(str3,"tukey")==0)
+              			{
+              				p->robustFit=2;
+              				p->robustConst=4.685;
+              			}
+              		else
+              			p->robustFit=-1;
+              	}
+              else if(strcmp(str2,"FIT_BASIS")==0)
+              	{
+              		//basis of polynomials used when solving for the fit coefficients
+              		if(strcmp(str3,"monomial")==0)
+              			p->fitBasis=0;
+              		else if(strcmp(str3,"chebyshev")==0)
+              			p->fitBasis=1;
+              		else if(strcmp(str3,"legendre")==0)
+              			p->fitBasis=2;
+              		else if(strcmp(str3,"scaled")==0)
+              			p->fitBasis=3;
+              		else
+              			p->fitBasis=-1;
+              	}
+              else if(strcmp(str2,"JACKKNIFE")==0)
+              	{
+              		p->jackknife=1;//compute jackknife diagnostics
+              		strcpy(p->jackknifeFile,str3);
+              	}
+              else if(strcmp(str2,"EVAL_POINTS")==0)
+              	{
+              		strcpy(p->evalPointsFile,str3);
+              		strcpy(p->evalOutFile,"-");//write to standard output
+              	}
+              else if(strcmp(str2,"RESIDUALS")==0)
+              	{
+              		p->residuals=1;//report residual statistics
+              		strcpy(p->residualFile,str3);
+              	}
               else if(strcmp(str2,"IGNORE_PAR")==0)
               	{
                   if(strcmp(str3,"x")==0)
@@ -101,9 +258,17 @@ void importData(data * d, parameters * p)
 						p->findMinGridPoint=1;//find the grid point corresponding to the smallest value of the fit function
           else if(strcmp(str,"FIND_MAX_GRID_POINT_FROM_FIT\n")==0)
 						p->findMaxGridPoint=1;//find the grid point corresponding to the smallest value of the fit function
+          else if(strcmp(str,"FULL_PRECISION\n")==0)
+						p->fullPrecision=1;//always generate sums and solve in full precision
+          else if(strcmp(str,"JACKKNIFE\n")==0)
+						p->jackknife=1;//compute jackknife diagnostics
+          else if(strcmp(str,"RESIDUALS\n")==0)
+						p->residuals=1;//report residual statistics
         }
     }
   //check the fit type
+  if(strcmp(p->fitTerms,"")!=0)
+    strcpy(p->fitType,"terms");//user-defined fit terms (FIT_TERMS option)
   if(strcmp(p->fitType,"poly1")==0)
   	strcpy(p->fitType,"lin");
   else if(strcmp(p->fitType,"par1")==0)
@@ -116,31 +281,27 @@ void importData(data * d, parameters * p)
   	strcpy(p->fitType,"3parpoly2");
   else if(strcmp(p->fitType,"par3")==0)
   	strcpy(p->fitType,"3parpoly2");
-  if(strcmp(p->fitType,"poly2")==0)
-    p->numVar=1;
-  else if(strcmp(p->fitType,"2parpoly2")==0)
-    p->numVar=2;
-  else if(strcmp(p->fitType,"3parpoly2")==0)
-    p->numVar=3;
-  else if(strcmp(p->fitType,"lin")==0)
-  	{
-    	p->numVar=1;
-    	p->plotCI=1;
+  p->model=getFitModel(p->fitType);//see fit_models.c
+  if(p->model->numVar>0)//preset fit types
+    {
+      p->numVar=p->model->numVar;
+      p->plotCI=p->model->plotCI;
     }
-  else if(strcmp(p->fitType,"lin_deming")==0)
-    p->numVar=1;
-  else if(strcmp(p->fitType,"poly3")==0)
-    p->numVar=1;
-  else if(strcmp(p->fitType,"poly4")==0)
-    p->numVar=1;
-  else if(strcmp(p->fitType,"2parpoly3")==0)
-    p->numVar=2;
+  else if(strcmp(p->fitType,"terms")==0)
+    {
+      if(setPolyBasis(p)==0)//read the user-defined terms (see poly_basis.c)
+        exit(-1);
+      p->numVar=p->basis.numVar;
+    }
+  else if(setPolyBasis(p)==1)//fit types of the form NparpolyD (see poly_basis.c)
+    p->numVar=p->basis.numVar;
   else if(strcmp(p->fitType,"")==0)
     {
       printf("ERROR: a fit type must be specified.\nMake sure to include a line in the file with the format\n\nFIT  type\n\nwhere 'type' is a valid fit type (eg. 'par1').\n");
       printf("\nValid fit types are:\n\nlin (line)\nlin_deming (line with errors in x)\npoly1 (1st order polynomial)\n");
       printf("poly2 (2nd order polynomial)\npoly3 (3rd order polynomial)\npoly4 (4th order polynomial)\npar1 (2nd order polynomial)\n");
       printf("2parpoly2 (2nd order bivariate polynomial)\n2parpoly3 (3rd order bivariate polynomial)\n3parpoly2 (2nd order trivariate polynomial)\n");
+      printf("NparpolyD (order D polynomial in N variables, eg. 4parpoly2, with at most %i terms)\n",MAX_DIM);
       exit(-1);
     }
   else
@@ -149,6 +310,7 @@ void importData(data * d, parameters * p)
       printf("\nValid fit types are:\n\nlin (line)\nlin_deming (line with errors in x)\npoly1 (1st order polynomial)\n");
       printf("poly2 (2nd order polynomial)\npoly3 (3rd order polynomial)\npoly4 (4th order polynomial)\npar1 (2nd order polynomial)\n");
       printf("2parpoly2 (2nd order bivariate polynomial)\n2parpoly3 (3rd order bivariate polynomial)\n3parpoly2 (2nd order trivariate polynomial)\n");
+      printf("NparpolyD (order D polynomial in N variables, eg. 4parpoly2, with at most %i terms)\n",MAX_DIM);
       exit(-1);
     }
     
@@ -160,12 +322,36 @@ void importData(data * d, parameters * p)
         printf("Will fit a paraboloid with %i free parameters.\n",p->numVar);
       if(strcmp(p->fitType,"3parpoly2")==0)
         printf("Will fit a paraboloid with %i free parameters.\n",p->numVar);
+      if(strcmp(p->fitType,"terms")==0)
+        printf("Will fit user-defined terms with %i free parameter(s).\n",p->numVar);
       if(p->uniWeight==1)
       	printf("Uniform weights of value %0.3Lf will be taken.\n",p->uniWeightVal);
       else if(p->readWeights==0)
         printf("No weights will be taken for data points.\n");
       else if(p->readWeights==1)
         printf("Weights for data points will be taken from the last column of the data file.\n");
+      if(p->fitBasis==1)
+        printf("Will fit using Chebyshev polynomials (coefficients reported for the monomial terms).\n");
+      else if(p->fitBasis==2)
+        printf("Will fit using Legendre polynomials (coefficients reported for the monomial terms).\n");
+      else if(p->fitBasis==3)
+        printf("Will fit using centered and scaled variables (coefficients reported for the original variables).\n");
+      if(p->fullPrecision==1)
+        printf("Will generate sums and solve the fit equations in full precision.\n");
+      if(p->plotExport>0)
+        printf("Will export plots to file(s): %s (%s format)\n",p->plotExportPath,(p->plotExport==1) ? "png" : ((p->plotExport==2) ? "svg" : "pdf"));
+      if(strcmp(p->evalPointsFile,"")!=0)
+        printf("Will evaluate the fit at the points in: %s\n",(strcmp(p->evalPointsFile,"-")==0) ? "standard input" : p->evalPointsFile);
+      if(strcmp(p->residualFile,"")!=0)
+        printf("Will write residuals to file: %s (%s format)\n",p->residualFile,(p->residualFileFormat==1) ? "binary" : "text");
+      if(p->refitClip==1)
+        printf("Refit clip used with sigma: %0.3LE, maximum iterations: %i\n",p->refitClipSigma,p->refitClipMaxIter);
+      if(p->ransac==1)
+        printf("RANSAC used with iterations: %i, threshold: %0.3LE\n",p->ransacIter,p->ransacThreshold);
+      if(p->robustFit==1)
+        printf("Robust fit used with Huber weights, tuning constant: %0.3LE\n",p->robustConst);
+      else if(p->robustFit==2)
+        printf("Robust fit used with Tukey bisquare weights, tuning constant: %0.3LE\n",p->robustConst);
       if(p->ignorePar[0]==1)
         printf("Will ignore data corresponding to the x variable.\n");
       if(p->ignorePar[1]==1)
@@ -181,16 +367,60 @@ void importData(data * d, parameters * p)
     }
   fclose(inp);
   
+  if((p->refitClip==1)&&((p->refitClipSigma<=0.)||(p->refitClipMaxIter<1)))
+    {
+      printf("ERROR: could not properly set refit clipping (REFIT_CLIP option).\nThe sigma value and maximum number of iterations must be greater than 0.\n");
+      exit(-1);
+    }
+  
+  if((p->robustFit<0)||((p->robustFit>0)&&(p->robustConst<=0.)))
+    {
+      printf("ERROR: could not properly set robust fitting (FIT_ROBUST option).\nThe weight function must be 'huber' or 'tukey', and the tuning constant must be greater than 0.\n");
+      exit(-1);
+    }
+  
+  if(p->residualFileFormat<0)
+    {
+      printf("ERROR: could not properly set residual output (RESIDUALS option).\nThe file format must be 'text' or 'binary'.\n");
+      exit(-1);
+    }
+  
+  if(p->plotExport<0)
+    {
+      printf("ERROR: could not properly set plot export (PLOT_EXPORT option).\nThe format must be 'png', 'svg', or 'pdf'.\n");
+      exit(-1);
+    }
+  
+  if(p->fitBasis<0)
+    {
+      printf("ERROR: could not properly set the fit basis (FIT_BASIS option).\nThe basis must be 'monomial', 'chebyshev', 'legendre', or 'scaled'.\n");
+      exit(-1);
+    }
+  
+  if(p->ransac==1)
+    {
+      if((p->ransacIter<1)||(p->ransacThreshold<=0.))
+        {
+          printf("ERROR: could not properly set RANSAC (RANSAC option).\nThe number of iterations and the threshold value must be greater than 0.\n");
+          exit(-1);
+        }
+      if((p->model->numVar!=1)||(p->model->numCoeff<2)||(p->model->numCoeff>3))//lines and parabolas
+        {
+          printf("ERROR: RANSAC (RANSAC option) is only available for the lin, lin_deming, and poly2 fit types.\n");
+          exit(-1);
+        }
+    }
+  
+  //set up the terms of the fit function (see poly_basis.c)
+  setPolyBasis(p);
+  
   //by default, use the appropriate 1-sigma confidence level
   strcpy(p->ciSigmaDesc,"1-sigma (68.3%)");
-  if(p->numVar==1)
-  	p->ciDelta=1.00;
-  else if(p->numVar==2)
-  	p->ciDelta=2.30;
-  else if(p->numVar==3)
-  	p->ciDelta=3.53;
+  if((p->numVar>=1)&&(p->numVar<=POWSIZE-2))
+  	p->ciDelta=ciDelta1Sigma[p->numVar-1];
   else
   	p->ciDelta=0.00;
+  p->ciBandDelta=ciDelta1Sigma[0];
   
   
   //setup data for if parameters are ignored/sliced
@@ -209,7 +439,7 @@ void importData(data * d, parameters * p)
     {
       if(fgets(str,256,inp)!=NULL)
         {
-          numCols = sscanf(str,"%Lf %Lf %Lf %Lf %Lf %Lf",&d->x[0][d->lines],&d->x[1][d->lines],&d->x[2][d->lines],&d->x[3][d->lines],&d->x[4][d->lines],&d->x[5][d->lines]);
+          numCols = readDataLine(str,d,d->lines);
           if( ((p->numVar>0)&&(p->readWeights==0)&&(numCols==p->numVar+1+numIgnoredPar)) || ((p->numVar>0)&&(p->readWeights==1)&&(numCols==p->numVar+2+numIgnoredPar)) )
             {
               lineValid=1;
@@ -287,6 +517,10 @@ void importData(data * d, parameters * p)
 				          			d->min_x[i]=d->x[i][d->lines];
               			}
               		
+              		//accumulate linear filter statistics while reading
+              		if((p->filter==1)&&(p->numVar==1))
+              			addPointToLinearFilterStats(d,d->lines);
+              		
               		//go to the next data point
                 	d->lines++;
                 }
@@ -295,7 +529,8 @@ void importData(data * d, parameters * p)
             }
           else if(sscanf(str,"%s %s",str2,str3)>=2)
             {
-              numCols = sscanf(str,"%s %Lf %Lf %Lf %Lf %Lf",str2,&d->x[0][d->lines],&d->x[1][d->lines],&d->x[2][d->lines],&d->x[3][d->lines],&d->x[4][d->lines]);
+              sscanf(str,"%s%n",str2,&i);
+              numCols = 1 + readDataLine(str+i,d,d->lines);
               if((p->numVar>0)&&(numCols==p->numVar+1+numIgnoredPar))
                 {
                   if(strcmp(str2,"UPPER_LIMITS")==0)
@@ -359,6 +594,24 @@ void importData(data * d, parameters * p)
                       if(p->verbose<1)
                         printf("Will plot data using mode: %s\n",p->plotMode);
                     }
+                  if(strcmp(str2,"PLOT_MAX_POINTS")==0)
+                    {
+                      if(sscanf(str3,"%i",&p->plotMaxPts)&&(p->plotMaxPts>=0))
+                        {
+                          if(p->verbose<1)
+                            {
+                              if(p->plotMaxPts==0)
+                                printf("Will plot all data points without downsampling.\n");
+                              else
+                                printf("Will downsample plots to at most ~%i data points.\n",p->plotMaxPts);
+                            }
+                        }
+                      else
+                        {
+                          printf("ERROR: could not properly set the maximum number of plotted data points (PLOT_MAX_POINTS option).\n");
+                          exit(-1);
+                        }
+                    }
                   if(strcmp(str2,"DATA_TYPE")==0)
                     {
                       strcpy(p->dataType,str3);
@@ -403,6 +656,7 @@ void importData(data * d, parameters * p)
                         {
                           printf("Set confidence interval delta value to: %0.3LE\n",p->ciDelta);
                           sprintf(p->ciSigmaDesc,"custom (delta=%Lf)",p->ciDelta);//indicate custom confidence interval
+                          p->ciBandDelta=p->ciDelta;//also used for the pointwise band (EVAL_POINTS option)
                         }
                       else
                         {
@@ -416,55 +670,43 @@ void importData(data * d, parameters * p)
                       
                       if(strcmp(str3,"1")==0)
                         {
-                          if(p->numVar==1)
-                            p->ciDelta=1.00;
-                          else if(p->numVar==2)
-                            p->ciDelta=2.30;
-                          else if(p->numVar==3)
-                            p->ciDelta=3.53;
+                          if((p->numVar>=1)&&(p->numVar<=POWSIZE-2))
+                            p->ciDelta=ciDelta1Sigma[p->numVar-1];
                           else
                             p->ciDelta=0.00;
                           printf("Set confidence interval to 1-sigma (68.3%%), delta value: %0.3LE\n",p->ciDelta);
                           strcpy(p->ciSigmaDesc,"1-sigma (68.3%)");
+                          p->ciBandDelta=ciDelta1Sigma[0];
                         }
                       else if(strcmp(str3,"2")==0)
                         {
-                          if(p->numVar==1)
-                            p->ciDelta=4.00;
-                          else if(p->numVar==2)
-                            p->ciDelta=6.17;
-                          else if(p->numVar==3)
-                            p->ciDelta=8.02;
+                          if((p->numVar>=1)&&(p->numVar<=POWSIZE-2))
+                            p->ciDelta=ciDelta2Sigma[p->numVar-1];
                           else
                             p->ciDelta=0.00;
                           printf("Set confidence interval to 2-sigma (95.4%%), delta value: %0.3LE\n",p->ciDelta);
                           strcpy(p->ciSigmaDesc,"2-sigma (95.4%)");
+                          p->ciBandDelta=ciDelta2Sigma[0];
                         }
                       else if(strcmp(str3,"3")==0)
                         {
-                          if(p->numVar==1)
-                            p->ciDelta=9.00;
-                          else if(p->numVar==2)
-                            p->ciDelta=11.8;
-                          else if(p->numVar==3)
-                            p->ciDelta=14.2;
+                          if((p->numVar>=1)&&(p->numVar<=POWSIZE-2))
+                            p->ciDelta=ciDelta3Sigma[p->numVar-1];
                           else
                             p->ciDelta=0.00;
                           printf("Set confidence interval to 3-sigma (99.73%%), delta value: %0.3LE\n",p->ciDelta);
                           strcpy(p->ciSigmaDesc,"3-sigma (99.73%)");
+                          p->ciBandDelta=ciDelta3Sigma[0];
                         }
                       else if(strcmp(str3,"90%")==0)
                         {
-                          if(p->numVar==1)
-                            p->ciDelta=2.71;
-                          else if(p->numVar==2)
-                            p->ciDelta=4.61;
-                          else if(p->numVar==3)
-                            p->ciDelta=6.25;
+                          if((p->numVar>=1)&&(p->numVar<=POWSIZE-2))
+                            p->ciDelta=ciDelta90[p->numVar-1];
                           else
                             p->ciDelta=0.00;
                           printf("Set confidence interval to 90%%, delta value: %0.3LE\n",p->ciDelta);
                           strcpy(p->ciSigmaDesc,"90%");
+                          p->ciBandDelta=ciDelta90[0];
                         }
                       else
                         {
@@ -486,7 +728,8 @@ void importData(data * d, parameters * p)
                 }
               else if((strcmp(str,"PARAMETERS\n")!=0)&&(strcmp(str,"COEFFICIENTS\n")!=0)&&(strcmp(str,"WEIGHTED\n")!=0)&&
                       (strcmp(str,"WEIGHT\n")!=0)&&(strcmp(str,"WEIGHTS\n")!=0)&&(strcmp(str,"UNWEIGHTED\n")!=0)&&
-                      (strcmp(str,"ZEROX\n")!=0)&&(strcmp(str,"ZEROY\n")!=0)&&(strcmp(str,"FIND_MIN_GRID_POINT_FROM_FIT\n")!=0)&&(strcmp(str,"FIND_MAX_GRID_POINT_FROM_FIT\n")!=0))
+                      (strcmp(str,"ZEROX\n")!=0)&&(strcmp(str,"ZEROY\n")!=0)&&(strcmp(str,"FIND_MIN_GRID_POINT_FROM_FIT\n")!=0)&&(strcmp(str,"FIND_MAX_GRID_POINT_FROM_FIT\n")!=0)&&
+                      (strcmp(str,"JACKKNIFE\n")!=0)&&(strcmp(str,"FULL_PRECISION\n")!=0)&&(strcmp(str,"RESIDUALS\n")!=0))
                 if(p->verbose<1)
                   printf("WARNING: Improperly formatted data on line %i of the input file.\nLine content: %s",linenum+1,str);
             }
@@ -529,4 +772,8 @@ void importData(data * d, parameters * p)
         printf("%i line(s) of data skipped (outside of fit region limits).\n",invalidLines);
     }
   
+  //map the variables for the FIT_BASIS option (see poly_basis.c)
+  if(p->basis.mapBasis>0)
+    setPolyBasisRange(&p->basis,d);
+  
 }
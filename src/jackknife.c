@@ -0,0 +1,234 @@
+//computes leave-one-out (jackknife) diagnostics for the fit
+//rather than refitting the data once for each point left out, the contribution
+//of each point is removed from the normal equations of the full fit (built
+//from the moment table, see poly_basis.c), which for a single point is a
+//rank-1 downdate that can be solved directly (Sherman-Morrison formula) from
+//the inverse of the full normal matrix
+//see D. Belsley, E. Kuh, R. Welsch 'Regression Diagnostics' ch. 2
+void jackknife(const parameters * p, const data * d, fit_results * fr)
+{
+  int i,j,k,l;
+  int numFitPar;
+  long double x[POWSIZE];
+  long double basis[MAX_DIM],u[MAX_DIM];
+  long double w,r,f,h,s2,s2i,cookD,dfb,maxDfb;
+  int maxDfbInd;
+
+  //normal equations for the full fit
+  lin_eq_type linEq;
+  buildNormalEq(p,d,&linEq); //see poly_basis.c
+  numFitPar=linEq.dim;
+  long double ndf=d->lines-numFitPar;
+  if(ndf<2)
+    {
+      printf("\nERROR: not enough data points for jackknife diagnostics (need at least %i).\n",numFitPar+2);
+      return;
+    }
+  if(!(solveNormalEq(p,fr,&linEq)==1))//solution and inverse in terms of the monomial terms given by getFitBasis
+    {
+      printf("ERROR: Could not determine fit parameters for jackknife diagnostics.\n");
+      exit(-1);
+    }
+
+  //get chisq of the full fit
+  long double chisq=0.;
+  for(i=0;i<d->lines;i++)
+    {
+      getDataPoint(d,p,i,x);
+      getFitBasis(p,x,basis);
+      f=0.;
+      for(j=0;j<numFitPar;j++)
+        f+=linEq.solution[j]*basis[j];
+      w=1.0L/(d->x[p->numVar+1][i]*d->x[p->numVar+1][i]);
+      if(d->robustWt!=NULL)
+        w*=d->robustWt[i];//weights used in the sums (FIT_ROBUST option)
+      chisq+=w*(d->x[p->numVar][i] - f)*(d->x[p->numVar][i] - f);
+    }
+  s2=chisq/ndf;
+
+  //thresholds above which points are considered influential
+  long double cookThreshold=4.0L/d->lines;
+  long double dfbThreshold=2.0L/sqrtl((long double)d->lines);
+
+  //open the output file, if requested
+  FILE *out=NULL;
+  if(strcmp(p->jackknifeFile,"")!=0)
+    {
+      if((out=fopen(p->jackknifeFile,"w"))==NULL)
+        {
+          printf("ERROR: jackknife output file %s can not be opened.\n",p->jackknifeFile);
+          exit(-1);
+        }
+      fprintf(out,"#");
+      for(j=0;j<p->numVar;j++)
+        fprintf(out," par%i",j+1);
+      fprintf(out," value leverage cooks_d");
+      for(j=0;j<numFitPar;j++)
+        fprintf(out," dfbetas_a%i",j+1);
+      for(j=0;j<numFitPar;j++)
+        fprintf(out," loo_a%i",j+1);
+      fprintf(out,"\n");
+    }
+
+  int numCook=0;
+  int numDfb=0;
+  int numUndefined=0;
+  long double deltaSum[MAX_DIM],deltaSqSum[MAX_DIM],delta[MAX_DIM];
+  memset(deltaSum,0,sizeof(deltaSum));
+  memset(deltaSqSum,0,sizeof(deltaSqSum));
+  int maxInd[NUM_LIST];
+  long double maxCookVal[NUM_LIST],maxCookDfb[NUM_LIST];
+  int maxCookDfbInd[NUM_LIST];
+  for(i=0;i<NUM_LIST;i++)
+    {
+      maxInd[i]=-1;
+      maxCookVal[i]=-1.;
+    }
+
+  for(i=0;i<d->lines;i++)//loop over data points left out
+    {
+      getDataPoint(d,p,i,x);
+      getFitBasis(p,x,basis);
+      w=1.0L/(d->x[p->numVar+1][i]*d->x[p->numVar+1][i]);
+      if(d->robustWt!=NULL)
+        w*=d->robustWt[i];
+      f=0.;
+      for(j=0;j<numFitPar;j++)
+        f+=linEq.solution[j]*basis[j];
+      r=d->x[p->numVar][i] - f;
+
+      //leverage of the point (including its weight)
+      h=0.;
+      for(j=0;j<numFitPar;j++)
+        {
+          u[j]=0.;
+          for(k=0;k<numFitPar;k++)
+            u[j]+=linEq.inv_matrix[j][k]*basis[k];
+          h+=w*basis[j]*u[j];
+        }
+      if((1.0L-h)<=1.0E-12L)
+        {
+          //fit is fully determined by this point, leaving it out is undefined
+          numUndefined++;
+          continue;
+        }
+
+      //change in coefficients when the point is left out
+      for(j=0;j<numFitPar;j++)
+        {
+          delta[j]=u[j]*w*r/(1.0L-h);
+          deltaSum[j]+=delta[j];
+          deltaSqSum[j]+=delta[j]*delta[j];
+        }
+
+      //influence measures
+      cookD=w*r*r*h/(numFitPar*s2*(1.0L-h)*(1.0L-h));
+      s2i=(ndf*s2 - w*r*r/(1.0L-h))/(ndf - 1.0L);
+      maxDfb=0.;
+      maxDfbInd=0;
+      if(s2i>0.)
+        for(j=0;j<numFitPar;j++)
+          {
+            dfb=delta[j]/sqrtl(s2i*linEq.inv_matrix[j][j]);
+            if(fabsl(dfb)>maxDfb)
+              {
+                maxDfb=fabsl(dfb);
+                maxDfbInd=j;
+              }
+          }
+      if(cookD>cookThreshold)
+        numCook++;
+      if(maxDfb>dfbThreshold)
+        numDfb++;
+
+      //record the most influential points
+      for(j=0;j<NUM_LIST;j++)
+        if(cookD>maxCookVal[j])
+          {
+            for(k=NUM_LIST-1;k>j;k--)
+              {
+                maxInd[k]=maxInd[k-1];//shift values down the array
+                maxCookVal[k]=maxCookVal[k-1];
+                maxCookDfb[k]=maxCookDfb[k-1];
+                maxCookDfbInd[k]=maxCookDfbInd[k-1];
+              }
+            maxInd[j]=i;
+            maxCookVal[j]=cookD;
+            maxCookDfb[j]=maxDfb;
+            maxCookDfbInd[j]=maxDfbInd;
+            break;
+          }
+
+      if(out!=NULL)
+        {
+          for(j=0;j<=p->numVar;j++)
+            fprintf(out,"%LE ",d->x[j][i]);
+          fprintf(out,"%LE %LE",h,cookD);
+          for(j=0;j<numFitPar;j++)
+            {
+              if(s2i>0.)
+                fprintf(out," %LE",delta[j]/sqrtl(s2i*linEq.inv_matrix[j][j]));
+              else
+                fprintf(out," %LE",0.0L);
+            }
+          for(j=0;j<numFitPar;j++)
+            fprintf(out," %LE",linEq.solution[j]-delta[j]);
+          fprintf(out,"\n");
+        }
+    }
+
+  if(out!=NULL)
+    fclose(out);
+
+  //jackknife estimate of the coefficient variance
+  int numLOO=d->lines-numUndefined;
+  long double jkErr[MAX_DIM],jkBias[MAX_DIM];
+  memset(jkErr,0,sizeof(jkErr));
+  memset(jkBias,0,sizeof(jkBias));
+  for(j=0;j<numFitPar;j++)
+    {
+      if(numLOO>1)
+        {
+          jkErr[j]=sqrtl(((numLOO-1.0L)/numLOO)*(deltaSqSum[j] - deltaSum[j]*deltaSum[j]/numLOO));
+          jkBias[j]=(numLOO-1.0L)*(-1.0L*deltaSum[j]/numLOO);
+        }
+    }
+
+  //print results
+  if(p->verbose==1)
+    return;
+  else if(p->verbose==2)
+    {
+      //print jackknife coefficient uncertainties
+      for(j=0;j<numFitPar;j++)
+        printf("%LE ",jkErr[j]);
+      printf("\n");
+      return;
+    }
+
+  printf("\nJACKKNIFE DIAGNOSTICS\n---------------------\n");
+  printf("Coefficients with jackknife uncertainties: a1 = %LE +/- %LE (bias %LE)\n",linEq.solution[0],jkErr[0],jkBias[0]);
+  for(j=1;j<numFitPar;j++)
+    printf("                                           a%i = %LE +/- %LE (bias %LE)\n",j+1,linEq.solution[j],jkErr[j],jkBias[j]);
+  printf("\n");
+  if(numUndefined>0)
+    printf("%i data point(s) fully determine the fit and can not be left out.\n",numUndefined);
+  printf("%i data point(s) with Cook's distance > 4/N (%0.3LE).\n",numCook,cookThreshold);
+  printf("%i data point(s) with |DFBETAS| > 2/sqrt(N) (%0.3LE).\n",numDfb,dfbThreshold);
+  if(maxInd[0]>=0)
+    {
+      printf("\nMost influential data point(s):\n");
+      for(i=0;i<NUM_LIST;i++)
+        if(maxInd[i]>=0)
+          {
+            l=maxInd[i];
+            printf("Cook's distance %0.3LE, max |DFBETAS| %0.3LE (a%i), value %0.3LE at [",maxCookVal[i],maxCookDfb[i],maxCookDfbInd[i]+1,d->x[p->numVar][l]);
+            for(j=0;j<p->numVar;j++)
+              printf(" %0.3LE ",d->x[j][l]);
+            printf("]\n");
+          }
+    }
+  if(out!=NULL)
+    printf("\nPer-point jackknife diagnostics written to: %s\n",p->jackknifeFile);
+
+}
@@ -1,4 +1,5 @@
 #include "lin_eq_solver.h"
+#include <float.h>
 
 int solve_lin_eq(lin_eq_type * lin_eq)
 {
@@ -21,6 +22,382 @@ int solve_lin_eq(lin_eq_type * lin_eq)
   return 1;
 }
 
+//maximum number of iterative refinement steps for solve_lin_eq_mixed
+#define MAX_REFINE_ITER 10
+//largest condition number (see get_cond) for which solve_lin_eq_mixed takes
+//the inverse matrix from the double precision factors, keeping at least as
+//many significant digits as are reported for the fit uncertainties
+#define MAX_COND_INV_DOUBLE 1.0E9
+
+//get the LU decomposition (with partial pivoting) of the matrix in double
+//precision, stored in place in lu (unit lower triangle below the diagonal)
+//returns 0 if the matrix is singular
+int get_lu_double(int n, double lu[MAX_DIM][MAX_DIM], int * piv)
+{
+  int i,j,k,p;
+  double s;
+  for(i=0;i<n;i++)
+    {
+      //choose the pivot row
+      p=i;
+      for(j=i+1;j<n;j++)
+        if(fabs(lu[j][i])>fabs(lu[p][i]))
+          p=j;
+      if(lu[p][i]==0.0)
+        return 0;//matrix is singular
+      piv[i]=p;
+      if(p!=i)
+        for(k=0;k<n;k++)
+          {
+            s=lu[i][k];
+            lu[i][k]=lu[p][k];
+            lu[p][k]=s;
+          }
+      for(j=i+1;j<n;j++)
+        {
+          lu[j][i]/=lu[i][i];
+          s=lu[j][i];
+          for(k=i+1;k<n;k++)
+            lu[j][k]-=s*lu[i][k];
+        }
+    }
+  return 1;
+}
+
+//solve the equations using the LU decomposition from get_lu_double
+//b: right hand side, overwritten with the solution
+void solve_lu_double(int n, double lu[MAX_DIM][MAX_DIM], const int * piv, double * b)
+{
+  int i,j;
+  double s;
+  for(i=0;i<n;i++)
+    if(piv[i]!=i)
+      {
+        s=b[i];
+        b[i]=b[piv[i]];
+        b[piv[i]]=s;
+      }
+  for(i=1;i<n;i++)
+    for(j=0;j<i;j++)
+      b[i]-=lu[i][j]*b[j];
+  for(i=n-1;i>=0;i--)
+    {
+      for(j=i+1;j<n;j++)
+        b[i]-=lu[i][j]*b[j];
+      b[i]/=lu[i][i];
+    }
+}
+
+//get the inverse matrix from the LU decomposition from get_lu_double, one
+//column at a time
+void get_inv_lu_double(int n, double lu[MAX_DIM][MAX_DIM], const int * piv, long double inv[MAX_DIM][MAX_DIM])
+{
+  int i,j;
+  double col[MAX_DIM];
+  for(i=0;i<n;i++)
+    {
+      memset(col,0,sizeof(col));
+      col[i]=1.0;
+      solve_lu_double(n,lu,piv,col);
+      for(j=0;j<n;j++)
+        inv[j][i]=col[j];
+    }
+}
+
+//get the residual r = b - A*x of a solution, computed in long double
+//precision against the full precision matrix
+//r: array to store the residual in (may be NULL)
+//returns the relative residual max|r|/max(|A||x| + |b|)
+long double get_residual(const lin_eq_type * lin_eq, const long double * x, double * r)
+{
+  int i,j;
+  int n=lin_eq->dim;
+  long double ri,s,rMax,scale;
+  rMax=0.0L;
+  scale=0.0L;
+  for(i=0;i<n;i++)
+    {
+      ri=lin_eq->vector[i];
+      s=fabsl(lin_eq->vector[i]);
+      for(j=0;j<n;j++)
+        {
+          ri-=lin_eq->matrix[i][j]*x[j];
+          s+=fabsl(lin_eq->matrix[i][j]*x[j]);
+        }
+      if(r!=NULL)
+        r[i]=(double)ri;
+      if(fabsl(ri)>rMax)
+        rMax=fabsl(ri);
+      if(s>scale)
+        scale=s;
+    }
+  if(scale>0.0L)
+    rMax/=scale;
+  return rMax;
+}
+
+//as above, computed in 128-bit precision (used when escalating to full
+//precision, where the long double residual is no longer accurate enough)
+long double get_residual_quad(const lin_eq_type * lin_eq, const long double * x, long double * r)
+{
+  int i,j;
+  int n=lin_eq->dim;
+  __float128 ri;
+  long double s,rMax,scale;
+  rMax=0.0L;
+  scale=0.0L;
+  for(i=0;i<n;i++)
+    {
+      ri=lin_eq->vector[i];
+      s=fabsl(lin_eq->vector[i]);
+      for(j=0;j<n;j++)
+        {
+          ri-=(__float128)lin_eq->matrix[i][j]*x[j];
+          s+=fabsl(lin_eq->matrix[i][j]*x[j]);
+        }
+      if(r!=NULL)
+        r[i]=(long double)ri;
+      if(fabsl((long double)ri)>rMax)
+        rMax=fabsl((long double)ri);
+      if(s>scale)
+        scale=s;
+    }
+  if(scale>0.0L)
+    rMax/=scale;
+  return rMax;
+}
+
+//checks the size of a correction to the solution during iterative
+//refinement, against the size of the previous correction
+//returns 1 if converged (or the corrections have stopped shrinking after
+//having converged as far as the residual precision allows), -1 if the
+//corrections are not shrinking at all, and 0 to keep refining
+int check_refine(long double corrMax, long double xMax, long double * prevCorrMax, int iter)
+{
+  if(corrMax<=LDBL_EPSILON*xMax)
+    return 1;
+  if((iter>0)&&(corrMax>0.5L*(*prevCorrMax)))
+    return (iter>1) ? 1 : -1;
+  *prevCorrMax=corrMax;
+  return 0;
+}
+
+//solve the equations A*x=b from the double precision LU decomposition, then
+//iteratively refine the solution using residuals computed in long double
+//precision against the full precision matrix
+//returns the relative residual of the solution, or -1 if the refinement
+//did not converge
+long double refine_lin_eq(lin_eq_type * lin_eq, double lu[MAX_DIM][MAX_DIM], const int * piv)
+{
+  int i,k,conv;
+  int n=lin_eq->dim;
+  double corr[MAX_DIM];
+  long double res,xMax,corrMax,prevCorrMax=0.0L;
+
+  for(i=0;i<n;i++)
+    corr[i]=(double)lin_eq->vector[i];
+  solve_lu_double(n,lu,piv,corr);
+  for(i=0;i<n;i++)
+    lin_eq->solution[i]=corr[i];
+
+  for(k=0;k<MAX_REFINE_ITER;k++)
+    {
+      res=get_residual(lin_eq,lin_eq->solution,corr);
+      if(res<=LDBL_EPSILON)
+        return res;//residual is as small as long double precision allows
+
+      //correct the solution
+      solve_lu_double(n,lu,piv,corr);
+      xMax=0.0L;
+      corrMax=0.0L;
+      for(i=0;i<n;i++)
+        {
+          lin_eq->solution[i]+=corr[i];
+          if(fabsl(lin_eq->solution[i])>xMax)
+            xMax=fabsl(lin_eq->solution[i]);
+          if(fabs(corr[i])>corrMax)
+            corrMax=fabs(corr[i]);
+        }
+      lin_eq->refine_iter++;
+      conv=check_refine(corrMax,xMax,&prevCorrMax,k);
+      if(conv==1)
+        return get_residual(lin_eq,lin_eq->solution,NULL);
+      if(conv==-1)
+        return -1.0L;//corrections are not decreasing, matrix is too badly conditioned
+    }
+  return -1.0L;
+}
+
+//refine the solution from the full precision solve, using residuals
+//computed in 128-bit precision and corrections from the full precision
+//inverse matrix
+//returns the relative residual of the solution
+long double refine_lin_eq_quad(lin_eq_type * lin_eq)
+{
+  int i,j,k;
+  int n=lin_eq->dim;
+  long double r[MAX_DIM],corr,xMax,corrMax,res,prevCorrMax=0.0L;
+
+  for(k=0;k<MAX_REFINE_ITER;k++)
+    {
+      res=get_residual_quad(lin_eq,lin_eq->solution,r);
+      if(res==0.0L)
+        return res;
+      xMax=0.0L;
+      corrMax=0.0L;
+      for(i=0;i<n;i++)
+        {
+          corr=0.0L;
+          for(j=0;j<n;j++)
+            corr+=lin_eq->inv_matrix[i][j]*r[j];
+          lin_eq->solution[i]+=corr;
+          if(fabsl(lin_eq->solution[i])>xMax)
+            xMax=fabsl(lin_eq->solution[i]);
+          if(fabsl(corr)>corrMax)
+            corrMax=fabsl(corr);
+        }
+      if(check_refine(corrMax,xMax,&prevCorrMax,k)!=0)
+        break;
+    }
+  return get_residual_quad(lin_eq,lin_eq->solution,NULL);
+}
+
+//solve the equations in mixed precision, by factoring the matrix in double
+//precision and iteratively refining the solution (see N. Higham 'Accuracy
+//and Stability of Numerical Algorithms' ch. 12), which is much faster than
+//long double Gauss-Jordan elimination
+//the inverse matrix is taken from the double precision factors unless the
+//matrix is badly conditioned, in which case it is found in full precision
+//falls back to solve_lin_eq (refined using 128-bit residuals) if the matrix
+//is too badly conditioned for the refinement to converge
+//returns 1 if successful, 0 if the matrix is singular
+int solve_lin_eq_mixed(lin_eq_type * lin_eq)
+{
+
+  int i,j;
+  int n=lin_eq->dim;//dimension of the matrix (assume square)
+  double lu[MAX_DIM][MAX_DIM];
+  int piv[MAX_DIM];
+  long double cond;
+
+  lin_eq->refine_iter=0;
+  for(i=0;i<n;i++)
+    for(j=0;j<n;j++)
+      lu[i][j]=(double)lin_eq->matrix[i][j];
+
+  if(get_lu_double(n,lu,piv)==1)
+    {
+      lin_eq->residual=refine_lin_eq(lin_eq,lu,piv);
+      if(lin_eq->residual>=0.0L)
+        {
+          get_inv_lu_double(n,lu,piv,lin_eq->inv_matrix);
+          cond=get_cond(lin_eq);
+          if((cond<0.0L)||(cond>MAX_COND_INV_DOUBLE))
+            get_inv(lin_eq);
+          return 1;
+        }
+    }
+
+  //fall back to full precision
+  if(solve_lin_eq(lin_eq)==0)
+    return 0;
+  lin_eq->residual=refine_lin_eq_quad(lin_eq);
+  lin_eq->refine_iter=-1;//indicates full precision was used
+  return 1;
+}
+
+//get the condition number (1-norm) of the matrix, after scaling it
+//symmetrically by its diagonal so that the estimate reflects the effect of
+//relative errors in the matrix elements (eg. rounding errors in sums)
+//uses the matrix and inverse matrix, so must be called after solving
+//returns the condition number, or -1 if the diagonal is not positive
+long double get_cond(lin_eq_type * lin_eq)
+{
+
+  int i,j;
+  int n=lin_eq->dim;//dimension of the matrix (assume square)
+  long double scale[MAX_DIM];
+  long double norm,invNorm,colSum,invColSum;
+
+  for(i=0;i<n;i++)
+    {
+      if(lin_eq->matrix[i][i]<=0.0L)
+        return -1.0L;
+      scale[i]=1.0L/sqrtl(lin_eq->matrix[i][i]);
+    }
+
+  //the inverse of the scaled matrix D*A*D is the scaled inverse D^-1*A^-1*D^-1
+  norm=0.0L;
+  invNorm=0.0L;
+  for(j=0;j<n;j++)
+    {
+      colSum=0.0L;
+      invColSum=0.0L;
+      for(i=0;i<n;i++)
+        {
+          colSum+=fabsl(lin_eq->matrix[i][j]*scale[i]*scale[j]);
+          invColSum+=fabsl(lin_eq->inv_matrix[i][j]/(scale[i]*scale[j]));
+        }
+      if(colSum>norm)
+        norm=colSum;
+      if(invColSum>invNorm)
+        invNorm=invColSum;
+    }
+
+  return norm*invNorm;
+}
+
+//get the condition number (as in get_cond) without solving the equations,
+//from the double precision LU decomposition of the scaled matrix
+//returns the condition number, or -1 if the diagonal is not positive or the
+//matrix is singular
+long double get_cond_lu(const lin_eq_type * lin_eq)
+{
+
+  int i,j;
+  int n=lin_eq->dim;//dimension of the matrix (assume square)
+  double lu[MAX_DIM][MAX_DIM];
+  int piv[MAX_DIM];
+  double scale[MAX_DIM],col[MAX_DIM];
+  double norm,invNorm,colSum;
+
+  for(i=0;i<n;i++)
+    {
+      if(lin_eq->matrix[i][i]<=0.0L)
+        return -1.0L;
+      scale[i]=1.0/sqrt((double)lin_eq->matrix[i][i]);
+    }
+  norm=0.0;
+  for(j=0;j<n;j++)
+    {
+      colSum=0.0;
+      for(i=0;i<n;i++)
+        {
+          lu[i][j]=(double)lin_eq->matrix[i][j]*scale[i]*scale[j];
+          colSum+=fabs(lu[i][j]);
+        }
+      if(colSum>norm)
+        norm=colSum;
+    }
+
+  if(get_lu_double(n,lu,piv)==0)
+    return -1.0L;
+  invNorm=0.0;
+  for(j=0;j<n;j++)
+    {
+      memset(col,0,sizeof(col));
+      col[j]=1.0;
+      solve_lu_double(n,lu,piv,col);
+      colSum=0.0;
+      for(i=0;i<n;i++)
+        colSum+=fabs(col[i]);
+      if(colSum>invNorm)
+        invNorm=colSum;
+    }
+
+  return (long double)norm*invNorm;
+}
+
 //get the inverse matrix using Gauss-Jordan elimination
 int get_inv(lin_eq_type * lin_eq)
 {
@@ -94,3 +471,80 @@ int get_inv(lin_eq_type * lin_eq)
   return 1;
 
 }
+
+//get the eigenvalues and eigenvectors of a symmetric matrix using the cyclic 
+//Jacobi method (see W. Press et al. 'Numerical Recipes' sec 11.1)
+//only the matrix and dimension of lin_eq are used
+//eig_vec: eigenvectors are stored in the columns, in the same order as eig_val
+//returns 1 if successful, 0 if the method did not converge
+int get_sym_eigen(lin_eq_type * lin_eq, long double * eig_val, long double eig_vec[MAX_DIM][MAX_DIM])
+{
+
+  int i,k,p,q,sweep;//iterators
+  int n=lin_eq->dim;//dimension of the matrix (assume square)
+  long double a[MAX_DIM][MAX_DIM];
+  long double off,norm,theta,t,c,s,akp,akq;
+
+  memcpy(a,lin_eq->matrix,sizeof(a));
+  memset(eig_vec,0,MAX_DIM*sizeof(eig_vec[0]));
+  for(i=0;i<n;i++)
+    eig_vec[i][i]=1.0L;
+
+  for(sweep=0;sweep<100;sweep++)
+    {
+      //check convergence (size of off-diagonal elements)
+      off=0.0L;
+      norm=0.0L;
+      for(p=0;p<n;p++)
+        for(q=0;q<n;q++)
+          {
+            norm+=a[p][q]*a[p][q];
+            if(p!=q)
+              off+=a[p][q]*a[p][q];
+          }
+      if(off<=1.0E-36L*norm)
+        {
+          for(i=0;i<n;i++)
+            eig_val[i]=a[i][i];
+          return 1;
+        }
+
+      //rotate to zero each off-diagonal element in turn
+      for(p=0;p<n-1;p++)
+        for(q=p+1;q<n;q++)
+          {
+            if(a[p][q]==0.0L)
+              continue;
+            theta=(a[q][q]-a[p][p])/(2.0L*a[p][q]);
+            t=1.0L/(fabsl(theta) + sqrtl(theta*theta + 1.0L));
+            if(theta<0.0L)
+              t*=-1.0L;
+            c=1.0L/sqrtl(t*t + 1.0L);
+            s=t*c;
+            for(k=0;k<n;k++)
+              {
+                akp=a[k][p];
+                akq=a[k][q];
+                a[k][p]=c*akp - s*akq;
+                a[k][q]=s*akp + c*akq;
+              }
+            for(k=0;k<n;k++)
+              {
+                akp=a[p][k];
+                akq=a[q][k];
+                a[p][k]=c*akp - s*akq;
+                a[q][k]=s*akp + c*akq;
+              }
+            for(k=0;k<n;k++)
+              {
+                akp=eig_vec[k][p];
+                akq=eig_vec[k][q];
+                eig_vec[k][p]=c*akp - s*akq;
+                eig_vec[k][q]=s*akp + c*akq;
+              }
+          }
+    }
+
+  return 0;
+
+}
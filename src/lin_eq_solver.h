@@ -4,8 +4,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 
-#define MAX_DIM 20
+#define MAX_DIM 32
 
 typedef struct
 {
@@ -16,10 +17,16 @@ typedef struct
   //properties determined by the solver
   long double inv_matrix[MAX_DIM][MAX_DIM];//inverse of matrix specified above
   long double solution[MAX_DIM];
+  long double residual;//relative residual of the solution, max|b - Ax|/max(|A||x| + |b|) (set by solve_lin_eq_mixed)
+  int refine_iter;//number of iterative refinement steps used (set by solve_lin_eq_mixed)
 }lin_eq_type;
 
 int solve_lin_eq(lin_eq_type *lin_eq);
+int solve_lin_eq_mixed(lin_eq_type *lin_eq);
+long double get_cond(lin_eq_type *lin_eq);
+long double get_cond_lu(const lin_eq_type *lin_eq);
 long double det(int m, lin_eq_type *lin_eq);
 int get_inv(lin_eq_type *lin_eq);
+int get_sym_eigen(lin_eq_type *lin_eq, long double * eig_val, long double eig_vec[MAX_DIM][MAX_DIM]);
 
 #endif
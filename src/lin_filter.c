@@ -1,64 +1,69 @@
+//adds a data point to the running mean and variance of x/y used by the
+//linear filter (Welford's algorithm), so that the statistics can be
+//accumulated in a single pass, or while the data is being read in
+void addPointToLinearFilterStats(data * d, int i)
+{
+  long double ratio,delta;
+  if(d->x[1][i]!=0.)
+    {
+      ratio=d->x[0][i]/d->x[1][i];
+      d->filterNum++;
+      delta=ratio - d->filterMean;
+      d->filterMean+=delta/d->filterNum;
+      d->filterM2+=delta*(ratio - d->filterMean);
+    }
+}
+
 //filters data assuming it is linearly distributed, by removing data points
 //where x/y differs by a value greater than sigma standard deviations
 //away from the mean value
+//if the statistics of x/y were not already accumulated when reading the
+//data, they are computed here in a single pass
+//the remaining data (including weights) is compacted in place, and its range
+//recomputed
 void linearFilter(data * d, parameters * p)
 {
-  int i;
+  int i,j,k;
   double avg,stdev;
-  
+
   if(p->numVar>1)
     {
       printf("ERROR: Cannot apply linear filter to data with more than one variable.\n");
       exit(-1);
     }
-  
-  //get the average difference between x and y
-  avg=0.;
-  for(i=0;i<d->lines;i++)
-    {
-      if(d->x[1][i]!=0.)
-        avg+=(d->x[0][i]/d->x[1][i]);
-    }
-  avg/=1.*d->lines;
-  
-  //get the standard deviation of the difference between x and y
+
+  //get the average and standard deviation of x/y
+  if(d->filterNum==0)
+    for(i=0;i<d->lines;i++)
+      addPointToLinearFilterStats(d,i);
+  avg=(double)d->filterMean;
   stdev=0.;
-  for(i=0;i<d->lines;i++)
-    {
-      if(d->x[1][i]!=0.)
-        stdev+=((d->x[0][i]/d->x[1][i]) - avg)*((d->x[0][i]/d->x[1][i]) - avg);
-    }
-  stdev/=(1.0*d->lines - 1.0);
-  stdev=sqrt(stdev);
-  
+  if(d->filterNum>1)
+    stdev=sqrt((double)(d->filterM2/(d->filterNum - 1)));
+
   if(p->verbose<1)
     {
       printf("Applying linear filter to data.\n");
       printf("Average: %.3E, Standard Deviation: %.3E, Filter Sigma: %.3E.\n",avg,stdev,p->filterSigma);
     }
-  
-  //allocate temp data structure
-  data *temp=(data*)calloc(1,sizeof(data));
-  memcpy(temp,d,sizeof(data));
-  
+
   //filter data
-  temp->lines=0;
+  j=0;
   for(i=0;i<d->lines;i++)
     if(d->x[1][i]!=0.)
       if((d->x[0][i]/d->x[1][i]) < (avg+(p->filterSigma*stdev)))
         if((d->x[0][i]/d->x[1][i]) > (avg-(p->filterSigma*stdev)))
           {
-  	        temp->x[0][temp->lines]=d->x[0][i];
-  	        temp->x[1][temp->lines]=d->x[1][i];
-  	        temp->lines++;
-  	      }
-  	      
+            if(j!=i)
+              for(k=0;k<=p->numVar+1;k++)
+                d->x[k][j]=d->x[k][i];
+            j++;
+          }
+
   if(p->verbose<1)
-    printf("%i data points filtered out.\n",d->lines-temp->lines);
-  
-  //copy back temp data
-  memcpy(d,temp,sizeof(data));
-  //clean up
-  free(temp);
-  
+    printf("%i data points filtered out.\n",d->lines-j);
+
+  d->lines=j;
+  getDataRange(d,p); //see import_data.c
+
 }
@@ -1,6 +1,6 @@
 //forward declarations
+void evalFitAtData(const parameters *, const data *, const fit_results *, long double *);
 void generateSums(data *,const parameters *);
-void refitFilterLin(const parameters *, const data *, fit_results *, plot_data *, long double);
 
 //evaluates the fit function at the specified point
 long double evalLin(long double x, const fit_results * fr)
@@ -14,52 +14,58 @@ long double evalLinX(long double y, const fit_results * fr)
   return (y - fr->a[1])/fr->a[0];
 }
 
-long double confIntVal(long double x, const fit_results * fr, const data * d, int upper)
+//evaluates the upper or lower confidence band of the fit at the specified x value
+//the band is the envelope of lines with (slope, intercept) on the 1-sigma
+//error ellipse in 2 parameters (delta chisq = 2.30), which is given in closed
+//form by f(x) +/- sqrt(2.30*var(f(x))), with var(f(x)) from the covariance matrix
+//Ref: A. Chester master thesis
+long double confIntVal(long double x, const fit_results * fr, int upper)
 {
-	int i;	
-	long double cVal;
-	long double maxCVal=-1.*BIG_NUMBER;
-	long double minCVal=BIG_NUMBER;
-	
-	for (i=0;i<fr->ciEEValues;i++)
-		{
-			cVal=fr->ciEEVal[0][i]*x + fr->ciEEVal[1][i];
-			//printf("i: %i, cVal: %LE\n",i,cVal);
-			//printf("ciEEVals[%i]: %LE %LE\n",i,fr->ciEEVal[0][i],fr->ciEEVal[1][i]);
-			if(cVal>maxCVal)
-				maxCVal=cVal;
-			if(cVal<minCVal)
-				minCVal=cVal;
-		}
+	long double hw=sqrtl(2.30*(fr->covar[0][0]*x*x + 2.*fr->covar[0][1]*x + fr->covar[1][1]));
 	if(upper==1)
-		return maxCVal;
+		return evalLin(x,fr) + hw;
 	else
-		return minCVal;
-
+		return evalLin(x,fr) - hw;
 }
 
-long double confIntValX(long double y, const fit_results * fr, const data * d, int upper)
+//evaluates the upper or lower x value at which the confidence band of the fit
+//reaches the specified y value (the range of x values of lines on the error
+//ellipse at y), found by solving (f(x) - y)^2 = 2.30*var(f(x)) for x
+//returns +/- BIG_NUMBER if the band does not close (slope not significant)
+long double confIntValX(long double y, const fit_results * fr, int upper)
 {
-	int i;	
-	long double cVal;
-	long double maxCVal=-1.*BIG_NUMBER;
-	long double minCVal=BIG_NUMBER;
-	
-	for (i=0;i<fr->ciEEValues;i++)
+	long double qa=fr->a[0]*fr->a[0] - 2.30*fr->covar[0][0];
+	long double qb=2.*(fr->a[0]*(fr->a[1]-y) - 2.30*fr->covar[0][1]);
+	long double qc=(fr->a[1]-y)*(fr->a[1]-y) - 2.30*fr->covar[1][1];
+	long double discr=qb*qb - 4.*qa*qc;
+	if((qa<=0.)||(discr<0.))
 		{
-			cVal=(y - fr->ciEEVal[1][i])/fr->ciEEVal[0][i];
-			//printf("i: %i, cVal: %LE\n",i,cVal);
-			//printf("ciEEVals[%i]: %LE %LE\n",i,fr->ciEEVal[0][i],fr->ciEEVal[1][i]);
-			if(cVal>maxCVal)
-				maxCVal=cVal;
-			if(cVal<minCVal)
-				minCVal=cVal;
+			if(upper==1)
+				return BIG_NUMBER;
+			else
+				return -1.*BIG_NUMBER;
 		}
 	if(upper==1)
-		return maxCVal;
+		return (-1.*qb + sqrtl(discr))/(2.*qa);
 	else
-		return minCVal;
+		return (-1.*qb - sqrtl(discr))/(2.*qa);
+}
 
+//evaluates the lower and upper confidence band of the fit at n x values
+void confIntValBatch(const fit_results * fr, const double * x, double * lower, double * upper, int n)
+{
+	int i;
+	long double c00=2.30*fr->covar[0][0];
+	long double c01=2.*2.30*fr->covar[0][1];
+	long double c11=2.30*fr->covar[1][1];
+	long double f,hw;
+	for(i=0;i<n;i++)
+		{
+			f=fr->a[0]*x[i] + fr->a[1];
+			hw=sqrtl(c00*x[i]*x[i] + c01*x[i] + c11);
+			lower[i]=(double)(f - hw);
+			upper[i]=(double)(f + hw);
+		}
 }
 
 //prints the results
@@ -92,10 +98,10 @@ void printLin(const data * d, const parameters * p, const fit_results * fr)
   
 	printf("Confidence interval values below reported at 1-sigma (68.3%%).\n");
   printf("x-intercept = %LE\n",fr->fitVert[0]);
-  if ((float)(fr->fitVert[1]-confIntVal(0.0,fr,d,0))==(float)(confIntVal(0.0,fr,d,1)-fr->fitVert[1]))
-    printf("y-intercept = %LE +/- %LE (from confidence interval)\n",fr->fitVert[1],fr->fitVert[1]-confIntVal(0.0,fr,d,0));
+  if ((float)(fr->fitVert[1]-confIntVal(0.0,fr,0))==(float)(confIntVal(0.0,fr,1)-fr->fitVert[1]))
+    printf("y-intercept = %LE +/- %LE (from confidence interval)\n",fr->fitVert[1],fr->fitVert[1]-confIntVal(0.0,fr,0));
   else
-    printf("y-intercept = %LE + %LE - %LE  (from confidence interval)\n",fr->fitVert[1],fr->fitVert[1]-confIntVal(0.0,fr,d,0),confIntVal(0.0,fr,d,1)-fr->fitVert[1]);
+    printf("y-intercept = %LE + %LE - %LE  (from confidence interval)\n",fr->fitVert[1],fr->fitVert[1]-confIntVal(0.0,fr,0),confIntVal(0.0,fr,1)-fr->fitVert[1]);
   
 	if(p->numCIEvalPts>0)
 		{
@@ -106,24 +112,19 @@ void printLin(const data * d, const parameters * p, const fit_results * fr)
 					x=p->CIEvalPts[i];
 					fx=evalLin(p->CIEvalPts[i],fr);
 					printf("\n");
-					if ((float)(fx-confIntVal(x,fr,d,0))==(float)(confIntVal(x,fr,d,1)-fx))
+					if ((float)(fx-confIntVal(x,fr,0))==(float)(confIntVal(x,fr,1)-fx))
 						{
-							printf("Confidence interval at x = %LE: y = %LE +/- %LE\n",x,fx,fx-confIntVal(x,fr,d,0));
-							printf("Confidence interval at y = %LE: x = %LE +/- %LE\n",fx,x,x-confIntValX(fx,fr,d,0));
+							printf("Confidence interval at x = %LE: y = %LE +/- %LE\n",x,fx,fx-confIntVal(x,fr,0));
+							printf("Confidence interval at y = %LE: x = %LE +/- %LE\n",fx,x,x-confIntValX(fx,fr,0));
 						}	
 					else
 						{
-							printf("Confidence interval at x = %LE: y = %LE + %LE - %LE\n",x,fx,fx-confIntVal(x,fr,d,0),confIntVal(x,fr,d,1)-fx);
-							printf("Confidence interval at y = %LE: x = %LE + %LE - %LE\n",fx,x,x-confIntValX(fx,fr,d,0),confIntValX(fx,fr,d,1)-x);
+							printf("Confidence interval at x = %LE: y = %LE + %LE - %LE\n",x,fx,fx-confIntVal(x,fr,0),confIntVal(x,fr,1)-fx);
+							printf("Confidence interval at y = %LE: x = %LE + %LE - %LE\n",fx,x,x-confIntValX(fx,fr,0),confIntValX(fx,fr,1)-x);
 						}
 						
 				}
 		}
-  /*//draw confidence interval ellipse
-  handle=gnuplot_init();
-  gnuplot_plot_xy(handle, fr->ciEEVal[0], fr->ciEEVal[1], fr->ciEEValues, "Data");
-  getc(stdin);*/
-
   if((p->forceZeroX)&&(strcmp(p->dataType,"chisq")==0))
     {
       printf("\n");
@@ -148,13 +149,15 @@ void printLin(const data * d, const parameters * p, const fit_results * fr)
 	
 	if((p->findMinGridPoint == 1)||(p->findMaxGridPoint == 1)){
     printf("\n");
+    long double *fitVal=(long double*)malloc(d->lines*sizeof(long double));
+    evalFitAtData(p,d,fr,fitVal); //see fit_eval_batch.c
 		int i;
     if(p->findMinGridPoint == 1){
       long double currentVal;
       long double minVal = BIG_NUMBER;
       int minPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = evalLin(d->x[0][i],fr);
+        currentVal = fitVal[i];
         if(currentVal < minVal){
           minVal = currentVal;
           minPt = i;
@@ -169,7 +172,7 @@ void printLin(const data * d, const parameters * p, const fit_results * fr)
       long double maxVal = -1.0*BIG_NUMBER;
       int maxPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = evalLin(d->x[0][i],fr);
+        currentVal = fitVal[i];
         if(currentVal > maxVal){
           maxVal = currentVal;
           maxPt = i;
@@ -179,6 +182,7 @@ void printLin(const data * d, const parameters * p, const fit_results * fr)
         printf("Grid point corresponding to the highest value (%LE) of the fitted function is at [ %0.3LE ].\n",maxVal,d->x[0][maxPt]);
       }
     }
+    free(fitVal);
   }
     
 }
@@ -196,7 +200,7 @@ void fitLin(const parameters * p, const data * d, fit_results * fr, plot_data *
 {
 
 	int numFitPar = 2;
-  fr->ndf=d->lines-numFitPar;
+  fr->ndf=getNumFitLines(d)-numFitPar; //see generate_sums.c
   if(fr->ndf < 0)
     {
       printf("\nERROR: not enough data points for a fit (NDF < 0) using the %s function.\n",p->fitType);
@@ -212,21 +216,13 @@ void fitLin(const parameters * p, const data * d, fit_results * fr, plot_data *
         }
     }
 
-  //construct equations
+  //construct equations from the moment table (see poly_basis.c)
   int i,j;
   lin_eq_type linEq;
-  linEq.dim=2;
-  
-  linEq.matrix[0][0]=d->xpowsum[0][2];
-  linEq.matrix[0][1]=d->xpowsum[0][1]; 
-  linEq.matrix[1][0]=d->xpowsum[0][1]; 
-  linEq.matrix[1][1]=d->xpowsum[0][0];//bottom right entry
-  
-  linEq.vector[0]=d->mxpowsum[0][1];
-  linEq.vector[1]=d->mxpowsum[0][0];
+  buildNormalEq(p,d,&linEq);
     
 	//solve system of equations and assign values
-	if(!(solve_lin_eq(&linEq)==1))
+	if(!(solveNormalEq(p,fr,&linEq)==1))
 		{
 			printf("ERROR: Could not determine fit parameters (lin).\n");
 			printf("Perhaps there are not enough data points to perform a fit?\n");
@@ -237,20 +233,9 @@ void fitLin(const parameters * p, const data * d, fit_results * fr, plot_data *
   //save fit parameters  
   for(i=0;i<linEq.dim;i++)
     fr->a[i]=linEq.solution[i];
-  //refit filter  
-  if(p->refitFilter==1)
-    {
-      refitFilterLin(p,d,fr,pd,p->refitFilterDist);
-      return;
-    }
-  long double f;
-  fr->chisq=0;
-  for(i=0;i<d->lines;i++)//loop over data points for chisq
-    {
-      f=fr->a[0]*d->x[0][i] + fr->a[1];
-      fr->chisq+=(d->x[1][i] - f)*(d->x[1][i] - f)
-                  /(d->x[1+1][i]*d->x[1+1][i]);
-    }
+  residual_stats_type rs;
+  getResiduals(p,d,fr,&rs,NULL); //see residuals.c
+  fr->chisq=rs.chisq;
   
   //Calculate covariances and uncertainties, see J. Wolberg 
   //'Data Analysis Using the Method of Least Squares' sec 2.5
@@ -265,89 +250,14 @@ void fitLin(const parameters * p, const data * d, fit_results * fr, plot_data *
   fr->fitVert[1]=fr->a[1];//y-intercept
   
   
-	//generate slope/intercept pairs for confidence interval
-	//Ref: A. Chester master thesis
-  int gridSize=(int)(CI_EE_DIM/2.);
-	long double c=2.30*fr->chisq/fr->ndf;//confidence level for 1-sigma in 2 parameters
-	long double da0=sqrt((d->xpowsum[0][0]*c)/(d->xpowsum[0][0]*d->xpowsum[0][2] - d->xpowsum[0][1]*d->xpowsum[0][1]));
-	//printf("sum: %LF\n",d->xpowsum[0][0]*d->xpowsum[0][2] - d->xpowsum[0][1]*d->xpowsum[0][1]);
-	long double p0,p1,p2,a0b,a1b1,a1b2;
-  p0=d->xpowsum[0][0];
-  fr->ciEEValues=0;
-	for (i=0;i<gridSize;i++)
-		{
-			a0b=fr->a[0]+((2.0*i - gridSize)/(double)gridSize)*da0;
-			//printf("a0b: %Lf\n",a0b);
-			p1=(2.*d->xpowsum[0][1]*(a0b - fr->a[0])) - 2.*d->xpowsum[0][0]*fr->a[1];
-			p2=d->xpowsum[0][0]*fr->a[1]*fr->a[1] - 2.*d->xpowsum[0][1]*fr->a[1]*(a0b - fr->a[0]) + d->xpowsum[0][2]*(a0b - fr->a[0])*(a0b - fr->a[0]) - c;
-			//printf("p1*p1 - 4.*p0*p2: %Lf\n",p1*p1 - 4.*p0*p2);
-			a1b1=(-1.*p1 + sqrt(p1*p1 - 4.*p0*p2))/(2.*p0);
-			a1b2=(-1.*p1 - sqrt(p1*p1 - 4.*p0*p2))/(2.*p0);
-			//printf("i: %i, a0b: %LF, a1b1: %Lf, a1b2: %Lf\n",i,a0b,a1b1,a1b2);
-			//record pairs of slope/intercept values on error ellipse
-			fr->ciEEVal[0][fr->ciEEValues]=a0b;
-			fr->ciEEVal[1][fr->ciEEValues]=a1b1;
-			fr->ciEEValues++;
-			fr->ciEEVal[0][fr->ciEEValues]=a0b;
-			fr->ciEEVal[1][fr->ciEEValues]=a1b2;
-			fr->ciEEValues++;
-		}
-	
 	//construct the confidence interval
 	for(i=0;i<CI_DIM;i++)
-		{
-			fr->ciXVal[0][i]=d->min_x[0] - (d->max_x[0]-d->min_x[0]) + (d->max_x[0]-d->min_x[0])*((3.0*i)/(CI_DIM-1.0));
-			fr->ciUVal[0][i]=confIntVal(fr->ciXVal[0][i],fr,d,1);
-			fr->ciLVal[0][i]=confIntVal(fr->ciXVal[0][i],fr,d,0);
-			//printf("point %i, upper val: %lf, lower val: %lf\n",i,fr->ciUVal[0][i],fr->ciLVal[0][i]);
-		}
+		fr->ciXVal[0][i]=d->min_x[0] - (d->max_x[0]-d->min_x[0]) + (d->max_x[0]-d->min_x[0])*((3.0*i)/(CI_DIM-1.0));
+	confIntValBatch(fr,fr->ciXVal[0],fr->ciLVal[0],fr->ciUVal[0],CI_DIM);
 	
 	//print results
   if(print==1)
 		printLin(d,p,fr);
 	
-	if((p->plotData==1)&&(p->verbose<1))
-		{
-			preparePlotData(d,p,fr,pd);
-			plotFormLin(p,fr);
-			plotData(p,fr,pd);
-		}
   
 }
-
-//generate a new data set and refit
-void refitFilterLin(const parameters * p, const data * d, fit_results * fr, plot_data * pd, long double distance){
-  int i,j;
-
-  //generate a new data set containing only filtered data
-  data *nd=(data*)calloc(1,sizeof(data));
-  parameters *np=(parameters*)calloc(1,sizeof(parameters));
-  memcpy(np,p,sizeof(parameters));
-  np->refitFilter=0;
-  nd->lines=0;
-
-  for (i=0;i<d->lines;i++){
-    long double diff = fabs(d->x[p->numVar][i] - evalLin(d->x[0][i],fr));
-    if(diff<=distance){
-      //keep this data point (remember to copy weight as well)
-      for(j=0;j<=p->numVar+1;j++)
-        nd->x[j][nd->lines] = d->x[j][i];
-      nd->lines++;
-    }
-  }
-
-  nd->max_m=d->max_m;
-  nd->min_m=d->min_m;
-  for(i=0;i<p->numVar;i++)
-    nd->max_x[i]=d->max_x[i];
-
-  if(p->verbose<1)
-    printf("\nRefit filter: %i of %i data point(s) retained.\n",nd->lines,d->lines);
-  //printDataInfo(nd,np); //see print_data_info.c
-
-  generateSums(nd,np); //construct sums for fitting (see generate_sums.c)
-  fitLin(np,nd,fr,pd,1);
-
-  free(nd);
-  free(np);
-}
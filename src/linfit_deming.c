@@ -1,6 +1,3 @@
-//forward declarations
-void refitFilterLin(const parameters *, const data *, fit_results *, plot_data *, long double);
-
 //prints the results
 void printLinDeming(const data * d, const parameters * p, const fit_results * fr)
 {
@@ -33,17 +30,19 @@ void printLinDeming(const data * d, const parameters * p, const fit_results * fr
   printf("y-intercept = %LE\n",fr->fitVert[1]);
   
   //printf("value at x=90 = %LE\n",fr->a[0]*90. + fr->a[1]);
-  //printf("CI at x=90 = [%LE %LE]\n",confIntVal(90.,fr,d,1),confIntVal(90.,fr,d,0));
+  //printf("CI at x=90 = [%LE %LE]\n",confIntVal(90.,fr,1),confIntVal(90.,fr,0));
 
   if((p->findMinGridPoint == 1)||(p->findMaxGridPoint == 1)){
     printf("\n");
+    long double *fitVal=(long double*)malloc(d->lines*sizeof(long double));
+    evalFitAtData(p,d,fr,fitVal); //see fit_eval_batch.c
 		int i;
     if(p->findMinGridPoint == 1){
       long double currentVal;
       long double minVal = BIG_NUMBER;
       int minPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = evalLin(d->x[0][i],fr);
+        currentVal = fitVal[i];
         if(currentVal < minVal){
           minVal = currentVal;
           minPt = i;
@@ -58,7 +57,7 @@ void printLinDeming(const data * d, const parameters * p, const fit_results * fr
       long double maxVal = -1.0*BIG_NUMBER;
       int maxPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = evalLin(d->x[0][i],fr);
+        currentVal = fitVal[i];
         if(currentVal > maxVal){
           maxVal = currentVal;
           maxPt = i;
@@ -68,6 +67,7 @@ void printLinDeming(const data * d, const parameters * p, const fit_results * fr
         printf("Grid point corresponding to the highest value (%LE) of the fitted function is at [ %0.3LE ].\n",maxVal,d->x[0][maxPt]);
       }
     }
+    free(fitVal);
   }
     
 }
@@ -114,8 +114,9 @@ void fitLinDeming(const parameters * p, const data * d, fit_results * fr, plot_d
   long double syy=0.;
   long double delta=p->fitOpt;
   
-  xb=d->xpowsum[0][1]/d->lines;
-  yb=d->mxpowsum[0][0]/d->lines;
+  //sums of x and y from the moment table (the basis is the same as for lin, see poly_basis.c)
+  xb=d->moment[p->basis.termMoment[0]]/d->lines;
+  yb=d->mMoment[p->basis.termMoment[1]]/d->lines;
   
   //compute 2nd degree sample moments
   for(i=0;i<d->lines;i++)
@@ -132,12 +133,6 @@ void fitLinDeming(const parameters * p, const data * d, fit_results * fr, plot_d
   fr->a[0]=(syy - delta*sxx + sqrt((syy-delta*sxx)*(syy-delta*sxx) + 4.*delta*sxy*sxy))/(2.*sxy);
   fr->a[1]=yb - fr->a[0]*xb;
 
-  //refit filter  
-  if(p->refitFilter==1)
-    {
-      refitFilterLin(p,d,fr,pd,p->refitFilterDist);
-      return;
-    }
   
   
   long double x,y;
@@ -166,12 +161,6 @@ void fitLinDeming(const parameters * p, const data * d, fit_results * fr, plot_d
 	if(print==1)
 		printLinDeming(d,p,fr);
 	
-	if((p->plotData==1)&&(p->verbose<1))
-		{
-			preparePlotData(d,p,fr,pd);
-			plotFormLinDeming(p,fr);
-			plotData(p,fr,pd);
-		}
 	
 	  
 }
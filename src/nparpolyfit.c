@@ -0,0 +1,272 @@
+//forward declarations
+void evalFitAtData(const parameters *, const data *, const fit_results *, long double *);
+void getDataPoint(const data *, const parameters *, int, long double *);
+
+//evaluates the fit function at the specified point
+//x: array of variable values at the point (indexed by variable #)
+long double evalNParPoly(const parameters * p, const fit_results * fr, const long double * x)
+{
+  int i;
+  long double basis[MAX_DIM];
+  long double f=0.;
+  evalPolyBasis(&p->basis,x,basis);
+  for(i=0;i<p->basis.numTerms;i++)
+    f+=fr->a[i]*basis[i];
+  return f;
+}
+
+//gets the quadratic model (Hessian, gradient, and value at the origin)
+//corresponding to a 2nd order fit function
+void getNParPolyQuadModel(const parameters * p, const fit_results * fr, quad_ci_type * ci)
+{
+  int i,j,k;
+  int var[2];
+  memset(ci,0,sizeof(quad_ci_type));
+  ci->dim=p->numVar;
+  for(i=0;i<p->basis.numTerms;i++)
+    {
+      //get the variable(s) in the term
+      k=0;
+      for(j=0;j<p->numVar;j++)
+        {
+          if(p->basis.pow[i][j]==2)
+            {
+              var[0]=j;
+              var[1]=j;
+              k=2;
+            }
+          else if((p->basis.pow[i][j]==1)&&(k<2))
+            var[k++]=j;
+        }
+      if(k==0)
+        ci->c=fr->a[i];
+      else if(k==1)
+        ci->grad[var[0]]=fr->a[i];
+      else if(var[0]==var[1])
+        ci->hess[var[0]][var[0]]=2.*fr->a[i];
+      else
+        {
+          ci->hess[var[0]][var[1]]=fr->a[i];
+          ci->hess[var[1]][var[0]]=fr->a[i];
+        }
+    }
+}
+
+//prints fit data
+void printNParPoly(const data * d, const parameters * p, const fit_results * fr, const quad_ci_type * ci)
+{
+
+  int i;
+  char termStr[256];
+
+  //simplified data printing depending on verbosity setting
+  if((p->verbose==1)&&(fr->numFitVert==1))
+    {
+      //print vertex
+      for(i=0;i<p->numVar;i++)
+        printf("%LE ",fr->fitVert[i]);
+      printf("\n");
+      return;
+    }
+  else if(p->verbose>=1)
+    {
+      //print coefficient values
+      for(i=0;i<p->basis.numTerms;i++)
+        printf("%LE ",fr->a[i]);
+      printf("\n");
+      return;
+    }
+
+  printf("\nFIT RESULTS\n-----------\n");
+  printf("Fit parameter uncertainties reported at 1-sigma.\n");
+  printf("Fit function: f(");
+  for(i=0;i<p->numVar;i++)
+    {
+      if(p->numVar<=3)
+        printf("%c",'x'+i);
+      else
+        printf("x%i",i+1);
+      if(i<p->numVar-1)
+        printf(",");
+    }
+  printf(") =");
+  for(i=0;i<p->basis.numTerms;i++)
+    {
+      if((i>0)&&(i%4==0))
+        printf("\n              ");//wrap long functions
+      if(i>0)
+        printf(" +");
+      sprintPolyBasisTerm(&p->basis,i,termStr);
+      if(strcmp(termStr,"")==0)
+        printf(" a%i",i+1);
+      else
+        printf(" a%i*%s",i+1,termStr);
+    }
+  printf("\n\n");
+  printf("Best chisq (fit): %0.3Lf\nBest chisq/NDF (fit): %0.3Lf\n\n",fr->chisq,fr->chisq/fr->ndf);
+  printf("Coefficients from fit: a1 = %LE +/- %LE\n",fr->a[0],fr->aerr[0]);
+  for(i=1;i<p->basis.numTerms;i++)
+    printf("                       a%i = %LE +/- %LE\n",i+1,fr->a[i],fr->aerr[i]);
+  printf("\n");
+
+  if((p->basis.degree==2)&&(fr->numFitVert==0))
+    printf("No unique stationary point (the fit function is degenerate).\n");
+  else if(p->basis.degree==2)
+    {
+      if(ci->type==1)
+        printf("Minimum");
+      else if(ci->type==-1)
+        printf("Maximum");
+      else
+        printf("Stationary point (not a minimum or maximum)");
+      for(i=0;i<p->numVar;i++)
+        if(fr->vertBoundsFound[i]==1)
+          {
+            printf(" (with %s confidence interval)",p->ciSigmaDesc);
+            break;
+          }
+      printf(" at:\n");
+      for(i=0;i<p->numVar;i++)
+        {
+          if(p->numVar<=3)
+            printf("%c0 = %LE",'x'+i,fr->fitVert[i]);
+          else
+            printf("x%i_0 = %LE",i+1,fr->fitVert[i]);
+          if(fr->vertBoundsFound[i]==1)
+            printf(" +/- %LE",fr->vertUBound[i]-fr->fitVert[i]);
+          printf("\n");
+        }
+      printf("\nValue of the fit function at this point: %LE\n",fr->vertVal);
+    }
+
+  if((p->findMinGridPoint == 1)||(p->findMaxGridPoint == 1)){
+    printf("\n");
+    long double *fitVal=(long double*)malloc(d->lines*sizeof(long double));
+    evalFitAtData(p,d,fr,fitVal); //see fit_eval_batch.c
+    if(p->findMinGridPoint == 1){
+      long double currentVal;
+      long double minVal = BIG_NUMBER;
+      int minPt = -1;
+      for(i=0;i<d->lines;i++){
+        currentVal = fitVal[i];
+        if(currentVal < minVal){
+          minVal = currentVal;
+          minPt = i;
+        }
+      }
+      if(minPt >= 0){
+        printf("Grid point corresponding to the lowest value (%LE) of the fitted function is at [",minVal);
+        for(i=0;i<p->numVar;i++)
+          printf(" %0.3LE ",d->x[i][minPt]);
+        printf("].\n");
+      }
+    }
+    if(p->findMaxGridPoint == 1){
+      long double currentVal;
+      long double maxVal = -1.0*BIG_NUMBER;
+      int maxPt = -1;
+      for(i=0;i<d->lines;i++){
+        currentVal = fitVal[i];
+        if(currentVal > maxVal){
+          maxVal = currentVal;
+          maxPt = i;
+        }
+      }
+      if(maxPt >= 0){
+        printf("Grid point corresponding to the highest value (%LE) of the fitted function is at [",maxVal);
+        for(i=0;i<p->numVar;i++)
+          printf(" %0.3LE ",d->x[i][maxPt]);
+        printf("].\n");
+      }
+    }
+    free(fitVal);
+  }
+
+}
+
+//fit data to a polynomial in any number of variables, using all terms up to
+//the specified total degree (fit types of the form NparpolyD), or to
+//user-defined terms (FIT_TERMS option), see poly_basis.c
+//for 2nd order polynomials, the vertex is found and for chisq data its
+//confidence region is determined (see quad_ci.c)
+void fitNParPoly(const parameters * p, const data * d, fit_results * fr, plot_data * pd, int print)
+{
+
+  int numFitPar = p->basis.numTerms;
+  fr->ndf=getNumFitLines(d)-numFitPar; //see generate_sums.c
+  if(fr->ndf < 0)
+    {
+      printf("\nERROR: not enough data points for a fit (NDF < 0) using the %s function.\n",p->fitType);
+      printf("%i data point(s) provided, %i data points needed.\n",d->lines,numFitPar);
+      exit(-1);
+    }
+  else if(fr->ndf == 0)
+    {
+      if(p->verbose<1)
+        {
+          printf("\nWARNING: number of data points is equal to the number of fit parameters (%i).\n",numFitPar);
+          printf("Fit is constrained to pass through data points (NDF = 0).\n");
+        }
+    }
+
+  //construct equations from the moment table (see poly_basis.c)
+  int i,j;
+  lin_eq_type linEq;
+  buildNormalEq(p,d,&linEq);
+
+	//solve system of equations and assign values
+	if(!(solveNormalEq(p,fr,&linEq)==1))
+		{
+			printf("ERROR: Could not determine fit parameters (%s).\n",p->fitType);
+			printf("Perhaps there are not enough data points to perform a fit?\n");
+      printf("Otherwise you can also try adjusting the fit range using the UPPER_LIMITS and LOWER_LIMITS options.\n");
+			exit(-1);
+		}
+
+  //save fit parameters
+  for(i=0;i<linEq.dim;i++)
+    fr->a[i]=linEq.solution[i];
+  residual_stats_type rs;
+  getResiduals(p,d,fr,&rs,NULL); //see residuals.c
+  fr->chisq=rs.chisq;
+  //Calculate covariances and uncertainties, see J. Wolberg
+  //'Data Analysis Using the Method of Least Squares' sec 2.5
+  for(i=0;i<linEq.dim;i++)
+    for(j=0;j<linEq.dim;j++)
+      fr->covar[i][j]=linEq.inv_matrix[i][j]*(fr->chisq/fr->ndf);
+  for(i=0;i<linEq.dim;i++)
+    fr->aerr[i]=(long double)sqrt((double)(fr->covar[i][i]));
+
+  quad_ci_type ci;
+  memset(&ci,0,sizeof(quad_ci_type));
+  memset(fr->vertBoundsFound,0,sizeof(fr->vertBoundsFound));
+  fr->numFitVert=0;
+  if(p->basis.degree==2)
+    {
+      //now that the fit is performed, use the fit parameters (and the derivative of the fitting function) to find the vertex
+      getNParPolyQuadModel(p,fr,&ci);
+      linEq.dim=ci.dim;
+      memcpy(linEq.matrix,ci.hess,sizeof(linEq.matrix));
+      for(i=0;i<ci.dim;i++)
+        linEq.vector[i]=-1*ci.grad[i];
+      if(solve_lin_eq(&linEq)==1)
+        {
+          fr->numFitVert=1;
+          for(i=0;i<ci.dim;i++)
+            fr->fitVert[i]=linEq.solution[i];
+          fr->vertVal=evalNParPoly(p,fr,fr->fitVert);
+
+          //get the type of stationary point, and the confidence region for chisq data
+          ci.delta=p->ciDelta;
+          ci.useRefVal=0;
+          getQuadCI(&ci);
+          if(strcmp(p->dataType,"chisq")==0)
+            setQuadCIBounds(&ci,fr);
+        }
+    }
+
+	//print results
+  if(print==1)
+		printNParPoly(d,p,fr,&ci);
+
+}
@@ -1,76 +1,103 @@
-//forward declarations
-long double evalLin(long double, const fit_results *);
-long double evalPoly3(long double, const fit_results *);
-long double evalPoly4(long double, const fit_results *);
-long double eval2ParPoly3(long double,long double, const fit_results *);
-long double eval1Par(long double, const fit_results *);
-long double eval2Par(long double,long double, const fit_results *);
-long double eval3Par(long double,long double,long double, const fit_results *);
+//allocates a table of plot data columns (indexed by plot # then variable #),
+//each holding n values
+//the values are not initialized, so that memory is only touched as the
+//columns are filled
+void allocPlotColumns(double * col[POWSIZE][POWSIZE], int numPlots, int numCol, int n)
+{
+  int i,k;
+  if(n<1)
+    n=1;
+  for(i=0;i<numPlots;i++)
+    for(k=0;k<numCol;k++)
+      if((col[i][k]=(double*)malloc(n*sizeof(double)))==NULL)
+        {
+          printf("ERROR: could not allocate memory for plot data.\n");
+          exit(-1);
+        }
+}
+
+//frees plot data allocated by preparePlotData
+void freePlotData(plot_data * pd)
+{
+  int i,k;
+  for(i=0;i<POWSIZE;i++)
+    for(k=0;k<POWSIZE;k++)
+      {
+        free(pd->data[i][k]);
+        free(pd->fit[i][k]);
+        pd->data[i][k]=NULL;
+        pd->fit[i][k]=NULL;
+      }
+}
 
 //generate data to be plotted
 //for multidimensional paraboloid fits, do this by by selecting datapoints nearest to the fit vertex
+//plot data is allocated here (only when plotting), sized to the data in each plot
 void preparePlotData(const data * d, const parameters * p, const fit_results * fr, plot_data * pd)
 {
-  int i,j,k;
-  long double minDist,mdv;
+  int i,j,k,n;
+  int fixed[POWSIZE],fixedCoord[POWSIZE];
+  freePlotData(pd);
+  
+  //use the index of the data (see grid_index.c), building it here if data
+  //points have been removed since it was built
+  grid_index_type tmpIndex;
+  const grid_index_type *gi=&d->index;
+  if((gi->numPts!=d->lines)||(gi->numVar!=p->numVar))
+    {
+      memset(&tmpIndex,0,sizeof(grid_index_type));
+      buildGridIndex(d,p,&tmpIndex);
+      gi=&tmpIndex;
+    }
+  
+  //fix each variable to the value in the data nearest to the fit vertex
   for(i=0;i<p->numVar;i++)
     {
-      minDist=BIG_NUMBER;
-      for(j=0;j<d->lines;j++)
-        {
-          mdv=(d->x[i][j]) - (fr->fitVert[i]);
-          if(mdv<0) mdv=mdv*-1.0; //for some reason abs() doesn't work with long double?
-          if(mdv < minDist)
-            {
-              minDist=mdv;
-              pd->fixedParVal[i]=d->x[i][j];
-            }
-        }
-    }  
+      fixedCoord[i]=getNearestGridVal(gi,i,fr->fitVert[i]);
+      if(fixedCoord[i]>=0)
+        pd->fixedParVal[i]=gi->val[i][fixedCoord[i]];
+    }
   
   //generate plot data
-  int useDataPoint=0;
+  int *pts=(int*)malloc(((d->lines>0) ? d->lines : 1)*sizeof(int));
   if(strcmp(p->plotMode,"1d")==0)
     {
       pd->numPlots=p->numVar;
       memset(pd->plotDataSize,0,sizeof(pd->plotDataSize));
+      allocPlotColumns(pd->data,pd->numPlots,p->numVar+1,d->lines);
       for(i=0;i<pd->numPlots;i++)//plot index (x,y,z)
-        for(j=0;j<d->lines;j++)
-          {
-            //check whether the other (non plot index) variables are all at their fixed values
-            useDataPoint=1;
-            for(k=0;k<p->numVar;k++)//parameter index (x,y,z)
-              if(k!=i)//is variable fixed?
-                if(d->x[k][j]!=pd->fixedParVal[k])
-                  useDataPoint=0;
-             
-            if(useDataPoint==1)
-              {
-                for(k=0;k<=p->numVar;k++)//parameter index (x,y,z)
-                  pd->data[i][k][pd->plotDataSize[i]]=((double)d->x[k][j]);
-                  
-                pd->plotDataSize[i]++;
-              }
-          }
+        {
+          //use the data points where the other (non plot index) variables are all at their fixed values
+          for(k=0;k<p->numVar;k++)
+            fixed[k]=(k!=i);
+          n=getGridSlice(gi,fixed,fixedCoord,pts);
+          for(j=0;j<n;j++)
+            for(k=0;k<=p->numVar;k++)//parameter index (x,y,z)
+              pd->data[i][k][j]=((double)d->x[k][pts[j]]);
+          pd->plotDataSize[i]=n;
+        }
     }
   else if((p->numVar==3)&&(strcmp(p->plotMode,"2d")==0))
     {
       pd->numPlots=3;
       memset(pd->plotDataSize,0,sizeof(pd->plotDataSize));
+      allocPlotColumns(pd->data,pd->numPlots,p->numVar+1,d->lines);
       for(i=0;i<pd->numPlots;i++)//plot index (yz,xz,xy)
-        for(j=0;j<d->lines;j++)
-          if(d->x[i][j]==pd->fixedParVal[i])
-            {
-              for(k=0;k<=p->numVar;k++)//parameter index (x,y,z,value)
-                pd->data[i][k][pd->plotDataSize[i]]=((double)d->x[k][j]);
-
-              pd->plotDataSize[i]++;
-            }
+        {
+          for(k=0;k<p->numVar;k++)
+            fixed[k]=(k==i);
+          n=getGridSlice(gi,fixed,fixedCoord,pts);
+          for(j=0;j<n;j++)
+            for(k=0;k<=p->numVar;k++)//parameter index (x,y,z,value)
+              pd->data[i][k][j]=((double)d->x[k][pts[j]]);
+          pd->plotDataSize[i]=n;
+        }
     }
   else if((p->numVar==2)&&(strcmp(p->plotMode,"2d")==0))
     {
       pd->numPlots=1;
       memset(pd->plotDataSize,0,sizeof(pd->plotDataSize));
+      allocPlotColumns(pd->data,pd->numPlots,p->numVar+1,d->lines);
       for(i=0;i<d->lines;i++)
         {
           //copy over data to plot
@@ -84,6 +111,7 @@ void preparePlotData(const data * d, const parameters * p, const fit_results * f
     {
       pd->numPlots=1;
       memset(pd->plotDataSize,0,sizeof(pd->plotDataSize));
+      allocPlotColumns(pd->data,pd->numPlots,p->numVar+1,d->lines);
       for(i=0;i<d->lines;i++)
         {
           //copy over data to plot
@@ -107,6 +135,19 @@ void preparePlotData(const data * d, const parameters * p, const fit_results * f
       exit(-1);
     }
 
+  free(pts);
+  if(gi==&tmpIndex)
+    freeGridIndex(&tmpIndex);
+
+  //reduce very large datasets to the plotting point budget (see plot_downsample.c)
+  downsamplePlotData(p,fr,pd);
+
+  //shrink the plot data to the number of data points in each plot
+  for(i=0;i<pd->numPlots;i++)
+    if(pd->plotDataSize[i]>0)
+      for(k=0;k<=p->numVar;k++)
+        pd->data[i][k]=(double*)realloc(pd->data[i][k],pd->plotDataSize[i]*sizeof(double));
+
   //determine whether or not to use scientific notation for labels
   for(i=0;i<pd->numPlots;i++)
     for(j=0;j<p->numVar;j++)
@@ -123,56 +164,39 @@ void preparePlotData(const data * d, const parameters * p, const fit_results * f
   pd->min_m=(double)d->min_m;
   pd->max_m=(double)d->max_m;
 
-  //generate fit plot data
-  pd->numFitPtsPerVar=20;
-  pd->numFitPlotPts=1;
-  double floorFactor;
-  for(i=0;i<p->numVar;i++)
-    pd->numFitPlotPts=pd->numFitPlotPts*pd->numFitPtsPerVar; //compute numFitPtsPerVar^numVar
-
-  for(i=0;i<pd->numPlots;i++)
-    for(j=0;j<pd->numFitPlotPts;j++)
-      if(j<MAXFILELENGTH)
-        {
-          floorFactor=1;
-          for(k=0;k<p->numVar;k++)
-            {
-              if(k!=0)
-                floorFactor=floorFactor*pd->numFitPtsPerVar;
-              
-              //variable not fixed
-              //had to use a spreadsheet to visualize this haHAA
-              pd->fit[i][k][j]=d->min_x[k] + (((int)(floor((double)j/floorFactor))%pd->numFitPtsPerVar)/(double)pd->numFitPtsPerVar)*(d->max_x[k] - d->min_x[k]);
-
-              //handle fixed variable cases
-              if(strcmp(p->plotMode,"1d")==0)
-                {
-                  if(k!=i)//variable fixed
-                    pd->fit[i][k][j]=(double)pd->fixedParVal[k];
-                }
-              else if((p->numVar==3)&&(strcmp(p->plotMode,"2d")==0))
-                {
-                  if(k==i)//variable fixed
-                    pd->fit[i][k][j]=(double)pd->fixedParVal[k];
-                }
-            }
-          if(strcmp(p->fitType,"poly2")==0)
-            pd->fit[i][p->numVar][j]=(double)eval1Par(pd->fit[i][0][j],fr);
-          else if((strcmp(p->fitType,"lin")==0)||(strcmp(p->fitType,"lin_deming")==0))
-            pd->fit[i][p->numVar][j]=(double)evalLin(pd->fit[i][0][j],fr);
-          else if(strcmp(p->fitType,"poly3")==0)
-            pd->fit[i][p->numVar][j]=(double)evalPoly3(pd->fit[i][0][j],fr);
-          else if(strcmp(p->fitType,"poly4")==0)
-            pd->fit[i][p->numVar][j]=(double)evalPoly4(pd->fit[i][0][j],fr);
-          else if(strcmp(p->fitType,"2parpoly2")==0)
-            pd->fit[i][p->numVar][j]=((double)eval2Par(pd->fit[i][0][j],pd->fit[i][1][j],fr));
-          else if(strcmp(p->fitType,"2parpoly3")==0)
-            pd->fit[i][p->numVar][j]=((double)eval2ParPoly3(pd->fit[i][0][j],pd->fit[i][1][j],fr));
-          else if(strcmp(p->fitType,"3parpoly2")==0)
-            pd->fit[i][p->numVar][j]=(double)eval3Par(pd->fit[i][0][j],pd->fit[i][1][j],pd->fit[i][2][j],fr);
-          else
-            printf("WARNING: Unknown fit type '%s', cannot plot fit.\n",p->fitType);
-        }
+  //generate fit plot data, sampling the fit function adaptively over the
+  //free (non-fixed) variables of each plot (see plot_sampling.c)
+  long double x[POWSIZE];
+  int numAxes,var[2];
+  double lo[2],hi[2];
+  memset(pd->fitPlotSize,0,sizeof(pd->fitPlotSize));
+  if(strcmp(p->plotMode,"3d")!=0)//the fit function isn't shown on heatmap plots
+    for(i=0;i<pd->numPlots;i++)
+      {
+        numAxes=0;
+        for(k=0;k<p->numVar;k++)
+          {
+            x[k]=pd->fixedParVal[k];
+            if(strcmp(p->plotMode,"1d")==0)
+              {
+                if(k!=i)//variable fixed
+                  continue;
+              }
+            else if((p->numVar==3)&&(strcmp(p->plotMode,"2d")==0))
+              {
+                if(k==i)//variable fixed
+                  continue;
+              }
+            if(numAxes<2)
+              {
+                var[numAxes]=k;
+                lo[numAxes]=(double)d->min_x[k];
+                hi[numAxes]=(double)d->max_x[k];
+                numAxes++;
+              }
+          }
+        pd->fitPlotSize[i]=sampleFitForPlot(p,fr,x,numAxes,var,lo,hi,pd->fit[i],&pd->fitPlotBlock[i]);
+      }
     
 
 }
@@ -190,6 +214,7 @@ void plotPrompt(int cont)
 	if(c=='g')
 		{
 			printf("Enter 'exit' to return from the gnuplot prompt.\n");
+			printf("Plot data is sent inline, so use 'refresh' rather than 'replot' to redraw the plot.\n");
 			fgets(inp,256,stdin);
 			while(strcmp(inp,"exit\n")!=0)
 				{
@@ -201,12 +226,70 @@ void plotPrompt(int cont)
 	return;
 }
 
+//gets the name of the file that a plot is exported to (PLOT_EXPORT option)
+//plots are numbered when more than one plot is shown
+void getPlotExportName(const parameters * p, int plot, int numPlots, char * name)
+{
+  const char *ext[4]={"","png","svg","pdf"};
+  if(numPlots>1)
+    sprintf(name,"%s_%i.%s",p->plotExportPath,plot+1,ext[p->plotExport]);
+  else
+    sprintf(name,"%s.%s",p->plotExportPath,ext[p->plotExport]);
+}
+
+//sets up gnuplot before the items of a plot are added
+void startPlot(const parameters * p, int plot, int numPlots)
+{
+  char name[512];
+  const char *term[4]={"","png","svg","pdf"};
+  if(p->plotExport>0)
+    {
+      getPlotExportName(p,plot,numPlots,name);
+      gnuplot_cmd(handle,"set terminal %s",term[p->plotExport]);
+      gnuplot_cmd(handle,"set output '%s'",name);
+    }
+}
+
+//finishes a plot once all of its items are added
+//interactive plots wait at the gnuplot prompt, while exported plots are
+//drawn to their file without waiting, since gnuplot renders them in its own
+//process
+void endPlot(const parameters * p, int plot, int numPlots)
+{
+  char name[512];
+  if(p->plotExport>0)
+    {
+      gnuplot_draw(handle);
+      gnuplot_cmd(handle,"set output");//closes the file
+      getPlotExportName(p,plot,numPlots,name);
+      printf("Plot exported to file: %s\n",name);
+    }
+  else if(plot<(numPlots-1))
+    plotPrompt(1);
+  else
+    plotPrompt(0);
+  gnuplot_resetplot(handle);
+}
+
 void plotData(const parameters * p, fit_results * fr, plot_data * pd)
 {
   int i;
   char * str=(char*)calloc(256,sizeof(char));
-  plotOpen=1; 
-  handle=gnuplot_init();
+  if(plotOpen==0)
+    {
+      //a single gnuplot session is used for all plots
+      if(p->plotExport>0)
+        handle=gnuplot_init_headless();
+      else
+        handle=gnuplot_init();
+      if(handle==NULL)
+        {
+          printf("ERROR: could not start gnuplot.\n");
+          exit(-1);
+        }
+      plotOpen=1;
+    }
+  gnuplot_setdeferred(handle,(p->plotExport>0));
   char fitTxtStr[256];
 	sprintf(fitTxtStr,"Fit (%s)",p->fitType);
     
@@ -216,6 +299,7 @@ void plotData(const parameters * p, fit_results * fr, plot_data * pd)
     {
       for(i=0;i<p->numVar;i++)
         {
+          startPlot(p,i,p->numVar);
           gnuplot_setstyle(handle,"points"); //set style for grid points
           if(strcmp(p->dataType,"chisq")==0)
             gnuplot_cmd(handle,"set ylabel 'Chisq'");
@@ -229,19 +313,7 @@ void plotData(const parameters * p, fit_results * fr, plot_data * pd)
           if(pd->axisLabelStyle[i][p->numVar]==1)
             gnuplot_cmd(handle,"set format y '%%12.2E'");
           gnuplot_setstyle(handle,"lines");//set style for fit data
-          if(p->numVar==1)
-            {
-              gnuplot_plot_xy(handle, pd->fit[i][i], pd->fit[i][p->numVar], pd->numFitPlotPts, fitTxtStr);
-            }  
-          else
-            {
-              if(i==0)
-                gnuplot_plot_xy(handle, pd->fit[i][i], pd->fit[i][p->numVar], pd->numFitPtsPerVar, fitTxtStr);
-              else if(i==1)
-                gnuplot_plot_xygrid(handle, pd->fit[i][i], pd->fit[i][p->numVar], pd->numFitPtsPerVar*pd->numFitPtsPerVar, pd->numFitPtsPerVar, pd->numFitPtsPerVar, 0, fitTxtStr);
-              else if(i==2)
-                gnuplot_plot_xygrid(handle, pd->fit[i][i], pd->fit[i][p->numVar], pd->numFitPlotPts, pd->numFitPtsPerVar, pd->numFitPtsPerVar*pd->numFitPtsPerVar, 0, fitTxtStr);
-            }
+          gnuplot_plot_xy(handle, pd->fit[i][i], pd->fit[i][p->numVar], pd->fitPlotSize[i], fitTxtStr);
           //strcpy(str,fr->fitForm[i]);//retrieve fit data functional form
           //gnuplot_plot_equation(handle, str, "Fit (function)");
           //plot confidence intervals
@@ -275,12 +347,11 @@ void plotData(const parameters * p, fit_results * fr, plot_data * pd)
               if(i==1)
                 printf("Parameter %i fixed to %Lf\n",1,pd->fixedParVal[0]);
             }
-          printf("%i data points available for plot.\n",pd->plotDataSize[i]);
-          if(i<(p->numVar-1))
-            plotPrompt(1);
-          else
-            plotPrompt(0);
-          gnuplot_resetplot(handle);
+          printf("%i data points available for plot",pd->plotDataFullSize[i]);
+          if(pd->plotDataSize[i]<pd->plotDataFullSize[i])
+            printf(" (downsampled to %i)",pd->plotDataSize[i]);
+          printf(".\n");
+          endPlot(p,i,p->numVar);
         }
     }
   else if(strcmp(p->plotMode,"2d")==0)
@@ -289,6 +360,7 @@ void plotData(const parameters * p, fit_results * fr, plot_data * pd)
         {
           for(i=0;i<p->numVar;i++)
             {
+              startPlot(p,i,p->numVar);
               gnuplot_setstyle(handle,"points"); //set style for grid points
               if(i==0)
                 {
@@ -331,24 +403,24 @@ void plotData(const parameters * p, fit_results * fr, plot_data * pd)
               gnuplot_setstyle(handle,"lines");
               gnuplot_cmd(handle,"set grid");//set style for fit data
               if(i==0)
-                gnuplot_plot_xyzgrid(handle, pd->fit[i][1], pd->fit[i][2], pd->fit[i][p->numVar], pd->numFitPlotPts, pd->numFitPtsPerVar*pd->numFitPtsPerVar, pd->numFitPtsPerVar, 0, fitTxtStr);
+                gnuplot_plot_xyzgrid(handle, pd->fit[i][1], pd->fit[i][2], pd->fit[i][p->numVar], pd->fitPlotSize[i], pd->fitPlotBlock[i], 0, 0, fitTxtStr);
               else if(i==1)
-                gnuplot_plot_xyzgrid(handle, pd->fit[i][0], pd->fit[i][2], pd->fit[i][p->numVar], pd->numFitPlotPts, pd->numFitPtsPerVar, 0, pd->numFitPtsPerVar, fitTxtStr);
+                gnuplot_plot_xyzgrid(handle, pd->fit[i][0], pd->fit[i][2], pd->fit[i][p->numVar], pd->fitPlotSize[i], pd->fitPlotBlock[i], 0, 0, fitTxtStr);
               else if(i==2)
-                gnuplot_plot_xyzgrid(handle, pd->fit[i][0], pd->fit[i][1], pd->fit[i][p->numVar], pd->numFitPtsPerVar*pd->numFitPtsPerVar, pd->numFitPtsPerVar, 0, 0, fitTxtStr);
+                gnuplot_plot_xyzgrid(handle, pd->fit[i][0], pd->fit[i][1], pd->fit[i][p->numVar], pd->fitPlotSize[i], pd->fitPlotBlock[i], 0, 0, fitTxtStr);
               //strcpy(str,fr->fitForm[i]);//retrieve fit data functional form
               //gnuplot_plot_equation(handle, str, "Fit (function)");
               printf("Showing surface plot with parameter %i fixed to %Lf\n",i+1,pd->fixedParVal[i]);
-              printf("%i data points available for plot.\n",pd->plotDataSize[i]);
-              if(i<(p->numVar-1))
-                plotPrompt(1);
-              else
-                plotPrompt(0);
-              gnuplot_resetplot(handle);
+              printf("%i data points available for plot",pd->plotDataFullSize[i]);
+              if(pd->plotDataSize[i]<pd->plotDataFullSize[i])
+                printf(" (downsampled to %i)",pd->plotDataSize[i]);
+              printf(".\n");
+              endPlot(p,i,p->numVar);
             }
         }
       else if(p->numVar==2)
         {
+          startPlot(p,0,1);
           gnuplot_setstyle(handle,"points"); //set style for grid points
           gnuplot_plot_xyz(handle, pd->data[0][0], pd->data[0][1], pd->data[0][p->numVar], pd->plotDataSize[0], "Data");
           if(pd->axisLabelStyle[0][0]==1)
@@ -366,19 +438,28 @@ void plotData(const parameters * p, fit_results * fr, plot_data * pd)
           gnuplot_setstyle(handle,"lines");
           gnuplot_cmd(handle,"set grid");//set style for fit data
           //gnuplot_cmd(handle,"set dgrid3d 30,30 qnorm 2");//set style for fit data
-          gnuplot_plot_xyzgrid(handle, pd->fit[0][0], pd->fit[0][1], pd->fit[0][p->numVar], pd->numFitPlotPts, pd->numFitPtsPerVar, 0, 0, fitTxtStr);
+          gnuplot_plot_xyzgrid(handle, pd->fit[0][0], pd->fit[0][1], pd->fit[0][p->numVar], pd->fitPlotSize[0], pd->fitPlotBlock[0], 0, 0, fitTxtStr);
+          //show the boundary of the confidence region, where it was found
+          if(fr->ciContourSize>0)
+            {
+              snprintf(str,256,"Confidence region (%.200s)",p->ciSigmaDesc);
+              gnuplot_plot_xyz(handle, fr->ciContour[0], fr->ciContour[1], fr->ciContour[2], fr->ciContourSize, str);
+            }
           //strcpy(str,fr->fitForm[0]);//retrieve fit data functional form
           //gnuplot_plot_equation(handle, str, "Fit (function)");
           printf("Showing surface plot.\n");
-          printf("%i data points available for plot.\n",pd->plotDataSize[0]);
-          plotPrompt(0);
-          gnuplot_resetplot(handle);
+          printf("%i data points available for plot",pd->plotDataFullSize[0]);
+          if(pd->plotDataSize[0]<pd->plotDataFullSize[0])
+            printf(" (downsampled to %i)",pd->plotDataSize[0]);
+          printf(".\n");
+          endPlot(p,0,1);
         }
     }
   else if(strcmp(p->plotMode,"3d")==0)
     {
       if(p->numVar==3)
         {
+          startPlot(p,0,1);
           gnuplot_setstyle(handle,"points"); //set style for grid points
           gnuplot_plot_xyza(handle, pd->data[0][0], pd->data[0][1], pd->data[0][2], pd->data[0][p->numVar], pd->plotDataSize[0], "Data");
           if(pd->axisLabelStyle[0][0]==1)
@@ -391,7 +472,7 @@ void plotData(const parameters * p, fit_results * fr, plot_data * pd)
           gnuplot_cmd(handle,str);
           sprintf(str,"set cbrange [%f:%f]",pd->min_m,pd->max_m); //set the color bar range
           gnuplot_cmd(handle,str);
-          if(strcmp(p->fitType,"3parpoly2")==0)
+          if(p->model->plotVertex==1)
             {
               gnuplot_setcolor(handle,"black");
               gnuplot_cmd(handle,"set pointsize 1.5");
@@ -401,9 +482,11 @@ void plotData(const parameters * p, fit_results * fr, plot_data * pd)
               gnuplot_plot_xyz(handle, &xVert, &yVert, &zVert, 1, "Fit Vertex");
             }
           printf("Showing heatmap plot.\n");
-          printf("%i data points available for plot.\n",pd->plotDataSize[0]);
-          plotPrompt(0);
-          gnuplot_resetplot(handle);
+          printf("%i data points available for plot",pd->plotDataFullSize[0]);
+          if(pd->plotDataSize[0]<pd->plotDataFullSize[0])
+            printf(" (downsampled to %i)",pd->plotDataSize[0]);
+          printf(".\n");
+          endPlot(p,0,1);
         }
     }
   else
@@ -414,11 +497,26 @@ void plotData(const parameters * p, fit_results * fr, plot_data * pd)
 
 }
 
-//function run after CTRL-C, used to clean up temporary files generated
+//function run after CTRL-C, used to close the gnuplot session opened
 //by the plotting library
 void sigint_cleanup()
 {
   if(plotOpen==1)
-    gnuplot_close(handle); //cleans up temporary files  
+    gnuplot_close(handle); //closes gnuplot and frees plot data
   exit(1); 
 }
+
+//plots the data and the final fit (PLOT option)
+//this is done once all of the results have been reported, since the
+//plot waits at the prompt
+void plotFit(const parameters * p, const data * d, fit_results * fr, plot_data * pd)
+{
+  if(p->model->plotForm==NULL)
+    {
+      printf("\nWARNING: plotting is not available for the %s fit type.\n",p->fitType);
+      return;
+    }
+  preparePlotData(d,p,fr,pd);
+  p->model->plotForm(p,fr,pd);
+  plotData(p,fr,pd);
+}
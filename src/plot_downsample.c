@@ -0,0 +1,283 @@
+//routines used to reduce the number of data points sent to gnuplot for
+//very large datasets (PLOT_MAX_POINTS option)
+//1d plots are reduced using Largest-Triangle-Three-Buckets, which keeps the
+//visual shape of the series, and 2d/3d plots are reduced by binning the data
+//on a regular grid/voxel lattice, keeping the lowest, highest and mean value
+//in each bin
+//data in the neighbourhood of the fit vertex is always kept at full resolution
+
+typedef struct
+{
+  double x;
+  int ind;
+}plot_sort_type;
+
+int comparePlotSort(const void * a, const void * b)
+{
+  double xa=((const plot_sort_type*)a)->x;
+  double xb=((const plot_sort_type*)b)->x;
+  if(xa<xb)
+    return -1;
+  else if(xa>xb)
+    return 1;
+  return ((const plot_sort_type*)a)->ind - ((const plot_sort_type*)b)->ind;
+}
+
+//replaces the data of a plot with the (numOut) selected data points
+//ind: indices of the selected data points, or -1 for a synthetic point taken
+//from the next entry of synth (indexed by variable # then synthetic point #)
+void setDownsampledPlotData(plot_data * pd, int plot, int numCol, const int * ind, int numOut, double ** synth)
+{
+  int i,k;
+  int numSynth=0;
+  double *buf=(double*)malloc(numOut*sizeof(double));
+  for(k=0;k<numCol;k++)
+    {
+      numSynth=0;
+      for(i=0;i<numOut;i++)
+        if(ind[i]>=0)
+          buf[i]=pd->data[plot][k][ind[i]];
+        else
+          buf[i]=synth[k][numSynth++];
+      memcpy(pd->data[plot][k],buf,numOut*sizeof(double));
+    }
+  free(buf);
+  pd->plotDataSize[plot]=numOut;
+}
+
+//reduces a 1d plot (data value vs. variable var) to maxPts data points
+//using Largest-Triangle-Three-Buckets
+//see S. Steinarsson 'Downsampling Time Series for Visual Representation'
+//(M.Sc. thesis, University of Iceland, 2013)
+//vert: position of the fit vertex along the variable, data points within half
+//a bucket width of the vertex are all kept
+void downsample1DPlot(plot_data * pd, int plot, int numCol, int var, int valVar, double vert, int maxPts)
+{
+  int i,j,n,b,numOut;
+  int bStart,bEnd,nStart,nEnd,best;
+  double avgX,avgY,area,bestArea,ax,ay;
+  n=pd->plotDataSize[plot];
+
+  plot_sort_type *srt=(plot_sort_type*)malloc(n*sizeof(plot_sort_type));
+  int *ind=(int*)malloc(n*sizeof(int));
+  for(i=0;i<n;i++)
+    {
+      srt[i].x=pd->data[plot][var][i];
+      srt[i].ind=i;
+    }
+  qsort(srt,n,sizeof(plot_sort_type),comparePlotSort);
+
+  double *x=pd->data[plot][var];
+  double *y=pd->data[plot][valVar];
+  double bucketSize=(double)(n-2)/(double)(maxPts-2);
+  double bucketWidth=(srt[n-1].x - srt[0].x)/(double)(maxPts-2);
+
+  //first data point is always kept
+  numOut=0;
+  ind[numOut++]=srt[0].ind;
+  ax=x[srt[0].ind];
+  ay=y[srt[0].ind];
+  for(b=0;b<maxPts-2;b++)
+    {
+      bStart=1+(int)(b*bucketSize);
+      bEnd=1+(int)((b+1)*bucketSize);
+      if(bEnd>n-1)
+        bEnd=n-1;
+
+      //average of the next bucket (or the last data point)
+      nStart=bEnd;
+      nEnd=1+(int)((b+2)*bucketSize);
+      if(nEnd>n)
+        nEnd=n;
+      if(nStart>=nEnd)
+        nStart=nEnd-1;
+      avgX=0.;
+      avgY=0.;
+      for(j=nStart;j<nEnd;j++)
+        {
+          avgX+=x[srt[j].ind];
+          avgY+=y[srt[j].ind];
+        }
+      avgX/=(double)(nEnd-nStart);
+      avgY/=(double)(nEnd-nStart);
+
+      //keep the data point forming the largest triangle with the previously
+      //kept point and the next bucket average
+      //data points near the vertex are all kept
+      best=-1;
+      bestArea=-1.;
+      for(j=bStart;j<bEnd;j++)
+        {
+          if(fabs(x[srt[j].ind] - vert)<=0.5*bucketWidth)
+            {
+              if(best>=0)
+                ind[numOut++]=srt[best].ind;
+              ind[numOut++]=srt[j].ind;
+              best=-1;
+              bestArea=-1.;
+              ax=x[srt[j].ind];
+              ay=y[srt[j].ind];
+              continue;
+            }
+          area=fabs((ax - avgX)*(y[srt[j].ind] - ay) - (ax - x[srt[j].ind])*(avgY - ay));
+          if(area>bestArea)
+            {
+              bestArea=area;
+              best=j;
+            }
+        }
+      if(best>=0)
+        {
+          ind[numOut++]=srt[best].ind;
+          ax=x[srt[best].ind];
+          ay=y[srt[best].ind];
+        }
+    }
+  //last data point is always kept
+  ind[numOut++]=srt[n-1].ind;
+
+  setDownsampledPlotData(pd,plot,numCol,ind,numOut,NULL);
+  free(srt);
+  free(ind);
+}
+
+//reduces a 2d or 3d plot to roughly maxPts data points by binning the data
+//on a regular lattice over the plotted variables (coordVar)
+//each bin is replaced by the data points with the lowest and highest data
+//value, and a point at the mean position and value of the bin
+//vert: the fit vertex (indexed by variable #), data points within half a bin
+//width of the vertex are all kept
+void downsampleBinnedPlot(plot_data * pd, int plot, int numCol, const int * coordVar, int numCoord, int valVar, const long double * vert, int maxPts)
+{
+  int i,j,k,n,numOut,numSynth,numBins,nearVert;
+  int binsPerVar,bin,coordBin;
+  double minC[3],maxC[3];
+  n=pd->plotDataSize[plot];
+
+  binsPerVar=(int)floor(pow((double)maxPts/3.,1./(double)numCoord));
+  if(binsPerVar<1)
+    binsPerVar=1;
+  numBins=1;
+  for(k=0;k<numCoord;k++)
+    numBins*=binsPerVar;
+
+  for(k=0;k<numCoord;k++)
+    {
+      minC[k]=pd->data[plot][coordVar[k]][0];
+      maxC[k]=minC[k];
+      for(i=1;i<n;i++)
+        {
+          if(pd->data[plot][coordVar[k]][i]<minC[k])
+            minC[k]=pd->data[plot][coordVar[k]][i];
+          if(pd->data[plot][coordVar[k]][i]>maxC[k])
+            maxC[k]=pd->data[plot][coordVar[k]][i];
+        }
+    }
+
+  int *binInd=(int*)malloc(n*sizeof(int));
+  int *binCount=(int*)calloc(numBins,sizeof(int));
+  int *binMin=(int*)malloc(numBins*sizeof(int));
+  int *binMax=(int*)malloc(numBins*sizeof(int));
+  double *binSum=(double*)calloc((size_t)numBins*numCol,sizeof(double));
+  for(i=0;i<n;i++)
+    {
+      bin=0;
+      nearVert=1;
+      for(k=0;k<numCoord;k++)
+        {
+          coordBin=0;
+          if(maxC[k]>minC[k])
+            coordBin=(int)(binsPerVar*(pd->data[plot][coordVar[k]][i] - minC[k])/(maxC[k] - minC[k]));
+          if(coordBin>=binsPerVar)
+            coordBin=binsPerVar-1;
+          bin=bin*binsPerVar + coordBin;
+          if(nearVert)
+            if(fabs(pd->data[plot][coordVar[k]][i] - (double)vert[coordVar[k]])>0.5*(maxC[k] - minC[k])/binsPerVar)
+              nearVert=0;
+        }
+      if(nearVert)
+        {
+          binInd[i]=-1;//kept at full resolution
+          continue;
+        }
+      binInd[i]=bin;
+      if(binCount[bin]==0)
+        {
+          binMin[bin]=i;
+          binMax[bin]=i;
+        }
+      else
+        {
+          if(pd->data[plot][valVar][i]<pd->data[plot][valVar][binMin[bin]])
+            binMin[bin]=i;
+          if(pd->data[plot][valVar][i]>pd->data[plot][valVar][binMax[bin]])
+            binMax[bin]=i;
+        }
+      binCount[bin]++;
+      for(k=0;k<numCol;k++)
+        binSum[(size_t)bin*numCol+k]+=pd->data[plot][k][i];
+    }
+
+  //select data points, in their original order
+  int *ind=(int*)malloc(n*sizeof(int));
+  double *synth[POWSIZE];
+  for(k=0;k<numCol;k++)
+    synth[k]=(double*)malloc(numBins*sizeof(double));
+  numOut=0;
+  numSynth=0;
+  for(i=0;i<n;i++)
+    {
+      if(binInd[i]<0)
+        ind[numOut++]=i;
+      else if((i==binMin[binInd[i]])||(i==binMax[binInd[i]]))
+        ind[numOut++]=i;
+    }
+  for(j=0;j<numBins;j++)
+    if(binCount[j]>2)
+      {
+        ind[numOut++]=-1;
+        for(k=0;k<numCol;k++)
+          synth[k][numSynth]=binSum[(size_t)j*numCol+k]/binCount[j];
+        numSynth++;
+      }
+
+  setDownsampledPlotData(pd,plot,numCol,ind,numOut,synth);
+  for(k=0;k<numCol;k++)
+    free(synth[k]);
+  free(ind);
+  free(binInd);
+  free(binCount);
+  free(binMin);
+  free(binMax);
+  free(binSum);
+}
+
+//reduces the number of data points in each plot to (approximately) the
+//plotting point budget, if needed
+void downsamplePlotData(const parameters * p, const fit_results * fr, plot_data * pd)
+{
+  int i,j,k;
+  int coordVar[3];
+  for(i=0;i<pd->numPlots;i++)
+    {
+      pd->plotDataFullSize[i]=pd->plotDataSize[i];
+      if((p->plotMaxPts<=0)||(pd->plotDataSize[i]<=p->plotMaxPts))
+        continue;
+      if(strcmp(p->plotMode,"1d")==0)
+        {
+          //LTTB needs at least the first, last, and one bucket
+          if(p->plotMaxPts<3)
+            continue;
+          downsample1DPlot(pd,i,p->numVar+1,i,p->numVar,(double)fr->fitVert[i],p->plotMaxPts);
+        }
+      else
+        {
+          //plotted variables are those which aren't fixed
+          k=0;
+          for(j=0;j<p->numVar;j++)
+            if(!((p->numVar==3)&&(strcmp(p->plotMode,"2d")==0)&&(j==i)))
+              coordVar[k++]=j;
+          downsampleBinnedPlot(pd,i,p->numVar+1,coordVar,k,p->numVar,fr->fitVert,p->plotMaxPts);
+        }
+    }
+}
@@ -0,0 +1,297 @@
+//adaptive sampling of the fit function for plotting
+//the fit function is sampled on a rectilinear grid over the free variables of
+//a plot (a curve for 1 free variable, a surface for 2), starting from a
+//coarse uniform grid
+//grid intervals are repeatedly bisected where the fit function deviates from
+//linear interpolation between the grid nodes by more than PLOT_FIT_TOLERANCE
+//(relative to the range of the fit function over the plot), so that points
+//are concentrated where the fit function is strongly curved (eg. near sharp
+//minima), up to a budget of PLOT_FIT_MAX_POINTS points per plot
+
+typedef struct
+{
+  int numAxes;//number of free variables (1 or 2)
+  int var[2];//variable # of each free variable
+  int numNodes[2];//number of grid nodes along each free variable (1 for an unused axis)
+  double *node[2];//grid node positions along each free variable
+  int *active[2];//1 if the interval following each node may still need to be bisected
+  double *f;//fit function values on the grid, indexed by node # along the 1st free variable + numNodes[0]*node # along the 2nd
+}fit_sample_grid;
+
+//evaluates the fit function at a batch of n points, with the free variables
+//taken from u and v and all other variables fixed at their values in x
+void evalFitSampleBatch(const parameters * p, const fit_results * fr, const fit_sample_grid * g, const long double * x, const double * u, const double * v, int n, double * f)
+{
+  int i,k;
+  const double *col[POWSIZE];
+  double *fixed[POWSIZE];
+  for(k=0;k<p->numVar;k++)
+    {
+      fixed[k]=NULL;
+      if(k==g->var[0])
+        col[k]=u;
+      else if((g->numAxes>1)&&(k==g->var[1]))
+        col[k]=v;
+      else
+        {
+          fixed[k]=(double*)malloc(n*sizeof(double));
+          for(i=0;i<n;i++)
+            fixed[k][i]=(double)x[k];
+          col[k]=fixed[k];
+        }
+    }
+  p->model->evalBatchDouble(p,fr,col,n,f);
+  for(k=0;k<p->numVar;k++)
+    if(fixed[k]!=NULL)
+      free(fixed[k]);
+}
+
+int compareSampleErr(const void * a, const void * b)
+{
+  double ea=*(const double*)a;
+  double eb=*(const double*)b;
+  if(ea>eb)
+    return -1;
+  else if(ea<eb)
+    return 1;
+  return 0;
+}
+
+//bisects the grid intervals along axis a (0 or 1) where the fit function
+//deviates from linear interpolation between the grid nodes
+//returns the number of intervals bisected
+int refineFitSampleAxis(const parameters * p, const fit_results * fr, fit_sample_grid * g, const long double * x, int a, int maxNodes)
+{
+  int i,j,c,ind;
+  int b=1-a;
+  int na=g->numNodes[a];
+  int nb=g->numNodes[b];
+
+  //intervals which may need to be bisected
+  int numCand=0;
+  for(i=0;i<na-1;i++)
+    if(g->active[a][i])
+      numCand++;
+  if(numCand==0)
+    return 0;
+  if(na>=maxNodes)
+    {
+      memset(g->active[a],0,na*sizeof(int));
+      return 0;
+    }
+
+  //evaluate the fit function at the interval midpoints, for every grid node
+  //along the other axis
+  int *cand=(int*)malloc(numCand*sizeof(int));
+  double *u=(double*)malloc(numCand*nb*sizeof(double));
+  double *v=(double*)malloc(numCand*nb*sizeof(double));
+  double *fm=(double*)malloc(numCand*nb*sizeof(double));
+  double *err=(double*)malloc(numCand*sizeof(double));
+  c=0;
+  for(i=0;i<na-1;i++)
+    if(g->active[a][i])
+      {
+        cand[c]=i;
+        for(j=0;j<nb;j++)
+          {
+            if(a==0)
+              {
+                u[c*nb+j]=0.5*(g->node[0][i] + g->node[0][i+1]);
+                v[c*nb+j]=g->node[1][j];
+              }
+            else
+              {
+                u[c*nb+j]=g->node[0][j];
+                v[c*nb+j]=0.5*(g->node[1][i] + g->node[1][i+1]);
+              }
+          }
+        c++;
+      }
+  evalFitSampleBatch(p,fr,g,x,u,v,numCand*nb,fm);
+
+  //range of the fit function over the plot, used to normalize the deviations
+  double fMin=g->f[0];
+  double fMax=g->f[0];
+  for(i=1;i<g->numNodes[0]*g->numNodes[1];i++)
+    {
+      if(g->f[i]<fMin)
+        fMin=g->f[i];
+      if(g->f[i]>fMax)
+        fMax=g->f[i];
+    }
+  double range=fMax - fMin;
+  if(!(range>0.))
+    range=1.;
+
+  //deviation of the fit function from linear interpolation at each midpoint
+  int numBisect=0;
+  for(c=0;c<numCand;c++)
+    {
+      err[c]=0.;
+      for(j=0;j<nb;j++)
+        {
+          if(a==0)
+            ind=cand[c] + na*j;
+          else
+            ind=j + nb*cand[c];
+          double dev=fabs(fm[c*nb+j] - 0.5*(g->f[ind] + g->f[ind + ((a==0) ? 1 : nb)]))/range;
+          if(dev>err[c])
+            err[c]=dev;
+        }
+      if(err[c]>PLOT_FIT_TOLERANCE)
+        numBisect++;
+    }
+
+  //if the budget doesn't allow bisecting all intervals, bisect those with
+  //the largest deviations
+  double thresh=PLOT_FIT_TOLERANCE;
+  if(numBisect>maxNodes-na)
+    {
+      numBisect=maxNodes-na;
+      double *srt=(double*)malloc(numCand*sizeof(double));
+      memcpy(srt,err,numCand*sizeof(double));
+      qsort(srt,numCand,sizeof(double),compareSampleErr);
+      if(srt[numBisect-1]>thresh)
+        thresh=srt[numBisect-1];
+      free(srt);
+    }
+
+  //build the refined grid
+  int nNew=na+numBisect;
+  double *node=(double*)malloc(nNew*sizeof(double));
+  int *active=(int*)calloc(nNew,sizeof(int));
+  double *f=(double*)malloc(nNew*nb*sizeof(double));
+  int bisected=0;
+  c=0;
+  ind=0;
+  for(i=0;i<na;i++)
+    {
+      node[ind]=g->node[a][i];
+      for(j=0;j<nb;j++)
+        if(a==0)
+          f[ind + nNew*j]=g->f[i + na*j];
+        else
+          f[j + nb*ind]=g->f[j + nb*i];
+      ind++;
+      if((c<numCand)&&(cand[c]==i))
+        {
+          if((err[c]>=thresh)&&(err[c]>PLOT_FIT_TOLERANCE)&&(bisected<numBisect))
+            {
+              //insert the midpoint, both halves may need further bisection
+              active[ind-1]=1;
+              active[ind]=1;
+              node[ind]=0.5*(g->node[a][i] + g->node[a][i+1]);
+              for(j=0;j<nb;j++)
+                if(a==0)
+                  f[ind + nNew*j]=fm[c*nb+j];
+                else
+                  f[j + nb*ind]=fm[c*nb+j];
+              ind++;
+              bisected++;
+            }
+          c++;
+        }
+    }
+
+  free(g->node[a]);
+  free(g->active[a]);
+  free(g->f);
+  g->node[a]=node;
+  g->active[a]=active;
+  g->f=f;
+  g->numNodes[a]=ind;
+
+  free(cand);
+  free(u);
+  free(v);
+  free(fm);
+  free(err);
+  return bisected;
+}
+
+//samples the fit function for a plot, over the free variables var (numAxes
+//of them, 1 or 2) between lo and hi, with all other variables fixed at their
+//values in x
+//the sampled points are stored in col (indexed by variable #, with the fit
+//function value at index p->numVar), which is allocated here
+//blockSize is set to the number of points along the 1st free variable (the
+//length of each block of a surface)
+//returns the number of sampled points
+int sampleFitForPlot(const parameters * p, const fit_results * fr, const long double * x, int numAxes, const int * var, const double * lo, const double * hi, double * col[POWSIZE], int * blockSize)
+{
+  int i,j,k,a,n;
+  fit_sample_grid g;
+  int maxNodes=PLOT_FIT_MAX_POINTS;
+  int numInit=17;
+  if(numAxes>1)
+    {
+      maxNodes=(int)sqrt((double)PLOT_FIT_MAX_POINTS);
+      numInit=9;
+    }
+
+  //start from a coarse uniform grid
+  g.numAxes=numAxes;
+  for(a=0;a<2;a++)
+    {
+      g.var[a]=(a<numAxes) ? var[a] : var[0];
+      g.numNodes[a]=(a<numAxes) ? numInit : 1;
+      g.node[a]=(double*)malloc(g.numNodes[a]*sizeof(double));
+      g.active[a]=(int*)malloc(g.numNodes[a]*sizeof(int));
+      for(i=0;i<g.numNodes[a];i++)
+        {
+          g.node[a][i]=(a<numAxes) ? lo[a] + (hi[a] - lo[a])*i/(double)(numInit-1) : 0.;
+          g.active[a][i]=(i<g.numNodes[a]-1);
+        }
+    }
+  n=g.numNodes[0]*g.numNodes[1];
+  double *u=(double*)malloc(n*sizeof(double));
+  double *v=(double*)malloc(n*sizeof(double));
+  g.f=(double*)malloc(n*sizeof(double));
+  for(j=0;j<g.numNodes[1];j++)
+    for(i=0;i<g.numNodes[0];i++)
+      {
+        u[i + g.numNodes[0]*j]=g.node[0][i];
+        v[i + g.numNodes[0]*j]=g.node[1][j];
+      }
+  evalFitSampleBatch(p,fr,&g,x,u,v,n,g.f);
+  free(u);
+  free(v);
+
+  //refine the grid along each free variable in turn, until the fit function
+  //is well approximated everywhere or the budget is reached
+  int numBisected=1;
+  while(numBisected>0)
+    {
+      numBisected=0;
+      for(a=0;a<numAxes;a++)
+        numBisected+=refineFitSampleAxis(p,fr,&g,x,a,maxNodes);
+    }
+
+  //copy the sampled points
+  n=g.numNodes[0]*g.numNodes[1];
+  for(k=0;k<=p->numVar;k++)
+    if((col[k]=(double*)malloc(n*sizeof(double)))==NULL)
+      {
+        printf("ERROR: could not allocate memory for plot data.\n");
+        exit(-1);
+      }
+  for(j=0;j<g.numNodes[1];j++)
+    for(i=0;i<g.numNodes[0];i++)
+      {
+        for(k=0;k<p->numVar;k++)
+          col[k][i + g.numNodes[0]*j]=(double)x[k];
+        col[g.var[0]][i + g.numNodes[0]*j]=g.node[0][i];
+        if(numAxes>1)
+          col[g.var[1]][i + g.numNodes[0]*j]=g.node[1][j];
+        col[p->numVar][i + g.numNodes[0]*j]=g.f[i + g.numNodes[0]*j];
+      }
+  *blockSize=g.numNodes[0];
+
+  for(a=0;a<2;a++)
+    {
+      free(g.node[a]);
+      free(g.active[a]);
+    }
+  free(g.f);
+  return n;
+}
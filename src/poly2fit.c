@@ -1,6 +1,6 @@
 //forward declarations
+void evalFitAtData(const parameters *, const data *, const fit_results *, long double *);
 void generateSums(data *,const parameters *);
-void refitFilter1Par(const parameters *, const data *, fit_results *, plot_data *, long double);
 
 //evaluates the fit function at the specified point
 long double eval1Par(long double x, const fit_results * fr)
@@ -18,39 +18,21 @@ long double eval1ParX(long double y, const fit_results * fr, int pos)
     return (-1.*fr->a[1] + sqrt(fr->a[1]*fr->a[1] - 4.*fr->a[0]*(fr->a[2]-y)))/(2.*fr->a[0]);
 }
 
-//determine uncertainty bounds for the vertex by intersection of fit function with line defining values at min + delta
+//determine uncertainty bounds for the vertex from the region where the fit
+//function is within delta of its value at the vertex (see quad_ci.c)
 //delta is the desired confidence level (1.00 for 1-sigma in 1 parameter)
-//derived by: 
-//1) setting f(x,y)=delta+min
-//2) solving for x bounds using the quadratic formula (calculated below)
 void fit1ParChisqConf(const parameters * p, fit_results * fr)
 {
-  
-  long double a,b,c;
-  long double delta=p->ciDelta;
-  fr->vertBoundsFound[0]=1;
-  
-  a=fr->a[0];
-  b=fr->a[1];
-  c=fr->a[2] - delta - fr->vertVal;
-  if((b*b - 4*a*c)<0.) 
-    c=fr->a[2] + delta - fr->vertVal;//try flipping delta
-  if((b*b - 4*a*c)<0.)
-    fr->vertBoundsFound[0]=0;
-  else
-    {
-      fr->vertUBound[0]=(-1.*b + (long double)sqrt((double)(b*b - 4*a*c)))/(2*a);
-      fr->vertLBound[0]=(-1.*b - (long double)sqrt((double)(b*b - 4*a*c)))/(2*a);
-    }
-  
-  //swap bounds if needed
-  if(fr->vertLBound[0]>fr->vertUBound[0])
-    {
-      a=fr->vertUBound[0];
-      fr->vertUBound[0]=fr->vertLBound[0];
-      fr->vertLBound[0]=a;
-    }
-
+  quad_ci_type ci;
+  ci.dim=1;
+  ci.hess[0][0]=2.*fr->a[0];
+  ci.grad[0]=fr->a[1];
+  ci.c=fr->a[2];
+  ci.delta=p->ciDelta;
+  ci.useRefVal=1;
+  ci.refVal=fr->vertVal;
+  getQuadCI(&ci);
+  setQuadCIBounds(&ci,fr);
 }
 
 //prints fit data
@@ -137,12 +119,14 @@ void print1Par(const data * d, const parameters * p, const fit_results * fr)
   
   if((p->findMinGridPoint == 1)||(p->findMaxGridPoint == 1)){
     printf("\n");
+    long double *fitVal=(long double*)malloc(d->lines*sizeof(long double));
+    evalFitAtData(p,d,fr,fitVal); //see fit_eval_batch.c
     if(p->findMinGridPoint == 1){
       long double currentVal;
       long double minVal = BIG_NUMBER;
       int minPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = eval1Par(d->x[0][i],fr);
+        currentVal = fitVal[i];
         if(currentVal < minVal){
           minVal = currentVal;
           minPt = i;
@@ -157,7 +141,7 @@ void print1Par(const data * d, const parameters * p, const fit_results * fr)
       long double maxVal = -1.0*BIG_NUMBER;
       int maxPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = eval1Par(d->x[0][i],fr);
+        currentVal = fitVal[i];
         if(currentVal > maxVal){
           maxVal = currentVal;
           maxPt = i;
@@ -167,6 +151,7 @@ void print1Par(const data * d, const parameters * p, const fit_results * fr)
         printf("Grid point corresponding to the highest value (%LE) of the fitted function is at [ %0.3LE ].\n",maxVal,d->x[0][maxPt]);
       }
     }
+    free(fitVal);
   }
 
 }
@@ -186,7 +171,7 @@ void fit1Par(const parameters * p, const data * d, fit_results * fr, plot_data *
 {
 
   int numFitPar = 3;
-  fr->ndf=d->lines-numFitPar;
+  fr->ndf=getNumFitLines(d)-numFitPar; //see generate_sums.c
   if(fr->ndf < 0)
     {
       printf("\nERROR: not enough data points for a fit (NDF < 0) using the %s function.\n",p->fitType);
@@ -202,31 +187,13 @@ void fit1Par(const parameters * p, const data * d, fit_results * fr, plot_data *
         }
     }
 
-  //construct equations (n=1 specific case)
+  //construct equations from the moment table (see poly_basis.c)
   int i,j;
   lin_eq_type linEq;
-  linEq.dim=3;
-  
-  linEq.matrix[0][0]=d->xpowsum[0][4];
-  linEq.matrix[0][1]=d->xpowsum[0][3];
-  linEq.matrix[0][2]=d->xpowsum[0][2];
-  
-  linEq.matrix[1][1]=d->xpowsum[0][2];
-  linEq.matrix[1][2]=d->xpowsum[0][1];
-  
-  linEq.matrix[2][2]=d->xpowsum[0][0];//bottom right entry
-  
-  //mirror the matrix (top right half mirrored to bottom left half)
-  for(i=1;i<linEq.dim;i++)
-    for(j=0;j<i;j++)
-      linEq.matrix[i][j]=linEq.matrix[j][i];
-  
-  linEq.vector[0]=d->mxpowsum[0][2];
-  linEq.vector[1]=d->mxpowsum[0][1];
-  linEq.vector[2]=d->mxpowsum[0][0];
+  buildNormalEq(p,d,&linEq);
     
 	//solve system of equations and assign values
-	if(!(solve_lin_eq(&linEq)==1))
+	if(!(solveNormalEq(p,fr,&linEq)==1))
 		{
 			printf("ERROR: Could not determine fit parameters (par1).\n");
 			printf("Perhaps there are not enough data points to perform a fit?\n");
@@ -237,20 +204,9 @@ void fit1Par(const parameters * p, const data * d, fit_results * fr, plot_data *
   //save fit parameters  
   for(i=0;i<linEq.dim;i++)
     fr->a[i]=linEq.solution[i];
-  //refit filter  
-  if(p->refitFilter==1)
-    {
-      refitFilter1Par(p,d,fr,pd,p->refitFilterDist);
-      return;
-    }
-  long double f;
-  fr->chisq=0;
-  for(i=0;i<d->lines;i++)//loop over data points for chisq
-    {
-      f=fr->a[0]*d->x[0][i]*d->x[0][i] + fr->a[1]*d->x[0][i] + fr->a[2];
-      fr->chisq+=(d->x[1][i] - f)*(d->x[1][i] - f)
-                  /(d->x[1+1][i]*d->x[1+1][i]);
-    }
+  residual_stats_type rs;
+  getResiduals(p,d,fr,&rs,NULL); //see residuals.c
+  fr->chisq=rs.chisq;
   //Calculate covariances and uncertainties, see J. Wolberg 
   //'Data Analysis Using the Method of Least Squares' sec 2.5
   for(i=0;i<linEq.dim;i++)
@@ -273,48 +229,5 @@ void fit1Par(const parameters * p, const data * d, fit_results * fr, plot_data *
   if(print==1)
 		print1Par(d,p,fr);
 	
-	if((p->plotData==1)&&(p->verbose<1))
-		{
-			preparePlotData(d,p,fr,pd);
-			plotForm1Par(p,fr);
-			plotData(p,fr,pd);
-		}
   
 }
-
-//generate a new data set and refit
-void refitFilter1Par(const parameters * p, const data * d, fit_results * fr, plot_data * pd, long double distance){
-  int i,j;
-
-  //generate a new data set containing only filtered data
-  data *nd=(data*)calloc(1,sizeof(data));
-  parameters *np=(parameters*)calloc(1,sizeof(parameters));
-  memcpy(np,p,sizeof(parameters));
-  np->refitFilter=0;
-  nd->lines=0;
-
-  for (i=0;i<d->lines;i++){
-    long double diff = fabs(d->x[p->numVar][i] - eval1Par(d->x[0][i],fr));
-    if(diff<=distance){
-      //keep this data point (remember to copy weight as well)
-      for(j=0;j<=p->numVar+1;j++)
-        nd->x[j][nd->lines] = d->x[j][i];
-      nd->lines++;
-    }
-  }
-
-  nd->max_m=d->max_m;
-  nd->min_m=d->min_m;
-  for(i=0;i<p->numVar;i++)
-    nd->max_x[i]=d->max_x[i];
-
-  if(p->verbose<1)
-    printf("\nRefit filter: %i of %i data point(s) retained.\n",nd->lines,d->lines);
-  //printDataInfo(nd,np); //see print_data_info.c
-
-  generateSums(nd,np); //construct sums for fitting (see generate_sums.c)
-  fit1Par(np,nd,fr,pd,1);
-
-  free(nd);
-  free(np);
-}
@@ -1,6 +1,6 @@
 //forward declarations
+void evalFitAtData(const parameters *, const data *, const fit_results *, long double *);
 void generateSums(data *,const parameters *);
-void refitFilterPoly3(const parameters *, const data *, fit_results *, plot_data *, long double);
 
 //evaluates the fit function at the specified point
 long double evalPoly3(long double x, const fit_results * fr)
@@ -291,13 +291,15 @@ void printPoly3(const data * d, const parameters * p, const fit_results * fr)
 
   if((p->findMinGridPoint == 1)||(p->findMaxGridPoint == 1)){
     printf("\n");
+    long double *fitVal=(long double*)malloc(d->lines*sizeof(long double));
+    evalFitAtData(p,d,fr,fitVal); //see fit_eval_batch.c
 		int i;
     if(p->findMinGridPoint == 1){
       long double currentVal;
       long double minVal = BIG_NUMBER;
       int minPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = evalPoly3(d->x[0][i],fr);
+        currentVal = fitVal[i];
         if(currentVal < minVal){
           minVal = currentVal;
           minPt = i;
@@ -312,7 +314,7 @@ void printPoly3(const data * d, const parameters * p, const fit_results * fr)
       long double maxVal = -1.0*BIG_NUMBER;
       int maxPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = evalPoly3(d->x[0][i],fr);
+        currentVal = fitVal[i];
         if(currentVal > maxVal){
           maxVal = currentVal;
           maxPt = i;
@@ -322,6 +324,7 @@ void printPoly3(const data * d, const parameters * p, const fit_results * fr)
         printf("Grid point corresponding to the highest value (%LE) of the fitted function is at [ %0.3LE ].\n",maxVal,d->x[0][maxPt]);
       }
     }
+    free(fitVal);
   }
 }
 
@@ -342,7 +345,7 @@ void fitPoly3(const parameters * p, const data * d, fit_results * fr, plot_data
 {
 
   int numFitPar = 4;
-  fr->ndf=d->lines-numFitPar;
+  fr->ndf=getNumFitLines(d)-numFitPar; //see generate_sums.c
   if(fr->ndf < 0)
     {
       printf("\nERROR: not enough data points for a fit (NDF < 0) using the %s function.\n",p->fitType);
@@ -358,35 +361,11 @@ void fitPoly3(const parameters * p, const data * d, fit_results * fr, plot_data
         }
     }
 
-  //construct equations (n=1 specific case)
+  //construct equations from the moment table (see poly_basis.c)
   int i,j;
   lin_eq_type linEq;
-  linEq.dim=4;
-  
-  linEq.matrix[0][0]=d->xxpowsum[0][3][0][3];
-  linEq.matrix[0][1]=d->xxpowsum[0][3][0][2];
-  linEq.matrix[0][2]=d->xxpowsum[0][3][0][1];
-  linEq.matrix[0][3]=d->xpowsum[0][3];
-  
-  linEq.matrix[1][1]=d->xxpowsum[0][3][0][1];
-  linEq.matrix[1][2]=d->xpowsum[0][3];
-  linEq.matrix[1][3]=d->xpowsum[0][2];
-  
-  linEq.matrix[2][2]=d->xpowsum[0][2];
-  linEq.matrix[2][3]=d->xpowsum[0][1];
-  
-  linEq.matrix[3][3]=d->xpowsum[0][0];//bottom right entry
-  
-  //mirror the matrix (top right half mirrored to bottom left half)
-  for(i=1;i<linEq.dim;i++)
-    for(j=0;j<i;j++)
-      linEq.matrix[i][j]=linEq.matrix[j][i];
-  
-  linEq.vector[0]=d->mxpowsum[0][3];
-  linEq.vector[1]=d->mxpowsum[0][2];
-  linEq.vector[2]=d->mxpowsum[0][1];
-  linEq.vector[3]=d->mxpowsum[0][0];
-
+  buildNormalEq(p,d,&linEq);
+    
   /*printf("Matrix:\n");
   for(i=0;i<linEq.dim;i++)
     {
@@ -401,7 +380,7 @@ void fitPoly3(const parameters * p, const data * d, fit_results * fr, plot_data
     }*/
     
 	//solve system of equations and assign values
-	if(!(solve_lin_eq(&linEq)==1))
+	if(!(solveNormalEq(p,fr,&linEq)==1))
 		{
 			printf("ERROR: Could not determine fit parameters (poly3).\n");
 			printf("Perhaps there are not enough data points to perform a fit?\n");
@@ -412,20 +391,9 @@ void fitPoly3(const parameters * p, const data * d, fit_results * fr, plot_data
   //save fit parameters  
   for(i=0;i<linEq.dim;i++)
     fr->a[i]=linEq.solution[i];
-  //refit filter  
-  if(p->refitFilter==1)
-    {
-      refitFilterPoly3(p,d,fr,pd,p->refitFilterDist);
-      return;
-    }
-  long double f;
-  fr->chisq=0;
-  for(i=0;i<d->lines;i++)//loop over data points for chisq
-    {
-      f=fr->a[0]*d->x[0][i]*d->x[0][i]*d->x[0][i] + fr->a[1]*d->x[0][i]*d->x[0][i] + fr->a[2]*d->x[0][i] + fr->a[3];
-      fr->chisq+=(d->x[1][i] - f)*(d->x[1][i] - f)
-                  /(d->x[1+1][i]*d->x[1+1][i]);
-    }
+  residual_stats_type rs;
+  getResiduals(p,d,fr,&rs,NULL); //see residuals.c
+  fr->chisq=rs.chisq;
   //Calculate covariances and uncertainties, see J. Wolberg 
   //'Data Analysis Using the Method of Least Squares' sec 2.5
   for(i=0;i<linEq.dim;i++)
@@ -468,48 +436,5 @@ void fitPoly3(const parameters * p, const data * d, fit_results * fr, plot_data
   if(print==1)
 		printPoly3(d,p,fr);
 	
-	if((p->plotData==1)&&(p->verbose<1))
-		{
-			preparePlotData(d,p,fr,pd);
-			plotFormPoly3(p,fr);
-			plotData(p,fr,pd);
-		}
   
 }
-
-//generate a new data set and refit
-void refitFilterPoly3(const parameters * p, const data * d, fit_results * fr, plot_data * pd, long double distance){
-  int i,j;
-
-  //generate a new data set containing only filtered data
-  data *nd=(data*)calloc(1,sizeof(data));
-  parameters *np=(parameters*)calloc(1,sizeof(parameters));
-  memcpy(np,p,sizeof(parameters));
-  np->refitFilter=0;
-  nd->lines=0;
-
-  for (i=0;i<d->lines;i++){
-    long double diff = fabs(d->x[p->numVar][i] - evalPoly3(d->x[0][i],fr));
-    if(diff<=distance){
-      //keep this data point (remember to copy weight as well)
-      for(j=0;j<=p->numVar+1;j++)
-        nd->x[j][nd->lines] = d->x[j][i];
-      nd->lines++;
-    }
-  }
-
-  nd->max_m=d->max_m;
-  nd->min_m=d->min_m;
-  for(i=0;i<p->numVar;i++)
-    nd->max_x[i]=d->max_x[i];
-
-  if(p->verbose<1)
-    printf("\nRefit filter: %i of %i data point(s) retained.\n",nd->lines,d->lines);
-  //printDataInfo(nd,np); //see print_data_info.c
-
-  generateSums(nd,np); //construct sums for fitting (see generate_sums.c)
-  fitPoly3(np,nd,fr,pd,1);
-
-  free(nd);
-  free(np);
-}
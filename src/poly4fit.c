@@ -1,6 +1,6 @@
 //forward declarations
+void evalFitAtData(const parameters *, const data *, const fit_results *, long double *);
 void generateSums(data *,const parameters *);
-void refitFilterPoly4(const parameters *, const data *, fit_results *, plot_data *, long double);
 
 //evaluates the fit function at the specified point
 long double evalPoly4(long double x, const fit_results * fr)
@@ -9,56 +9,173 @@ long double evalPoly4(long double x, const fit_results * fr)
 					+ fr->a[2]*x*x + fr->a[3]*x + fr->a[4];
 }
 
-//evaluates fit function x values for the specified y value by iterative search
-//y: value to search for
-//closeToVal: where to start the search (in x)
-//dir: search direction, 1 for increasing x, 0 for decreasing x
-//resultVal: location to store the search result
-//returns 1 if the search successful, 0 if not (fit function diverges past distanceAbortThreshold)
-int evalPoly4XSearch(const data * d, const fit_results * fr, const long double y, const long double closeToVal, const int dir, long double * resultVal)
+//evaluates a polynomial and its derivative
+//c: coefficients, in order of decreasing power
+//deg: degree of the polynomial
+long double evalPolyDeriv(const long double * c, int deg, long double x, long double * deriv)
 {
+  int i;
+  long double val=c[0];
+  *deriv=0.;
+  for(i=1;i<=deg;i++)
+    {
+      *deriv=*deriv*x + val;
+      val=val*x + c[i];
+    }
+  return val;
+}
 
-  //define step size in terms of data range
-  long double stepSize = (d->max_x[0] - d->min_x[0])/10000.0;
-  long double distanceAbortThreshold = (d->max_m - d->min_m)*20.0;
-  long double distanceSolvedThreshold = (d->max_m - d->min_m)/10000000.0;
-  long double searchVal=closeToVal;
-  long double distance=evalPoly4(searchVal,fr)-y;
-  int initDistSign = signbit(distance)==0;
+//finds the x value in [lo,hi] at which the polynomial takes the value y,
+//assuming the polynomial is monotonic on the interval
+//uses Newton's method, falling back to bisection whenever a Newton step would
+//leave the bracketing interval, so that the number of iterations is bounded
+//returns 1 if the value is bracketed by the interval, 0 if not
+int getPolyRootBracketed(const long double * c, int deg, long double y, long double lo, long double hi, long double * root)
+{
+  int i;
+  long double deriv,x,fx,step;
+  long double flo=evalPolyDeriv(c,deg,lo,&deriv)-y;
+  long double fhi=evalPolyDeriv(c,deg,hi,&deriv)-y;
 
-  //printf("stepSize: %Lf, distanceSolvedThreshold: %Lf, distanceAbortThreshold: %Lfi\n",stepSize,distanceSolvedThreshold,distanceAbortThreshold);
+  if(flo==0.)
+    {
+      *root=lo;
+      return 1;
+    }
+  if(fhi==0.)
+    {
+      *root=hi;
+      return 1;
+    }
+  if((signbit(flo)==0)==(signbit(fhi)==0))
+    return 0;//no sign change
 
-  while((fabsl(distance))>distanceSolvedThreshold)
+  x=0.5*(lo+hi);
+  for(i=0;i<200;i++)
     {
-      if(dir==1)
-        searchVal+=stepSize;
+      fx=evalPolyDeriv(c,deg,x,&deriv)-y;
+      if(fx==0.)
+        break;
+      //shrink the bracket
+      if((signbit(fx)==0)==(signbit(flo)==0))
+        {
+          lo=x;
+          flo=fx;
+        }
       else
-        searchVal-=stepSize;
-      distance=evalPoly4(searchVal,fr)-y;
-      if(distance>distanceAbortThreshold)
-        return 0;
-      if((signbit(distance)==0)!=initDistSign)
+        hi=x;
+      if((hi-lo)<=1.0E-18*(fabsl(lo)+fabsl(hi)))
+        break;
+      //Newton step if it stays within the bracket, otherwise bisect
+      step=0.;
+      if(deriv!=0.)
+        step=fx/deriv;
+      if((deriv!=0.)&&((x-step)>lo)&&((x-step)<hi))
         {
-          //we have passed the point of interest!
-          //rewind back and decrease the step size
-          if(dir==1)
-            searchVal-=stepSize;
-          else
-            searchVal+=stepSize;
-          stepSize/=10.;
+          x-=step;
+          if(fabsl(step)<=1.0E-18*fabsl(x))
+            break;
         }
-      //printf("searchVal: %Lf, distance: %Lf, abs(distance): %Lf\n",searchVal, distance,fabsl(distance));
+      else
+        x=0.5*(lo+hi);
     }
 
-  memcpy(resultVal,&searchVal,sizeof(long double));
-  //printf("Returning search result: %Lf\n",searchVal);
+  *root=x;
   return 1;
+}
+
+//finds all real x values at which a polynomial of degree 4 or less takes
+//the value y, in increasing order
+//the polynomial is monotonic between the real roots of its derivative (found
+//recursively), so each solution is bracketed by a pair of those roots, or by
+//the Cauchy bound on the magnitude of the roots
+//c: coefficients, in order of decreasing power
+//roots: array to store the solutions in (length of at least deg)
+//returns the number of solutions found
+int getPolyRealRoots(const long double * c, int deg, long double y, long double * roots)
+{
+  int i,numRoots,numTurn;
+  long double cy[5],dc[4],turn[6],bound;
+
+  //remove vanishing leading coefficients
+  while((deg>0)&&(c[0]==0.))
+    {
+      c++;
+      deg--;
+    }
+  if(deg<1)
+    return 0;
+  for(i=0;i<=deg;i++)
+    cy[i]=c[i];
+  cy[deg]-=y;
+
+  if(deg==1)
+    {
+      roots[0]=-1.*cy[1]/cy[0];
+      return 1;
+    }
 
+  //Cauchy bound on the magnitude of the roots
+  bound=0.;
+  for(i=1;i<=deg;i++)
+    if(fabsl(cy[i]/cy[0])>bound)
+      bound=fabsl(cy[i]/cy[0]);
+  bound+=1.;
+
+  //turning points of the polynomial
+  for(i=0;i<deg;i++)
+    dc[i]=(deg-i)*cy[i];
+  turn[0]=-1.*bound;
+  numTurn=getPolyRealRoots(dc,deg-1,0.,turn+1);
+  turn[numTurn+1]=bound;
+
+  //search between each pair of turning points
+  numRoots=0;
+  for(i=0;i<=numTurn;i++)
+    if(getPolyRootBracketed(cy,deg,0.,turn[i],turn[i+1],&roots[numRoots])==1)
+      {
+        //don't double count solutions at turning points
+        if((numRoots>0)&&(roots[numRoots]==roots[numRoots-1]))
+          continue;
+        numRoots++;
+      }
+
+  return numRoots;
+}
+
+//finds the x value nearest to closeToVal (in the specified direction) at
+//which the fit function takes the value y
+//y: value to search for
+//closeToVal: where to start the search (in x)
+//dir: search direction, 1 for increasing x, 0 for decreasing x
+//resultVal: location to store the search result
+//returns 1 if successful, 0 if the fit function never reaches y in the search direction
+int getPoly4XBound(const fit_results * fr, const long double y, const long double closeToVal, const int dir, long double * resultVal)
+{
+  int i;
+  long double roots[4];
+  int numRoots=getPolyRealRoots(fr->a,4,y,roots);
+  int found=0;
+
+  for(i=0;i<numRoots;i++)
+    {
+      if((dir==1)&&(roots[i]>closeToVal)&&((found==0)||(roots[i]<*resultVal)))
+        {
+          *resultVal=roots[i];
+          found=1;
+        }
+      else if((dir==0)&&(roots[i]<closeToVal)&&((found==0)||(roots[i]>*resultVal)))
+        {
+          *resultVal=roots[i];
+          found=1;
+        }
+    }
+
+  return found;
 }
 
 
 //determine uncertainty bounds for the local minimum by intersection of fit function with line defining values at min + delta
-//done using iterative search
 //delta is the desired confidence level (1.00 for 1-sigma in 1 parameter)
 //min: 1 if the confidence interval is around a minimum, 0 if the confidence interval is around a maximum
 //ind: index in the confidence bound array to use
@@ -74,10 +191,10 @@ void fitPoly4ChisqConf(const parameters * p, const data * d, fit_results * fr, l
 
   if(min)
     {
-      if(evalPoly4XSearch(d, fr, vertVal+delta, pt, 1, &boundVal)==1)
+      if(getPoly4XBound(fr, vertVal+delta, pt, 1, &boundVal)==1)
         {
           memcpy(&fr->vertUBound[ind],&boundVal,sizeof(long double));
-          if(evalPoly4XSearch(d, fr, vertVal+delta, pt, 0, &boundVal)==1)
+          if(getPoly4XBound(fr, vertVal+delta, pt, 0, &boundVal)==1)
             {
               memcpy(&fr->vertLBound[ind],&boundVal,sizeof(long double));
               fr->vertBoundsFound[ind]=1;
@@ -86,10 +203,10 @@ void fitPoly4ChisqConf(const parameters * p, const data * d, fit_results * fr, l
     }
   else
     {
-      if(evalPoly4XSearch(d, fr, vertVal-delta, pt, 1, &boundVal)==1)
+      if(getPoly4XBound(fr, vertVal-delta, pt, 1, &boundVal)==1)
         {
           memcpy(&fr->vertUBound[ind],&boundVal,sizeof(long double));
-          if(evalPoly4XSearch(d, fr, vertVal-delta, pt, 0, &boundVal)==1)
+          if(getPoly4XBound(fr, vertVal-delta, pt, 0, &boundVal)==1)
             {
               memcpy(&fr->vertLBound[ind],&boundVal,sizeof(long double));
               fr->vertBoundsFound[ind]=1;
@@ -188,13 +305,15 @@ void printPoly4(const data * d, const parameters * p, const fit_results * fr)
   
   if((p->findMinGridPoint == 1)||(p->findMaxGridPoint == 1)){
     printf("\n");
+    long double *fitVal=(long double*)malloc(d->lines*sizeof(long double));
+    evalFitAtData(p,d,fr,fitVal); //see fit_eval_batch.c
 		int i;
     if(p->findMinGridPoint == 1){
       long double currentVal;
       long double minVal = BIG_NUMBER;
       int minPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = evalPoly4(d->x[0][i],fr);
+        currentVal = fitVal[i];
         if(currentVal < minVal){
           minVal = currentVal;
           minPt = i;
@@ -209,7 +328,7 @@ void printPoly4(const data * d, const parameters * p, const fit_results * fr)
       long double maxVal = -1.0*BIG_NUMBER;
       int maxPt = -1;
       for(i=0;i<d->lines;i++){
-        currentVal = evalPoly4(d->x[0][i],fr);
+        currentVal = fitVal[i];
         if(currentVal > maxVal){
           maxVal = currentVal;
           maxPt = i;
@@ -219,6 +338,7 @@ void printPoly4(const data * d, const parameters * p, const fit_results * fr)
         printf("Grid point corresponding to the highest value (%LE) of the fitted function is at [ %0.3LE ].\n",maxVal,d->x[0][maxPt]);
       }
     }
+    free(fitVal);
   }
 
 }
@@ -240,7 +360,7 @@ void fitPoly4(const parameters * p, const data * d, fit_results * fr, plot_data
 {
 
   int numFitPar = 5;
-  fr->ndf=d->lines-numFitPar;
+  fr->ndf=getNumFitLines(d)-numFitPar; //see generate_sums.c
   if(fr->ndf < 0)
     {
       printf("\nERROR: not enough data points for a fit (NDF < 0) using the %s function.\n",p->fitType);
@@ -256,44 +376,13 @@ void fitPoly4(const parameters * p, const data * d, fit_results * fr, plot_data
         }
     }
 
-  //construct equations (n=1 specific case)
+  //construct equations from the moment table (see poly_basis.c)
   int i,j;
   lin_eq_type linEq;
-  linEq.dim=5;
-  
-  linEq.matrix[0][0]=d->xxpowsum[0][4][0][4];
-  linEq.matrix[0][1]=d->xxpowsum[0][4][0][3];
-  linEq.matrix[0][2]=d->xxpowsum[0][4][0][2];
-  linEq.matrix[0][3]=d->xxpowsum[0][4][0][1];
-  linEq.matrix[0][4]=d->xpowsum[0][4];
-  
-  linEq.matrix[1][1]=d->xxpowsum[0][3][0][3];
-  linEq.matrix[1][2]=d->xxpowsum[0][3][0][2];
-  linEq.matrix[1][3]=d->xxpowsum[0][3][0][1];
-  linEq.matrix[1][4]=d->xpowsum[0][3];
-  
-  linEq.matrix[2][2]=d->xpowsum[0][4];
-  linEq.matrix[2][3]=d->xpowsum[0][3];
-  linEq.matrix[2][4]=d->xpowsum[0][2];
-
-  linEq.matrix[3][3]=d->xpowsum[0][2];
-  linEq.matrix[3][4]=d->xpowsum[0][1];
-  
-  linEq.matrix[4][4]=d->xpowsum[0][0];//bottom right entry
-  
-  //mirror the matrix (top right half mirrored to bottom left half)
-  for(i=1;i<linEq.dim;i++)
-    for(j=0;j<i;j++)
-      linEq.matrix[i][j]=linEq.matrix[j][i];
-  
-  linEq.vector[0]=d->mxpowsum[0][4];
-  linEq.vector[1]=d->mxpowsum[0][3];
-  linEq.vector[2]=d->mxpowsum[0][2];
-  linEq.vector[3]=d->mxpowsum[0][1];
-  linEq.vector[4]=d->mxpowsum[0][0];
+  buildNormalEq(p,d,&linEq);
     
 	//solve system of equations and assign values
-	if(!(solve_lin_eq(&linEq)==1))
+	if(!(solveNormalEq(p,fr,&linEq)==1))
 		{
 			printf("ERROR: Could not determine fit parameters (poly4).\n");
 			printf("Perhaps there are not enough data points to perform a fit?\n");
@@ -304,20 +393,9 @@ void fitPoly4(const parameters * p, const data * d, fit_results * fr, plot_data
   //save fit parameters  
   for(i=0;i<linEq.dim;i++)
     fr->a[i]=linEq.solution[i];
-  //refit filter  
-  if(p->refitFilter==1)
-    {
-      refitFilterPoly4(p,d,fr,pd,p->refitFilterDist);
-      return;
-    }
-  long double f;
-  fr->chisq=0;
-  for(i=0;i<d->lines;i++)//loop over data points for chisq
-    {
-      f=fr->a[0]*d->x[0][i]*d->x[0][i]*d->x[0][i]*d->x[0][i] + fr->a[1]*d->x[0][i]*d->x[0][i]*d->x[0][i] + fr->a[2]*d->x[0][i]*d->x[0][i] + fr->a[3]*d->x[0][i] + fr->a[4];
-      fr->chisq+=(d->x[1][i] - f)*(d->x[1][i] - f)
-                  /(d->x[1+1][i]*d->x[1+1][i]);
-    }
+  residual_stats_type rs;
+  getResiduals(p,d,fr,&rs,NULL); //see residuals.c
+  fr->chisq=rs.chisq;
   //Calculate covariances and uncertainties, see J. Wolberg 
   //'Data Analysis Using the Method of Least Squares' sec 2.5
   for(i=0;i<linEq.dim;i++)
@@ -326,19 +404,13 @@ void fitPoly4(const parameters * p, const data * d, fit_results * fr, plot_data
   for(i=0;i<linEq.dim;i++)
     fr->aerr[i]=(long double)sqrt((double)(fr->covar[i][i]));
 
-  //find minima/maxima of fit
-  //derivative of a quartic is a cubic, will use cubic functions (poly3fit.c)
-  fit_results *svarfr=(fit_results*)calloc(1,sizeof(fit_results));
-  svarfr->a[0]=4.0*fr->a[0];
-  svarfr->a[1]=3.0*fr->a[1];
-  svarfr->a[2]=2.0*fr->a[2];
-  svarfr->a[3]=fr->a[3];
-  //get cubic roots
-  long double *roots=(long double*)calloc(3,sizeof(long double));
-  fr->numFitVert=getPoly3Roots(0.0,svarfr,roots);
-  for(i=0;i<fr->numFitVert;i++)
-    fr->fitVert[i]=roots[i];
-  free(roots);
+  //find minima/maxima of fit (roots of the derivative)
+  long double dc[4];
+  dc[0]=4.0*fr->a[0];
+  dc[1]=3.0*fr->a[1];
+  dc[2]=2.0*fr->a[2];
+  dc[3]=fr->a[3];
+  fr->numFitVert=getPolyRealRoots(dc,3,0.,fr->fitVert);
 
   //sort the vertices
   int sorted = -1;
@@ -378,49 +450,5 @@ void fitPoly4(const parameters * p, const data * d, fit_results * fr, plot_data
   if(print==1)
 		printPoly4(d,p,fr);
 	
-	if((p->plotData==1)&&(p->verbose<1))
-		{
-			preparePlotData(d,p,fr,pd);
-			plotFormPoly4(p,fr);
-			plotData(p,fr,pd);
-		}
   
 }
-
-//generate a new data set and refit
-void refitFilterPoly4(const parameters * p, const data * d, fit_results * fr, plot_data * pd, long double distance){
-  int i,j;
-
-  //generate a new data set containing only filtered data
-  data *nd=(data*)calloc(1,sizeof(data));
-  parameters *np=(parameters*)calloc(1,sizeof(parameters));
-  memcpy(np,p,sizeof(parameters));
-  np->refitFilter=0;
-  nd->lines=0;
-
-  for (i=0;i<d->lines;i++){
-    long double diff = fabs(d->x[p->numVar][i] - evalPoly4(d->x[0][i],fr));
-    if(diff<=distance){
-      //keep this data point (remember to copy weight as well)
-      for(j=0;j<=p->numVar+1;j++)
-        nd->x[j][nd->lines] = d->x[j][i];
-      nd->lines++;
-    }
-  }
-
-  nd->max_m=d->max_m;
-  nd->min_m=d->min_m;
-  for(i=0;i<p->numVar;i++)
-    nd->max_x[i]=d->max_x[i];
-
-  if(p->verbose<1)
-    printf("\nRefit filter: %i of %i data point(s) retained.\n",nd->lines,d->lines);
-  //printDataInfo(nd,np); //see print_data_info.c
-
-  generateSums(nd,np); //construct sums for fitting (see generate_sums.c)
-  fitPoly4(np,nd,fr,pd,1);
-
-  free(nd);
-  free(np);
-}
-
@@ -0,0 +1,769 @@
+//the fit functions are linear in their coefficients, described by a basis
+//of terms (the terms multiplied by each fit coefficient)
+//the normal equations of the fit only depend on the sums over the data of
+//the products of pairs of terms, so these distinct products (moments) are
+//enumerated once for the basis, and their sums accumulated for the data in
+//a compact moment table (see generate_sums.c)
+//for polynomial fit types the terms are monomials, and products of terms
+//which give the same monomial share a moment
+//user-defined terms (FIT_TERMS option) may also contain functions of the
+//variables (eg. log(x)), in which case each product of terms is a moment
+//polynomial fits can also be performed in a basis of polynomials in mapped
+//variables (FIT_BASIS option), where each monomial term x^n*y^m is replaced
+//by P_n(x')*P_m(y'), with P either orthogonal (Chebyshev, Legendre) with each
+//variable mapped onto [-1,1], or a power with each variable centered on its
+//mean and scaled by its range, which keeps the normal equations well
+//conditioned for high degree fits or data far from the origin
+//the fit coefficients are then converted back to the monomial terms
+
+//term powers for the preset fit types, in the same order as the fit
+//coefficients (x,y,z powers)
+static const int linTerms[2][3]={{1,0,0},{0,0,0}};
+static const int poly2Terms[3][3]={{2,0,0},{1,0,0},{0,0,0}};
+static const int poly3Terms[4][3]={{3,0,0},{2,0,0},{1,0,0},{0,0,0}};
+static const int poly4Terms[5][3]={{4,0,0},{3,0,0},{2,0,0},{1,0,0},{0,0,0}};
+static const int par2Poly2Terms[6][3]={{2,0,0},{0,2,0},{1,1,0},{1,0,0},{0,1,0},{0,0,0}};
+static const int par2Poly3Terms[10][3]={{3,0,0},{0,3,0},{2,1,0},{1,2,0},{2,0,0},{0,2,0},{1,1,0},{1,0,0},{0,1,0},{0,0,0}};
+static const int par3Poly2Terms[10][3]={{2,0,0},{0,2,0},{0,0,2},{1,1,0},{1,0,1},{0,1,1},{1,0,0},{0,1,0},{0,0,1},{0,0,0}};
+
+//functions which may be used in user-defined terms
+#define NUM_TERM_FUNC 6
+static const char termFuncName[NUM_TERM_FUNC][8]={"log","exp","sqrt","sin","cos","abs"};
+
+//applies a function to an array of values, in place
+void applyTermFunc(int func, long double * val, int n)
+{
+  int i;
+  switch(func)
+    {
+      case 0:
+        for(i=0;i<n;i++)
+          val[i]=logl(val[i]);
+        break;
+      case 1:
+        for(i=0;i<n;i++)
+          val[i]=expl(val[i]);
+        break;
+      case 2:
+        for(i=0;i<n;i++)
+          val[i]=sqrtl(val[i]);
+        break;
+      case 3:
+        for(i=0;i<n;i++)
+          val[i]=sinl(val[i]);
+        break;
+      case 4:
+        for(i=0;i<n;i++)
+          val[i]=cosl(val[i]);
+        break;
+      case 5:
+        for(i=0;i<n;i++)
+          val[i]=fabsl(val[i]);
+        break;
+      default:
+        break;
+    }
+}
+
+//adds a term to the basis, returns 0 if there are too many terms
+int addPolyBasisTerm(poly_basis_type * b, const int * pow)
+{
+  int i;
+  if(b->numTerms>=MAX_DIM)
+    return 0;
+  for(i=0;i<POWSIZE;i++)
+    b->pow[b->numTerms][i]=0;
+  for(i=0;i<b->numVar;i++)
+    b->pow[b->numTerms][i]=pow[i];
+  b->numFunc[b->numTerms]=0;
+  b->numTerms++;
+  return 1;
+}
+
+//adds all terms with the specified total degree in the variables starting
+//from var, with the powers of the lower variables already set in pow
+//terms are ordered by decreasing power of the lowest variables first
+int addPolyBasisTermsOfDegree(poly_basis_type * b, int var, int deg, int * pow)
+{
+  int i;
+  if(var==b->numVar-1)
+    {
+      pow[var]=deg;
+      return addPolyBasisTerm(b,pow);
+    }
+  for(i=deg;i>=0;i--)
+    {
+      pow[var]=i;
+      if(addPolyBasisTermsOfDegree(b,var+1,deg-i,pow)==0)
+        return 0;
+    }
+  return 1;
+}
+
+//sets the basis to all terms in numVar variables up to the specified total
+//degree, in order of decreasing degree
+//returns 0 if there are too many terms
+int setPolyBasisOfDegree(poly_basis_type * b, int numVar, int degree)
+{
+  int i;
+  int pow[POWSIZE];
+  b->numVar=numVar;
+  b->degree=degree;
+  b->numTerms=0;
+  for(i=degree;i>=0;i--)
+    if(addPolyBasisTermsOfDegree(b,0,i,pow)==0)
+      return 0;
+  return 1;
+}
+
+//sets the basis to one of the preset term lists
+void setPolyBasisPreset(poly_basis_type * b, int numVar, int numTerms, const int pow[][3])
+{
+  int i;
+  b->numVar=numVar;
+  b->numTerms=0;
+  b->degree=0;
+  for(i=0;i<numTerms;i++)
+    {
+      addPolyBasisTerm(b,pow[i]);
+      if(pow[i][0]+pow[i][1]+pow[i][2] > b->degree)
+        b->degree=pow[i][0]+pow[i][1]+pow[i][2];
+    }
+}
+
+//reads a variable name (x,y,z or x1,x2,...) from a user-defined term,
+//advancing the string past it
+//returns the variable #, or -1 if there is no valid variable name
+int parseTermVar(const char ** str)
+{
+  char *end;
+  long n;
+  const char *s=*str;
+  if((s[0]=='x')&&(s[1]>='0')&&(s[1]<='9'))
+    {
+      n=strtol(s+1,&end,10);
+      if((n<1)||(n>POWSIZE-2))
+        return -1;
+      *str=end;
+      return (int)n-1;
+    }
+  else if((s[0]=='x')||(s[0]=='y')||(s[0]=='z'))
+    {
+      *str=s+1;
+      return s[0]-'x';
+    }
+  return -1;
+}
+
+//reads an optional power (eg. '^2') from a user-defined term, advancing the
+//string past it
+//returns the power (1 if none is specified), or 0 if the power is invalid
+int parseTermPow(const char ** str)
+{
+  char *end;
+  long n;
+  if(**str!='^')
+    return 1;
+  n=strtol(*str+1,&end,10);
+  if((end==*str+1)||(n<1))
+    return 0;
+  *str=end;
+  return (int)n;
+}
+
+//adds a user-defined term to the basis
+//terms are products of factors separated by '*', where each factor is a
+//variable (x,y,z or x1,x2,...) or a function of a variable (eg. log(x),
+//exp(-y), sin(2*x)), optionally raised to an integer power (eg. x^2), or
+//the term '1' for a constant
+//returns 0 if the term can't be read
+int parsePolyBasisTerm(poly_basis_type * b, const char * str)
+{
+  int i,var,pow,func,numFunc;
+  int termPow[POWSIZE];
+  long double scale;
+  char *end;
+  const char *s=str;
+  int term=b->numTerms;
+
+  if(term>=MAX_DIM)
+    return 0;
+  memset(termPow,0,sizeof(termPow));
+  numFunc=0;
+
+  if(strcmp(str,"1")!=0)
+    while(1)
+      {
+        //check for a function
+        func=-1;
+        for(i=0;i<NUM_TERM_FUNC;i++)
+          if((strncmp(s,termFuncName[i],strlen(termFuncName[i]))==0)&&(s[strlen(termFuncName[i])]=='('))
+            {
+              func=i;
+              s+=strlen(termFuncName[i])+1;
+              break;
+            }
+        if(func>=0)
+          {
+            //function argument, of the form [-][number*]variable
+            scale=1.;
+            if(*s=='-')
+              {
+                scale=-1.;
+                s++;
+              }
+            if(((*s>='0')&&(*s<='9'))||(*s=='.'))
+              {
+                scale*=strtold(s,&end);
+                s=end;
+                if(*s!='*')
+                  return 0;
+                s++;
+              }
+            if((var=parseTermVar(&s))<0)
+              return 0;
+            if(*s!=')')
+              return 0;
+            s++;
+            if((pow=parseTermPow(&s))==0)
+              return 0;
+            if(numFunc>=MAX_TERM_FUNC)
+              return 0;
+            b->func[term][numFunc]=func;
+            b->funcVar[term][numFunc]=var;
+            b->funcScale[term][numFunc]=scale;
+            b->funcPow[term][numFunc]=pow;
+            numFunc++;
+          }
+        else
+          {
+            if((var=parseTermVar(&s))<0)
+              return 0;
+            if((pow=parseTermPow(&s))==0)
+              return 0;
+            termPow[var]+=pow;
+          }
+        if(var+1>b->numVar)
+          b->numVar=var+1;
+        if(*s=='\0')
+          break;
+        if(*s!='*')
+          return 0;
+        s++;
+      }
+
+  for(i=0;i<POWSIZE;i++)
+    b->pow[term][i]=termPow[i];
+  b->numFunc[term]=numFunc;
+  if(numFunc>0)
+    b->monomial=0;
+  b->numTerms++;
+  return 1;
+}
+
+//sets the basis to the user-defined terms listed in a string (separated by
+//spaces), printing an error message if a term can't be read
+//returns 0 if the terms can't be read
+int parsePolyBasisTerms(poly_basis_type * b, const char * str)
+{
+  int i,j,deg;
+  char termStr[256];
+  char *tok;
+  strcpy(termStr,str);
+  b->numVar=0;
+  b->numTerms=0;
+  tok=strtok(termStr," \t\n");
+  while(tok!=NULL)
+    {
+      if(b->numTerms>=MAX_DIM)
+        {
+          printf("ERROR: too many fit terms specified (FIT_TERMS option), the maximum is %i.\n",MAX_DIM);
+          return 0;
+        }
+      if(parsePolyBasisTerm(b,tok)==0)
+        {
+          printf("ERROR: could not read fit term '%s' (FIT_TERMS option).\n",tok);
+          printf("Terms are products of variables (x,y,z or x1,x2,...) and functions of variables (");
+          for(i=0;i<NUM_TERM_FUNC;i++)
+            printf("%s%s",termFuncName[i],(i<NUM_TERM_FUNC-1) ? "," : "");
+          printf("), eg. x^2*y, log(x), exp(-0.5*y), or 1.\n");
+          return 0;
+        }
+      tok=strtok(NULL," \t\n");
+    }
+  if(b->numTerms==0)
+    {
+      printf("ERROR: no fit terms specified (FIT_TERMS option).\n");
+      return 0;
+    }
+
+  //get the degree, if the terms are all monomials
+  b->degree=-1;
+  if(b->monomial==1)
+    for(i=0;i<b->numTerms;i++)
+      {
+        deg=0;
+        for(j=0;j<b->numVar;j++)
+          deg+=b->pow[i][j];
+        if(deg>b->degree)
+          b->degree=deg;
+      }
+  return 1;
+}
+
+//gets the index of a monomial in the moment table, adding it if it is not
+//already present
+int getPolyBasisMoment(poly_basis_type * b, const int * pow)
+{
+  int i,j;
+  for(i=0;i<b->numMoments;i++)
+    {
+      for(j=0;j<b->numVar;j++)
+        if(b->momentPow[i][j]!=pow[j])
+          break;
+      if(j==b->numVar)
+        return i;
+    }
+  for(j=0;j<POWSIZE;j++)
+    b->momentPow[b->numMoments][j]=0;
+  for(j=0;j<b->numVar;j++)
+    {
+      b->momentPow[b->numMoments][j]=pow[j];
+      if(pow[j]>b->maxPow)
+        b->maxPow=pow[j];
+    }
+  b->numMoments++;
+  return b->numMoments-1;
+}
+
+//enumerates the moments needed to construct the normal equations for the basis
+//the terms themselves are stored first, as the data value is only summed
+//against these
+void setPolyBasisMoments(poly_basis_type * b)
+{
+  int i,j,k;
+  int pow[POWSIZE];
+  b->numMoments=0;
+  b->maxPow=0;
+  b->pairMoments=0;
+  if((b->monomial==0)||(b->mapBasis>0))
+    {
+      b->pairMoments=1;
+      //each term and product of terms is a separate moment
+      for(i=0;i<b->numTerms;i++)
+        {
+          b->momentTerm[b->numMoments][0]=i;
+          b->momentTerm[b->numMoments][1]=-1;
+          b->termMoment[i]=b->numMoments++;
+        }
+      b->numTermMoments=b->numMoments;
+      for(i=0;i<b->numTerms;i++)
+        for(j=i;j<b->numTerms;j++)
+          {
+            b->momentTerm[b->numMoments][0]=i;
+            b->momentTerm[b->numMoments][1]=j;
+            b->pairMoment[i][j]=b->numMoments;
+            b->pairMoment[j][i]=b->numMoments++;
+          }
+      return;
+    }
+  for(i=0;i<b->numTerms;i++)
+    b->termMoment[i]=getPolyBasisMoment(b,b->pow[i]);
+  b->numTermMoments=b->numMoments;
+  for(i=0;i<b->numTerms;i++)
+    for(j=i;j<b->numTerms;j++)
+      {
+        for(k=0;k<b->numVar;k++)
+          pow[k]=b->pow[i][k]+b->pow[j][k];
+        b->pairMoment[i][j]=getPolyBasisMoment(b,pow);
+        b->pairMoment[j][i]=b->pairMoment[i][j];
+      }
+}
+
+//checks whether every monomial dividing a term is also a term, in which case
+//the terms in mapped variables span the same functions as the monomial terms
+//returns 1 if so, 0 if not
+int isPolyBasisClosed(const poly_basis_type * b)
+{
+  int i,j,k,l;
+  for(i=0;i<b->numTerms;i++)
+    for(j=0;j<b->numVar;j++)
+      if(b->pow[i][j]>0)
+        {
+          for(k=0;k<b->numTerms;k++)
+            {
+              for(l=0;l<b->numVar;l++)
+                if(b->pow[k][l]!=b->pow[i][l]-((l==j) ? 1 : 0))
+                  break;
+              if(l==b->numVar)
+                break;
+            }
+          if(k==b->numTerms)
+            return 0;
+        }
+  return 1;
+}
+
+//sets up the basis for the fit type
+//preset fit types use their own term order, fit types of the form
+//NparpolyD use all terms in N variables up to total degree D, and the
+//'terms' fit type uses the user-defined terms (FIT_TERMS option)
+//returns 0 if the fit type does not have a valid basis
+int setPolyBasis(parameters * p)
+{
+  int numVar,degree;
+  char c;
+  poly_basis_type * b=&p->basis;
+  memset(b,0,sizeof(poly_basis_type));
+  b->monomial=1;
+
+  if(strcmp(p->fitType,"terms")==0)
+    {
+      if(parsePolyBasisTerms(b,p->fitTerms)==0)
+        return 0;
+    }
+  else if(p->model->terms!=NULL)//preset fit types (see fit_models.c)
+    setPolyBasisPreset(b,p->model->numVar,p->model->numCoeff,p->model->terms);
+  else if(sscanf(p->fitType,"%dparpoly%d%c",&numVar,&degree,&c)==2)
+    {
+      if((numVar<1)||(numVar>POWSIZE-2)||(degree<1))
+        return 0;
+      if(setPolyBasisOfDegree(b,numVar,degree)==0)
+        return 0;
+    }
+  else
+    return 0;
+
+  //use polynomials in mapped variables, if requested
+  if(p->fitBasis>0)
+    {
+      if(p->model->linearCoeff==0)
+        {
+          printf("ERROR: the FIT_BASIS option can't be used with the %s fit type.\n",p->fitType);
+          exit(-1);
+        }
+      if((b->monomial==0)||(isPolyBasisClosed(b)==0))
+        {
+          printf("ERROR: the FIT_BASIS option can't be used with the specified fit function.\n");
+          printf("The fit function must be a polynomial where every lower order term dividing a term is also included.\n");
+          exit(-1);
+        }
+      b->mapBasis=p->fitBasis;
+    }
+
+  setPolyBasisMoments(b);
+  return 1;
+}
+
+//gets the coefficients (in the original variable) of the polynomials in the
+//mapped variable t = (x - center)/scale, up to the specified degree
+//mapBasis: 1=Chebyshev, 2=Legendre, 3=powers of t
+//coeff: array to store the coefficients in, indexed by the degree of the
+//mapped polynomial then the power of the variable
+void getMappedPolyCoeffs(int mapBasis, int degree, long double center, long double scale, long double coeff[MAX_DIM][MAX_DIM])
+{
+  int i,j;
+  long double t[MAX_DIM];//mapped variable times the previous polynomial
+  memset(coeff,0,MAX_DIM*sizeof(coeff[0]));
+  coeff[0][0]=1.;
+  for(i=1;i<=degree;i++)
+    {
+      //multiply the previous polynomial by the mapped variable
+      for(j=0;j<=i;j++)
+        {
+          t[j]=-1.*center*coeff[i-1][j];
+          if(j>0)
+            t[j]+=coeff[i-1][j-1];
+          t[j]/=scale;
+        }
+      for(j=0;j<=i;j++)
+        {
+          if((i==1)||(mapBasis==3))
+            coeff[i][j]=t[j];
+          else if(mapBasis==1)//Chebyshev: T_i = 2*t*T_(i-1) - T_(i-2)
+            coeff[i][j]=2.*t[j] - coeff[i-2][j];
+          else//Legendre: i*P_i = (2i-1)*t*P_(i-1) - (i-1)*P_(i-2)
+            coeff[i][j]=((2.*i-1.)*t[j] - (i-1.)*coeff[i-2][j])/i;
+        }
+    }
+}
+
+//maps each variable in the data for the terms of the basis (onto [-1,1] for
+//orthogonal polynomials, or centered on the mean and scaled by the range),
+//and sets up the conversion of the fit coefficients from the mapped terms to
+//the monomial terms
+void setPolyBasisRange(poly_basis_type * b, const data * d)
+{
+  int i,j,k;
+  long double coeff[MAX_DIM][MAX_DIM];
+  for(i=0;i<b->numTerms;i++)
+    for(j=0;j<b->numTerms;j++)
+      b->toMonomial[i][j]=1.;
+  for(k=0;k<b->numVar;k++)
+    {
+      b->varCenter[k]=0.5*(d->max_x[k]+d->min_x[k]);
+      if((b->mapBasis==3)&&(d->lines>0))
+        {
+          b->varCenter[k]=0.;
+          for(i=0;i<d->lines;i++)
+            b->varCenter[k]+=d->x[k][i];
+          b->varCenter[k]/=d->lines;
+        }
+      b->varScale[k]=0.5*(d->max_x[k]-d->min_x[k]);
+      if(b->varScale[k]<=0.)
+        b->varScale[k]=1.;
+      getMappedPolyCoeffs(b->mapBasis,b->degree,b->varCenter[k],b->varScale[k],coeff);
+      //the monomial term i appears in the mapped term j with the product
+      //over variables of the coefficients of each power
+      for(i=0;i<b->numTerms;i++)
+        for(j=0;j<b->numTerms;j++)
+          b->toMonomial[i][j]*=coeff[b->pow[j][k]][b->pow[i][k]];
+    }
+}
+
+//gets the values of the basis terms at the specified point
+//x: array of variable values at the point (indexed by variable #)
+//basis: array to store the term values in (length of at least MAX_DIM)
+//returns the number of terms
+int evalPolyBasis(const poly_basis_type * b, const long double * x, long double * basis)
+{
+  int i,j,k;
+  long double val;
+  for(i=0;i<b->numTerms;i++)
+    {
+      basis[i]=1.;
+      for(j=0;j<b->numVar;j++)
+        for(k=0;k<b->pow[i][j];k++)
+          basis[i]*=x[j];
+      for(j=0;j<b->numFunc[i];j++)
+        {
+          val=b->funcScale[i][j]*x[b->funcVar[i][j]];
+          applyTermFunc(b->func[i][j],&val,1);
+          for(k=0;k<b->funcPow[i][j];k++)
+            basis[i]*=val;
+        }
+    }
+  return b->numTerms;
+}
+
+//gets the values of the basis terms for a batch of consecutive data points,
+//evaluating each term (column of the design matrix) over all of the points
+//at once
+//for a basis in mapped variables (FIT_BASIS option), these are the mapped
+//terms used when generating sums (rather than the monomial terms)
+//start: index of the first data point
+//n: number of data points (at most SUMS_BATCH_SIZE)
+//col: array to store the term values in, indexed by term # then point #
+void evalPolyBasisBatch(const poly_basis_type * b, const data * d, int start, int n, long double col[][SUMS_BATCH_SIZE])
+{
+  int i,j,k,l;
+  long double val[SUMS_BATCH_SIZE];
+  if(b->mapBasis>0)
+    {
+      //terms in the mapped variables, from the recurrence relations of the polynomials
+      long double t[SUMS_BATCH_SIZE],prev[SUMS_BATCH_SIZE],next;
+      for(i=0;i<b->numTerms;i++)
+        {
+          for(l=0;l<n;l++)
+            col[i][l]=1.;
+          for(j=0;j<b->numVar;j++)
+            if(b->pow[i][j]>0)
+              {
+                for(l=0;l<n;l++)
+                  {
+                    t[l]=(d->x[j][start+l] - b->varCenter[j])/b->varScale[j];
+                    prev[l]=1.;
+                    val[l]=t[l];
+                  }
+                for(k=1;k<b->pow[i][j];k++)
+                  for(l=0;l<n;l++)
+                    {
+                      if(b->mapBasis==3)
+                        next=t[l]*val[l];
+                      else if(b->mapBasis==1)
+                        next=2.*t[l]*val[l] - prev[l];
+                      else
+                        next=((2.*k+1.)*t[l]*val[l] - k*prev[l])/(k+1.);
+                      prev[l]=val[l];
+                      val[l]=next;
+                    }
+                for(l=0;l<n;l++)
+                  col[i][l]*=val[l];
+              }
+        }
+      return;
+    }
+  for(i=0;i<b->numTerms;i++)
+    {
+      for(l=0;l<n;l++)
+        col[i][l]=1.;
+      for(j=0;j<b->numVar;j++)
+        for(k=0;k<b->pow[i][j];k++)
+          for(l=0;l<n;l++)
+            col[i][l]*=d->x[j][start+l];
+      for(j=0;j<b->numFunc[i];j++)
+        {
+          for(l=0;l<n;l++)
+            val[l]=b->funcScale[i][j]*d->x[b->funcVar[i][j]][start+l];
+          applyTermFunc(b->func[i][j],val,n);
+          for(k=0;k<b->funcPow[i][j];k++)
+            for(l=0;l<n;l++)
+              col[i][l]*=val[l];
+        }
+    }
+}
+
+//gets the values of the basis terms at a single data point, as used when
+//generating sums (the mapped terms for the FIT_BASIS option, as in
+//evalPolyBasisBatch)
+//ind: index of the data point
+//basis: array to store the term values in (length of at least MAX_DIM)
+//returns the number of terms
+int evalPolyBasisAtData(const poly_basis_type * b, const data * d, int ind, long double * basis)
+{
+  int i,j,k;
+  long double x[POWSIZE],t,prev,val,next;
+  if(b->mapBasis<=0)
+    {
+      for(j=0;j<b->numVar;j++)
+        x[j]=d->x[j][ind];
+      return evalPolyBasis(b,x,basis);
+    }
+  for(i=0;i<b->numTerms;i++)
+    {
+      basis[i]=1.;
+      for(j=0;j<b->numVar;j++)
+        if(b->pow[i][j]>0)
+          {
+            t=(d->x[j][ind] - b->varCenter[j])/b->varScale[j];
+            prev=1.;
+            val=t;
+            for(k=1;k<b->pow[i][j];k++)
+              {
+                if(b->mapBasis==3)
+                  next=t*val;
+                else if(b->mapBasis==1)
+                  next=2.*t*val - prev;
+                else
+                  next=((2.*k+1.)*t*val - k*prev)/(k+1.);
+                prev=val;
+                val=next;
+              }
+            basis[i]*=val;
+          }
+    }
+  return b->numTerms;
+}
+
+//writes a description of a term (eg. 'x^2*y', 'log(x)') to str
+//variables are named x,y,z if there are 3 or less, otherwise x1,x2,...
+void sprintPolyBasisTerm(const poly_basis_type * b, int term, char * str)
+{
+  int i;
+  const char varName[3][2]={"x","y","z"};
+  char varStr[32];
+  strcpy(str,"");
+  for(i=0;i<b->numVar;i++)
+    if(b->pow[term][i]>0)
+      {
+        if(b->numVar<=3)
+          strcpy(varStr,varName[i]);
+        else
+          sprintf(varStr,"x%i",i+1);
+        if(strcmp(str,"")!=0)
+          strcat(str,"*");
+        strcat(str,varStr);
+        if(b->pow[term][i]>1)
+          {
+            sprintf(varStr,"^%i",b->pow[term][i]);
+            strcat(str,varStr);
+          }
+      }
+  for(i=0;i<b->numFunc[term];i++)
+    {
+      if(strcmp(str,"")!=0)
+        strcat(str,"*");
+      strcat(str,termFuncName[b->func[term][i]]);
+      strcat(str,"(");
+      if(b->funcScale[term][i]==-1.)
+        strcat(str,"-");
+      else if(b->funcScale[term][i]!=1.)
+        {
+          sprintf(varStr,"%Lg*",b->funcScale[term][i]);
+          strcat(str,varStr);
+        }
+      if(b->numVar<=3)
+        strcat(str,varName[b->funcVar[term][i]]);
+      else
+        {
+          sprintf(varStr,"x%i",b->funcVar[term][i]+1);
+          strcat(str,varStr);
+        }
+      strcat(str,")");
+      if(b->funcPow[term][i]>1)
+        {
+          sprintf(varStr,"^%i",b->funcPow[term][i]);
+          strcat(str,varStr);
+        }
+    }
+}
+
+//constructs the normal equations for the least squares fit from the moment table
+void buildNormalEq(const parameters * p, const data * d, lin_eq_type * linEq)
+{
+  int i,j;
+  linEq->dim=p->basis.numTerms;
+  for(i=0;i<linEq->dim;i++)
+    {
+      for(j=0;j<linEq->dim;j++)
+        linEq->matrix[i][j]=d->moment[p->basis.pairMoment[i][j]];
+      linEq->vector[i]=d->mMoment[p->basis.termMoment[i]];
+    }
+}
+
+//solves the normal equations for the fit, converting the solution and
+//inverse matrix back to the monomial terms if a basis in mapped variables
+//is used (the covariance of the monomial coefficients is T*C*T^T, for the
+//conversion matrix T and covariance C of the mapped coefficients)
+//unless full precision is requested (FULL_PRECISION option), the equations
+//are solved in mixed precision (see lin_eq_solver.c), and the achieved
+//residual saved in the fit results along with the condition number
+//returns 1 if successful, 0 if the equations could not be solved
+int solveNormalEq(const parameters * p, fit_results * fr, lin_eq_type * linEq)
+{
+  int i,j,k;
+  long double tmp[MAX_DIM][MAX_DIM];
+  const poly_basis_type * b=&p->basis;
+  if(p->fullPrecision==0)
+    {
+      if(!(solve_lin_eq_mixed(linEq)==1))
+        return 0;
+      fr->solveResidual=linEq->residual;
+      fr->solveRefineIter=linEq->refine_iter;
+    }
+  else if(!(solve_lin_eq(linEq)==1))
+    return 0;
+  fr->solveCond=get_cond(linEq);
+  if(b->mapBasis==0)
+    return 1;
+  memcpy(tmp,linEq->solution,sizeof(linEq->solution));
+  for(i=0;i<linEq->dim;i++)
+    {
+      linEq->solution[i]=0.;
+      for(j=0;j<linEq->dim;j++)
+        linEq->solution[i]+=b->toMonomial[i][j]*tmp[0][j];
+    }
+  memset(tmp,0,sizeof(tmp));
+  for(i=0;i<linEq->dim;i++)
+    for(j=0;j<linEq->dim;j++)
+      for(k=0;k<linEq->dim;k++)
+        tmp[i][j]+=b->toMonomial[i][k]*linEq->inv_matrix[k][j];
+  for(i=0;i<linEq->dim;i++)
+    for(j=0;j<linEq->dim;j++)
+      {
+        linEq->inv_matrix[i][j]=0.;
+        for(k=0;k<linEq->dim;k++)
+          linEq->inv_matrix[i][j]+=tmp[i][k]*b->toMonomial[j][k];
+      }
+  return 1;
+}
@@ -6,6 +6,8 @@ void printDataInfo(const data * d, const parameters * p)
   long double maxVal[NUM_LIST],minVal[NUM_LIST];
   for(i=0;i<NUM_LIST;i++)
     {
+      maxInd[i]=-1;//no data point recorded yet
+      minInd[i]=-1;
       maxVal[i]=0.;
       minVal[i]=BIG_NUMBER;
     }
@@ -40,12 +42,15 @@ void printDataInfo(const data * d, const parameters * p)
             break;
           }
     }
-  printf("\nData minimum value(s): %0.3LE at [",d->x[p->numVar][minInd[0]]);
-  for(i=0;i<p->numVar;i++)
-    printf(" %0.3LE ",d->x[i][minInd[0]]);
-  printf("]\n");
+  if(minInd[0]>=0)
+    {
+      printf("\nData minimum value(s): %0.3LE at [",d->x[p->numVar][minInd[0]]);
+      for(i=0;i<p->numVar;i++)
+        printf(" %0.3LE ",d->x[i][minInd[0]]);
+      printf("]\n");
+    }
   for(i=1;i<numMin;i++)
-    if(i<NUM_LIST)
+    if((i<NUM_LIST)&&(minInd[i]>=0))
       {
         printf("                       %0.3LE at [",d->x[p->numVar][minInd[i]]);
         for(j=0;j<p->numVar;j++)
@@ -53,12 +58,15 @@ void printDataInfo(const data * d, const parameters * p)
         printf("]\n");
       }
 
-  printf("\nData maximum value(s): %0.3LE at [",d->x[p->numVar][maxInd[0]]);
-  for(i=0;i<p->numVar;i++)
-    printf(" %0.3LE ",d->x[i][maxInd[0]]);
-  printf("]\n");
+  if(maxInd[0]>=0)
+    {
+      printf("\nData maximum value(s): %0.3LE at [",d->x[p->numVar][maxInd[0]]);
+      for(i=0;i<p->numVar;i++)
+        printf(" %0.3LE ",d->x[i][maxInd[0]]);
+      printf("]\n");
+    }
   for(i=1;i<numMax;i++)
-    if(i<NUM_LIST)
+    if((i<NUM_LIST)&&(maxInd[i]>=0))
       {
         printf("                       %0.3LE at [",d->x[p->numVar][maxInd[i]]);
         for(j=0;j<p->numVar;j++)
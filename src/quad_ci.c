@@ -0,0 +1,129 @@
+//determines the confidence region of a quadratic model in any number of 
+//variables, the ellipsoid where the model differs from its value at the 
+//vertex (or the reference value, if specified) by delta
+//with the Hessian decomposed as H = V*L*V^T, the ellipsoid has principal axes
+//along the eigenvectors V, with semi-axis lengths sqrt(2*m/|L|), and its
+//projection onto variable i has half-width sqrt(2*m*|H^-1|_ii), where m is 
+//the difference between the model value on the ellipsoid and at the vertex
+//returns 1 if the confidence region is bounded (minimum or maximum), 0 if not
+int getQuadCI(quad_ci_type * ci)
+{
+  int i,k;
+  long double s,m;
+
+  ci->type=0;
+  memset(ci->halfWidth,0,sizeof(ci->halfWidth));
+  memset(ci->axisLength,0,sizeof(ci->axisLength));
+
+  lin_eq_type linEq;
+  linEq.dim=ci->dim;
+  memcpy(linEq.matrix,ci->hess,sizeof(linEq.matrix));
+  for(i=0;i<ci->dim;i++)
+    linEq.vector[i]=-1.*ci->grad[i];
+
+  //find the vertex (where the gradient is zero)
+  if(!(solve_lin_eq(&linEq)==1))
+    return 0;
+  ci->vertVal=ci->c;
+  for(i=0;i<ci->dim;i++)
+    {
+      ci->vert[i]=linEq.solution[i];
+      ci->vertVal+=0.5*ci->grad[i]*ci->vert[i];
+    }
+
+  //get principal axes
+  if(!(get_sym_eigen(&linEq,ci->eigVal,ci->eigVec)==1))
+    return 0;
+  ci->type=1;
+  if(ci->eigVal[0]<0.)
+    ci->type=-1;
+  for(k=0;k<ci->dim;k++)
+    if((ci->eigVal[k]==0.)||((ci->eigVal[k]<0.)!=(ci->type<0)))
+      {
+        ci->type=0;//saddle point or degenerate, confidence region is unbounded
+        return 0;
+      }
+
+  //difference in value between the vertex and the boundary of the region
+  m=ci->delta;
+  if(ci->useRefVal==1)
+    m+=ci->type*(ci->refVal - ci->vertVal);
+  if(m<=0.)
+    {
+      ci->type=0;//reference value + delta doesn't reach the vertex
+      return 0;
+    }
+
+  for(k=0;k<ci->dim;k++)
+    ci->axisLength[k]=sqrtl(2.*m/fabsl(ci->eigVal[k]));
+  for(i=0;i<ci->dim;i++)
+    {
+      s=0.;
+      for(k=0;k<ci->dim;k++)
+        s+=ci->eigVec[i][k]*ci->eigVec[i][k]/fabsl(ci->eigVal[k]);
+      ci->halfWidth[i]=sqrtl(2.*m*s);
+    }
+
+  return 1;
+}
+
+//gets a point on the boundary of the confidence region
+//dir: unit vector giving the direction of the point from the vertex, 
+//in the frame of the principal axes
+//pt: location to store the point (in the original variables)
+void getQuadCIContourPoint(const quad_ci_type * ci, const long double * dir, long double * pt)
+{
+  int i,k;
+  for(i=0;i<ci->dim;i++)
+    {
+      pt[i]=ci->vert[i];
+      for(k=0;k<ci->dim;k++)
+        pt[i]+=ci->eigVec[i][k]*ci->axisLength[k]*dir[k];
+    }
+}
+
+//gets points around the boundary of the confidence region of a 2 variable
+//quadratic model, for plotting
+//contour: arrays to store the x, y, and model values of the points in (the
+//last point repeats the first, closing the contour)
+//returns the number of points (0 if the region is not bounded)
+int getQuadCIContour2D(const quad_ci_type * ci, double contour[3][CI_DIM])
+{
+  int i,j,k;
+  long double dir[2],pt[2],val;
+  if((ci->dim!=2)||(ci->type==0))
+    return 0;
+  for(j=0;j<CI_DIM;j++)
+    {
+      dir[0]=cosl(2.*PI*j/(CI_DIM-1.));
+      dir[1]=sinl(2.*PI*j/(CI_DIM-1.));
+      getQuadCIContourPoint(ci,dir,pt);
+      val=ci->c;
+      for(i=0;i<2;i++)
+        {
+          val+=ci->grad[i]*pt[i];
+          for(k=0;k<2;k++)
+            val+=0.5*pt[i]*ci->hess[i][k]*pt[k];
+        }
+      contour[0][j]=(double)pt[0];
+      contour[1][j]=(double)pt[1];
+      contour[2][j]=(double)val;
+    }
+  return CI_DIM;
+}
+
+//saves the confidence bounds on each variable of the quadratic model to the fit results
+void setQuadCIBounds(const quad_ci_type * ci, fit_results * fr)
+{
+  int i;
+  for(i=0;i<ci->dim;i++)
+    {
+      fr->vertBoundsFound[i]=0;
+      if(ci->type!=0)
+        {
+          fr->vertLBound[i]=ci->vert[i] - ci->halfWidth[i];
+          fr->vertUBound[i]=ci->vert[i] + ci->halfWidth[i];
+          fr->vertBoundsFound[i]=1;
+        }
+    }
+}
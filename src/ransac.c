@@ -0,0 +1,250 @@
+//seed for the RANSAC random number streams
+#define RANSAC_SEED 0x2545F4914F6CDD1DULL
+
+//random number generator used for RANSAC (splitmix64)
+//each hypothesis draws from its own stream (seeded from the hypothesis
+//number), so that results are reproducible and independent of the order in
+//which hypotheses are evaluated
+unsigned long long ransacRand(unsigned long long * state)
+{
+  unsigned long long z=(*state+=0x9E3779B97F4A7C15ULL);
+  z=(z^(z>>30))*0xBF58476D1CE4E5B9ULL;
+  z=(z^(z>>27))*0x94D049BB133111EBULL;
+  return z^(z>>31);
+}
+
+//gets the coefficients of the model passing through a minimal subset of
+//data points (2 points for a line, 3 for a parabola)
+//returns 0 if the subset is degenerate (repeated x values)
+int ransacModel(const parameters * p, const data * d, const int * ind, long double * a)
+{
+  long double x1,x2,x3,y1,y2,y3,s12,s13;
+  x1=d->x[0][ind[0]];
+  x2=d->x[0][ind[1]];
+  y1=d->x[1][ind[0]];
+  y2=d->x[1][ind[1]];
+  if(x1==x2)
+    return 0;
+  if(p->model->numCoeff==3)
+    {
+      x3=d->x[0][ind[2]];
+      y3=d->x[1][ind[2]];
+      if((x1==x3)||(x2==x3))
+        return 0;
+      s12=(y2-y1)/(x2-x1);
+      s13=(y3-y1)/(x3-x1);
+      a[0]=(s13-s12)/(x3-x2);
+      a[1]=s12 - a[0]*(x1+x2);
+      a[2]=y1 - a[0]*x1*x1 - a[1]*x1;
+    }
+  else
+    {
+      a[0]=(y2-y1)/(x2-x1);
+      a[1]=y1 - a[0]*x1;
+    }
+  return 1;
+}
+
+//gets the residual of a data point from the model with the given coefficients
+long double ransacResidual(const parameters * p, const data * d, int i, const long double * a)
+{
+  if(p->model->numCoeff==3)
+    return d->x[1][i] - (a[0]*d->x[0][i]*d->x[0][i] + a[1]*d->x[0][i] + a[2]);
+  else
+    return d->x[1][i] - (a[0]*d->x[0][i] + a[1]);
+}
+
+//scores a RANSAC hypothesis over a batch of data points, given the model
+//values at the points, without branching so that the compiler can vectorize
+//it (see SIMD_CLONES in gridlock.h)
+//returns the number of data points within the threshold of the model
+//(inliers), and adds the sum of their squared residuals to cost
+SIMD_CLONES int ransacScoreBatch(const double * restrict y, const double * restrict f, int n, double threshold, double * cost)
+{
+  int i;
+  int k=0;
+  double diff,c=0.;
+  for(i=0;i<n;i++)
+    {
+      diff=y[i] - f[i];
+      k+=(fabs(diff)<=threshold);
+      c+=(fabs(diff)<=threshold) ? diff*diff : 0.;
+    }
+  *cost+=c;
+  return k;
+}
+
+//evaluates a range of RANSAC hypotheses, keeping the best of them
+//for each hypothesis, the model passing through a randomly drawn minimal
+//subset of data points is determined, and the number of data points within
+//ransacThreshold of the model (inliers) is counted, evaluating the model
+//over batches of data points with the batch evaluator of the fit model
+//(see fit_eval_batch.c)
+//ties in the number of inliers are broken by the sum of squared inlier
+//residuals, and then by the hypothesis number (the lowest is kept)
+void * ransacThread(void * arg)
+{
+  int i,j,k,n,num;
+  int ind[3];
+  long double a[3];
+  double cost;
+  double f[RANSAC_BATCH_SIZE];
+  const double *col[1];
+  unsigned long long state;
+  ransac_thread_data *t=(ransac_thread_data*)arg;
+  const parameters *p=t->p;
+  const data *d=t->d;
+  int numSubset=p->model->numCoeff;
+  double threshold=(double)p->ransacThreshold;
+  fit_results *fr=(fit_results*)calloc(1,sizeof(fit_results));//holds the coefficients of each hypothesis
+
+  t->bestInliers=0;
+  t->bestCost=0.;
+  t->numDegenerate=0;
+  for(n=t->start;n<t->end;n++)//loop over hypotheses
+    {
+      //draw a minimal subset of distinct data points
+      state=RANSAC_SEED + (unsigned long long)n*0xD1B54A32D192ED03ULL;
+      for(j=0;j<numSubset;j++)
+        {
+          ind[j]=(int)(ransacRand(&state)%(unsigned long long)d->lines);
+          for(k=0;k<j;k++)
+            if(ind[k]==ind[j])
+              {
+                ind[j]=(int)(ransacRand(&state)%(unsigned long long)d->lines);
+                k=-1;//redraw until distinct
+              }
+        }
+      if(ransacModel(p,d,ind,a)==0)
+        {
+          t->numDegenerate++;
+          continue;
+        }
+
+      //score the hypothesis
+      for(j=0;j<numSubset;j++)
+        fr->a[j]=a[j];
+      k=0;
+      cost=0.;
+      for(i=0;i<d->lines;i+=RANSAC_BATCH_SIZE)
+        {
+          num=(d->lines-i < RANSAC_BATCH_SIZE) ? d->lines-i : RANSAC_BATCH_SIZE;
+          col[0]=t->xd+i;
+          p->model->evalBatchDouble(p,fr,col,num,f);
+          k+=ransacScoreBatch(t->yd+i,f,num,threshold,&cost);
+        }
+      if((k>t->bestInliers)||((k==t->bestInliers)&&(cost<t->bestCost)))
+        {
+          t->bestInliers=k;
+          t->bestCost=cost;
+          for(j=0;j<numSubset;j++)
+            t->bestA[j]=a[j];
+        }
+    }
+  free(fr);
+  return NULL;
+}
+
+//filters outlier data using random sample consensus (RANSAC)
+//hypotheses (see ransacThread) are split into consecutive ranges evaluated
+//in parallel threads, and the best hypothesis of each range is merged in
+//order, so that the result is the same for any number of threads
+//the data is then reduced in place to the inliers of the best hypothesis
+//(the consensus set), which is refit as normal
+//see M. Fischler, R. Bolles, Commun. ACM 24 (1981) 381
+void ransac(data * d, parameters * p)
+{
+  int i,j,k;
+  long double bestA[3];
+
+  if(p->numVar>1)
+    {
+      printf("ERROR: Cannot apply RANSAC to data with more than one variable.\n");
+      exit(-1);
+    }
+
+  int numSubset=p->model->numCoeff;//number of data points needed to determine the model
+  if(d->lines<=numSubset)
+    {
+      printf("ERROR: not enough data points for RANSAC (need more than %i).\n",numSubset);
+      exit(-1);
+    }
+
+  //number of threads, limited so that each has enough work to be worth starting
+  //(see threads.c)
+  int numThreads=getNumThreads((long long)d->lines*p->ransacIter,RANSAC_MIN_WORK);
+  if(numThreads>p->ransacIter)
+    numThreads=p->ransacIter;
+
+  //data point values in double precision, for scoring hypotheses
+  double *xd=(double*)malloc(d->lines*sizeof(double));
+  double *yd=(double*)malloc(d->lines*sizeof(double));
+  if((xd==NULL)||(yd==NULL))
+    {
+      printf("ERROR: could not allocate memory for RANSAC.\n");
+      exit(-1);
+    }
+  for(i=0;i<d->lines;i++)
+    {
+      xd[i]=(double)d->x[0][i];
+      yd[i]=(double)d->x[1][i];
+    }
+
+  ransac_thread_data t[MAX_THREADS];
+  for(i=0;i<numThreads;i++)
+    {
+      t[i].p=p;
+      t[i].d=d;
+      t[i].xd=xd;
+      t[i].yd=yd;
+      t[i].start=getThreadRangeStart(p->ransacIter,i,numThreads);
+      t[i].end=getThreadRangeStart(p->ransacIter,i+1,numThreads);
+    }
+  runThreads(ransacThread,t,sizeof(ransac_thread_data),numThreads);
+  free(xd);
+  free(yd);
+
+  //merge the best hypotheses of each range, in order
+  int bestInliers=0;
+  double bestCost=0.;
+  int numDegenerate=0;
+  for(i=0;i<numThreads;i++)
+    {
+      numDegenerate+=t[i].numDegenerate;
+      if((t[i].bestInliers>bestInliers)||((t[i].bestInliers==bestInliers)&&(bestInliers>0)&&(t[i].bestCost<bestCost)))
+        {
+          bestInliers=t[i].bestInliers;
+          bestCost=t[i].bestCost;
+          for(j=0;j<numSubset;j++)
+            bestA[j]=t[i].bestA[j];
+        }
+    }
+
+  if(bestInliers<=numSubset)
+    {
+      printf("ERROR: RANSAC could not find a consensus set larger than the minimal subset.\nTry increasing the number of iterations or the threshold value.\n");
+      exit(-1);
+    }
+
+  //reduce the data to the consensus set, compacting in place
+  int initLines=d->lines;
+  j=0;
+  for(i=0;i<d->lines;i++)
+    if(fabsl(ransacResidual(p,d,i,bestA))<=p->ransacThreshold)
+      {
+        if(j!=i)
+          for(k=0;k<=p->numVar+1;k++)
+            d->x[k][j]=d->x[k][i];
+        j++;
+      }
+  d->lines=j;
+  getDataRange(d,p); //see import_data.c
+
+  if(p->verbose<1)
+    {
+      printf("Applying RANSAC to data (%i iterations, threshold %0.3LE).\n",p->ransacIter,p->ransacThreshold);
+      if(numDegenerate>0)
+        printf("%i degenerate subset(s) skipped.\n",numDegenerate);
+      printf("RANSAC: %i of %i data point(s) in the consensus set.\n",d->lines,initLines);
+    }
+}
@@ -0,0 +1,207 @@
+//forward declarations
+void fitData(parameters *, data *, fit_results *, plot_data *, int);
+
+//filters outlier data by refitting
+//after each fit, data points too far from the fit function are rejected: those 
+//a distance greater than refitFilterDist away (REFIT_FILTER option), and/or those 
+//with a normalized residual greater than refitClipSigma times the RMS normalized 
+//residual of the fit (REFIT_CLIP option)
+//every data point (including those rejected earlier) is re-tested against each 
+//new fit, so that points can be restored as well as rejected, and only the 
+//contributions of points which change state are subtracted from or added to the 
+//fit sums (rather than regenerating the sums)
+//the retained data is updated in place (rejected points are replaced by the 
+//last retained point, restored points are appended) and refit, until no data 
+//point changes state or the maximum number of iterations is reached (a single 
+//iteration if only REFIT_FILTER is used), after which the retained data is put 
+//back in its original order
+void refitClip(parameters * p, data * d, fit_results * fr, plot_data * pd)
+{
+  int i,j,k,l;
+  long double diff,pull,rms;
+  unsigned int reject;
+  
+  int maxIter=1;
+  if(p->refitClip==1)
+    maxIter=p->refitClipMaxIter;
+  
+  //parameters used when fitting in between iterations (no printing or plotting)
+  parameters *np=(parameters*)calloc(1,sizeof(parameters));
+  memcpy(np,p,sizeof(parameters));
+  np->plotData=0;
+  np->verbose=1;
+  
+  //copy of the full data, which every data point is re-tested from
+  int initLines=d->lines;
+  long double *orig[POWSIZE];
+  const long double *col[POWSIZE];
+  for(k=0;k<=p->numVar+1;k++)
+    {
+      if((orig[k]=(long double*)malloc(((initLines>0) ? initLines : 1)*sizeof(long double)))==NULL)
+        {
+          printf("ERROR: could not allocate memory for refit filtering.\n");
+          exit(-1);
+        }
+      memcpy(orig[k],d->x[k],initLines*sizeof(long double));
+      col[k]=orig[k];
+    }
+  double *origWt=NULL;
+  if(d->robustWt!=NULL)
+    {
+      //robust weights (see robust_fit.c) follow their data points
+      if((origWt=(double*)malloc(((initLines>0) ? initLines : 1)*sizeof(double)))==NULL)
+        {
+          printf("ERROR: could not allocate memory for refit filtering.\n");
+          exit(-1);
+        }
+      memcpy(origWt,d->robustWt,initLines*sizeof(double));
+    }
+  //bitmask flagging the rejected data points, kept between iterations
+  unsigned int *rejected=(unsigned int*)calloc((initLines/32)+1,sizeof(unsigned int));
+  //position of each retained data point in the compacted data, and the data 
+  //point at each position
+  int *pos=(int*)malloc(((initLines>0) ? initLines : 1)*sizeof(int));
+  int *slot=(int*)malloc(((initLines>0) ? initLines : 1)*sizeof(int));
+  for(i=0;i<initLines;i++)
+    {
+      pos[i]=i;
+      slot[i]=i;
+    }
+  //data points restored in an iteration
+  int *restored=(int*)malloc(((initLines>0) ? initLines : 1)*sizeof(int));
+  //fit function values at each data point
+  long double *fitVal=(long double*)malloc(((initLines>0) ? initLines : 1)*sizeof(long double));
+  
+  int numChanged=1;
+  int numRestored;
+  int iter=0;
+  int anyChanged=0;
+  int noNdf=0;
+  while((iter<maxIter)&&(numChanged>0))
+    {
+      fitData(np,d,fr,pd,0);
+      p->model->evalBatch(p,fr,col,initLines,fitVal); //see fit_eval_batch.c
+      
+      //get the RMS of the normalized residuals of the retained data for the current fit
+      rms=0.;
+      if(p->refitClip==1)
+        {
+          if(fr->ndf<=0)
+            {
+              noNdf=1;//no degrees of freedom, can't determine a rejection threshold
+              break;
+            }
+          for(i=0;i<initLines;i++)
+            if(!(rejected[i/32]&(1U<<(i%32))))
+              {
+                pull=(orig[p->numVar][i] - fitVal[i])/orig[p->numVar+1][i];
+                rms+=pull*pull;
+              }
+          rms=sqrtl(rms/fr->ndf);
+        }
+      
+      //re-test every data point, removing newly rejected points from the sums 
+      //and the compacted data
+      numChanged=0;
+      numRestored=0;
+      for(i=0;i<initLines;i++)
+        {
+          diff=orig[p->numVar][i] - fitVal[i];
+          pull=diff/orig[p->numVar+1][i];
+          reject=( ((p->refitFilter==1)&&(fabsl(diff)>p->refitFilterDist)) || ((p->refitClip==1)&&(fabsl(pull)>p->refitClipSigma*rms)) );
+          if(reject==((rejected[i/32]>>(i%32))&1U))
+            continue;//no change of state
+          rejected[i/32]^=(1U<<(i%32));
+          numChanged++;
+          if(reject)
+            {
+              j=pos[i];
+              addPointToSums(d,p,j,-1);
+              d->lines--;
+              if(j!=d->lines)
+                {
+                  //move the last retained data point into its place
+                  l=slot[d->lines];
+                  for(k=0;k<=p->numVar+1;k++)
+                    d->x[k][j]=d->x[k][d->lines];
+                  if(origWt!=NULL)
+                    d->robustWt[j]=d->robustWt[d->lines];
+                  pos[l]=j;
+                  slot[j]=l;
+                }
+            }
+          else
+            restored[numRestored++]=i;
+        }
+      
+      //append the restored data points, adding their contributions to the sums
+      for(l=0;l<numRestored;l++)
+        {
+          i=restored[l];
+          j=d->lines++;
+          for(k=0;k<=p->numVar+1;k++)
+            d->x[k][j]=orig[k][i];
+          if(origWt!=NULL)
+            d->robustWt[j]=origWt[i];
+          pos[i]=j;
+          slot[j]=i;
+          addPointToSums(d,p,j,1);
+        }
+      if(numChanged>0)
+        anyChanged=1;
+      
+      iter++;
+      if((p->refitClip==1)&&(p->verbose<1))
+        printf("Refit clip iteration %i: %i data point(s) rejected, %i restored (RMS normalized residual: %0.3LE).\n",iter,numChanged-numRestored,numRestored,rms);
+    }
+
+  if(p->verbose<1)
+    {
+      if(p->refitClip==1)
+        {
+          printf("\nRefit clip: %i of %i data point(s) retained.\n",d->lines,initLines);
+          if(noNdf==1)
+            printf("WARNING: no degrees of freedom left in the fit, refit clipping stopped after %i iteration(s).\n",iter);
+          else if(numChanged>0)
+            printf("WARNING: rejected data points did not converge within the maximum number of iterations (%i).\n",maxIter);
+        }
+      else
+        printf("\nRefit filter: %i of %i data point(s) retained.\n",d->lines,initLines);
+    }
+  
+  //put the retained data back in its original order
+  if(anyChanged==1)
+    {
+      j=0;
+      for(i=0;i<initLines;i++)
+        if(!(rejected[i/32]&(1U<<(i%32))))
+          {
+            for(k=0;k<=p->numVar+1;k++)
+              d->x[k][j]=orig[k][i];
+            if(origWt!=NULL)
+              d->robustWt[j]=origWt[i];
+            j++;
+          }
+    }
+  
+  for(k=0;k<=p->numVar+1;k++)
+    free(orig[k]);
+  free(origWt);
+  free(rejected);
+  free(pos);
+  free(slot);
+  free(restored);
+  free(fitVal);
+  free(np);
+  
+  //the range of the retained data is used for confidence intervals and plotting
+  if(d->lines<initLines)
+    getDataRange(d,p); //see import_data.c
+  
+  //rebuild the index of the data for plotting, if points were removed (see grid_index.c)
+  if((d->lines<initLines)&&(p->plotData==1)&&(p->verbose<1))
+    buildGridIndex(d,p,&d->index);
+  
+  //final fit to the retained data
+  fitData(p,d,fr,pd,1);
+}
@@ -0,0 +1,211 @@
+//gets the partial sums of the residuals of a range of batches of data points
+//(run in parallel threads)
+void * residualThread(void * arg)
+{
+  int i,j,k,n,bin,start,b;
+  residual_thread_data *t=(residual_thread_data*)arg;
+  const parameters *p=t->p;
+  const data *d=t->d;
+  residual_batch_type *rb;
+  long double f[RESIDUAL_BATCH_SIZE];
+  const long double *col[POWSIZE];
+  long double res,pull;
+  double *buf=NULL;
+  int numCol=p->numVar+4;
+
+  if((t->out!=NULL)&&(p->residualFileFormat==1))
+    buf=(double*)malloc(RESIDUAL_BATCH_SIZE*numCol*sizeof(double));
+
+  for(b=t->start;b<t->end;b++)
+    {
+      rb=&t->batch[b];
+      memset(rb,0,sizeof(residual_batch_type));
+      rb->maxPull=-1.;
+      rb->maxPullInd=-1;
+      start=b*RESIDUAL_BATCH_SIZE;
+      n=d->lines - start;
+      if(n>RESIDUAL_BATCH_SIZE)
+        n=RESIDUAL_BATCH_SIZE;
+      for(k=0;k<p->numVar;k++)
+        col[k]=d->x[k]+start;
+      p->model->evalBatch(p,t->fr,col,n,f);
+
+      for(i=0;i<n;i++)
+        {
+          j=start+i;
+          res=d->x[p->numVar][j] - f[i];
+          pull=res/d->x[p->numVar+1][j];
+          if(d->robustWt!=NULL)
+            rb->chisq+=d->robustWt[j]*res*res/(d->x[p->numVar+1][j]*d->x[p->numVar+1][j]);
+          else
+            rb->chisq+=res*res/(d->x[p->numVar+1][j]*d->x[p->numVar+1][j]);
+          rb->sum+=res;
+          rb->sumSq+=res*res;
+          rb->sumPullSq+=pull*pull;
+          if(fabsl(pull)>rb->maxPull)
+            {
+              rb->maxPull=fabsl(pull);
+              rb->maxPullInd=j;
+            }
+          if(pull<-RESIDUAL_HIST_RANGE)
+            bin=0;
+          else if(pull>=RESIDUAL_HIST_RANGE)
+            bin=RESIDUAL_HIST_BINS+1;
+          else
+            bin=1+(int)((pull + RESIDUAL_HIST_RANGE)*RESIDUAL_HIST_BINS/(2.*RESIDUAL_HIST_RANGE));
+          if(bin>RESIDUAL_HIST_BINS)
+            bin=RESIDUAL_HIST_BINS;
+          rb->hist[bin]++;
+
+          if(buf!=NULL)
+            {
+              for(k=0;k<p->numVar;k++)
+                buf[i*numCol+k]=(double)d->x[k][j];
+              buf[i*numCol+p->numVar]=(double)d->x[p->numVar][j];
+              buf[i*numCol+p->numVar+1]=(double)f[i];
+              buf[i*numCol+p->numVar+2]=(double)res;
+              buf[i*numCol+p->numVar+3]=(double)pull;
+            }
+          else if(t->out!=NULL)
+            {
+              for(k=0;k<=p->numVar;k++)
+                fprintf(t->out,"%LE ",d->x[k][j]);
+              fprintf(t->out,"%LE %LE %LE\n",f[i],res,pull);
+            }
+        }
+      if(buf!=NULL)
+        fwrite(buf,sizeof(double),n*numCol,t->out);
+    }
+
+  if(buf!=NULL)
+    free(buf);
+  return NULL;
+}
+
+//gets the residuals of a fit at every data point, and their statistics
+//(chisq, mean, RMS, largest normalized residual, and a histogram of the
+//normalized residuals), in a single pass over the data
+//for a robust fit, chisq is weighted by the robust weights (see robust_fit.c),
+//while the other statistics use the data weights alone
+//the fit function is evaluated in batches (see fit_eval_batch.c), which are
+//split between parallel threads (see threads.c); the partial sums of each
+//batch are merged in order, so that the statistics don't depend on the
+//number of threads
+//if out is not NULL, each data point is also written to it, with the fit
+//value, residual, and normalized residual (text or binary, see
+//residualFileFormat), in which case a single thread is used
+void getResiduals(const parameters * p, const data * d, const fit_results * fr, residual_stats_type * rs, FILE * out)
+{
+  int i,b;
+  long double sum=0.;
+  long double sumSq=0.;
+  long double sumPullSq=0.;
+  int numBatch=(d->lines + RESIDUAL_BATCH_SIZE - 1)/RESIDUAL_BATCH_SIZE;
+
+  memset(rs,0,sizeof(residual_stats_type));
+  rs->maxPull=-1.;
+  rs->maxPullInd=-1;
+
+  residual_batch_type *batch=(residual_batch_type*)malloc(((numBatch>0) ? numBatch : 1)*sizeof(residual_batch_type));
+  if(batch==NULL)
+    {
+      printf("ERROR: could not allocate memory for the residuals of the fit.\n");
+      exit(-1);
+    }
+
+  //split the batches between threads (see threads.c)
+  int numThreads=1;
+  if(out==NULL)
+    numThreads=getNumThreads(d->lines,DATA_THREAD_MIN_POINTS);
+  if(numThreads>numBatch)
+    numThreads=(numBatch>0) ? numBatch : 1;
+  residual_thread_data t[MAX_THREADS];
+  for(i=0;i<numThreads;i++)
+    {
+      t[i].p=p;
+      t[i].d=d;
+      t[i].fr=fr;
+      t[i].start=getThreadRangeStart(numBatch,i,numThreads);
+      t[i].end=getThreadRangeStart(numBatch,i+1,numThreads);
+      t[i].batch=batch;
+      t[i].out=out;
+    }
+  runThreads(residualThread,t,sizeof(residual_thread_data),numThreads);
+
+  //merge the batches, in order
+  for(b=0;b<numBatch;b++)
+    {
+      rs->chisq+=batch[b].chisq;
+      sum+=batch[b].sum;
+      sumSq+=batch[b].sumSq;
+      sumPullSq+=batch[b].sumPullSq;
+      if(batch[b].maxPull>rs->maxPull)
+        {
+          rs->maxPull=batch[b].maxPull;
+          rs->maxPullInd=batch[b].maxPullInd;
+        }
+      for(i=0;i<RESIDUAL_HIST_BINS+2;i++)
+        rs->hist[i]+=batch[b].hist[i];
+    }
+  free(batch);
+
+  if(rs->maxPullInd<0)
+    rs->maxPull=0.;
+  if(d->lines>0)
+    {
+      rs->mean=sum/d->lines;
+      rs->rms=sqrtl(sumSq/d->lines);
+      rs->rmsPull=sqrtl(sumPullSq/d->lines);
+    }
+}
+
+//reports the residuals of the final fit (RESIDUALS option), writing the
+//per-point residuals to a file if requested
+void printResiduals(const parameters * p, const data * d, const fit_results * fr)
+{
+  int i,j;
+  residual_stats_type rs;
+
+  //open the output file, if requested
+  FILE *out=NULL;
+  if(strcmp(p->residualFile,"")!=0)
+    {
+      if((out=fopen(p->residualFile,(p->residualFileFormat==1) ? "wb" : "w"))==NULL)
+        {
+          printf("ERROR: residual output file %s can not be opened.\n",p->residualFile);
+          exit(-1);
+        }
+      if(p->residualFileFormat==0)
+        {
+          fprintf(out,"#");
+          for(j=0;j<p->numVar;j++)
+            fprintf(out," par%i",j+1);
+          fprintf(out," value fit residual pull\n");
+        }
+    }
+
+  getResiduals(p,d,fr,&rs,out);
+  if(out!=NULL)
+    fclose(out);
+
+  if(p->verbose>=1)
+    return;
+
+  printf("\nRESIDUALS\n---------\n");
+  printf("Mean residual: %0.3LE, RMS residual: %0.3LE\n",rs.mean,rs.rms);
+  printf("RMS normalized residual (pull): %0.3LE\n",rs.rmsPull);
+  if(rs.maxPullInd>=0)
+    {
+      printf("Largest |pull|: %0.3LE, value %0.3LE at [",rs.maxPull,d->x[p->numVar][rs.maxPullInd]);
+      for(j=0;j<p->numVar;j++)
+        printf(" %0.3LE ",d->x[j][rs.maxPullInd]);
+      printf("]\n");
+    }
+  printf("\nHistogram of pulls:\n");
+  printf("       < %5.2f : %i\n",-RESIDUAL_HIST_RANGE,rs.hist[0]);
+  for(i=1;i<=RESIDUAL_HIST_BINS;i++)
+    printf("[%5.2f, %5.2f) : %i\n",-RESIDUAL_HIST_RANGE + (i-1)*2.*RESIDUAL_HIST_RANGE/RESIDUAL_HIST_BINS,-RESIDUAL_HIST_RANGE + i*2.*RESIDUAL_HIST_RANGE/RESIDUAL_HIST_BINS,rs.hist[i]);
+  printf("      >= %5.2f : %i\n",RESIDUAL_HIST_RANGE,rs.hist[RESIDUAL_HIST_BINS+1]);
+  if(out!=NULL)
+    printf("\nPer-point residuals written to: %s (%s format)\n",p->residualFile,(p->residualFileFormat==1) ? "binary" : "text");
+}
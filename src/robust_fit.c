@@ -0,0 +1,262 @@
+//forward declarations
+void fitData(parameters *, data *, fit_results *, plot_data *, int);
+void refitClip(parameters *, data *, fit_results *, plot_data *);
+
+//finds the k-th smallest value in an array (quickselect)
+//the order of values in the array is modified
+long double selectVal(long double * arr, int n, int k)
+{
+  int i,j,l,r;
+  long double pivot,tmp;
+  l=0;
+  r=n-1;
+  while(l<r)
+    {
+      pivot=arr[(l+r)/2];
+      i=l;
+      j=r;
+      while(i<=j)
+        {
+          while(arr[i]<pivot)
+            i++;
+          while(arr[j]>pivot)
+            j--;
+          if(i<=j)
+            {
+              tmp=arr[i];
+              arr[i]=arr[j];
+              arr[j]=tmp;
+              i++;
+              j--;
+            }
+        }
+      if(k<=j)
+        r=j;
+      else if(k>=i)
+        l=i;
+      else
+        break;
+    }
+  return arr[k];
+}
+
+//gets the robust weights of a batch of data points from their residuals
+//(normalized by the robust scale estimate) using the specified M-estimator
+//the weight function is selected once for the batch and applied without
+//branching, so that the compiler can vectorize it (see SIMD_CLONES in
+//gridlock.h)
+SIMD_CLONES void getRobustWeights(const parameters * p, const double * restrict u, int n, double * restrict wt)
+{
+  int i;
+  double a,t;
+  double c=(double)p->robustConst;
+  if(p->robustFit==1)//Huber
+    for(i=0;i<n;i++)
+      {
+        a=fabs(u[i]);
+        wt[i]=(a<=c) ? 1. : c/a;
+      }
+  else if(p->robustFit==2)//Tukey bisquare
+    for(i=0;i<n;i++)
+      {
+        t=u[i]/c;
+        t=1. - t*t;
+        wt[i]=(t>0.) ? t*t : 0.;
+      }
+  else
+    for(i=0;i<n;i++)
+      wt[i]=1.;
+}
+
+//gets the normalized residuals of a range of data points from the current fit
+//(run in parallel threads, see threads.c)
+void * robustResidualThread(void * arg)
+{
+  int i,k;
+  robust_thread_data *t=(robust_thread_data*)arg;
+  const parameters *p=t->p;
+  const data *d=t->d;
+  const long double *col[POWSIZE];
+  for(k=0;k<p->numVar;k++)
+    col[k]=d->x[k]+t->start;
+  p->model->evalBatch(p,t->fr,col,t->end-t->start,t->res+t->start); //see fit_eval_batch.c
+  for(i=t->start;i<t->end;i++)
+    {
+      t->res[i]=(d->x[p->numVar][i] - t->res[i])/d->x[p->numVar+1][i];
+      t->absRes[i]=fabsl(t->res[i]);
+    }
+  return NULL;
+}
+
+//gets the robust weights of a range of data points from their normalized
+//residuals and the robust scale estimate (run in parallel threads)
+void * robustWeightThread(void * arg)
+{
+  int i;
+  robust_thread_data *t=(robust_thread_data*)arg;
+  const parameters *p=t->p;
+  for(i=t->start;i<t->end;i++)
+    t->u[i]=(double)(t->res[i]/t->scale);
+  getRobustWeights(p,t->u+t->start,t->end-t->start,t->wt+t->start);
+  t->numDownweighted=0;
+  t->numRejected=0;
+  for(i=t->start;i<t->end;i++)
+    {
+      t->numDownweighted+=(fabs(t->u[i])>(double)p->robustConst);
+      t->numRejected+=(t->wt[i]<=0.);
+    }
+  return NULL;
+}
+
+//fits data using iteratively reweighted least squares (IRLS), which reduces
+//the influence of outliers on the fit
+//each iteration, data weights are set from the residuals of the previous fit
+//(normalized by a robust scale estimate from the median absolute deviation),
+//and the data is refit using the weighted sums from generateSums
+//the residuals and weights are found in parallel threads over ranges of the
+//data points (see threads.c)
+//the robust weights are kept apart from the data weights (d->robustWt), and
+//only enter the fit sums and chisq, so the reported chisq and uncertainties
+//are robust-weighted while other diagnostics (residuals, jackknife, refit
+//clipping) use the data weights
+//see P. Huber 'Robust Statistics' ch. 7
+void robustFit(parameters * p, data * d, fit_results * fr, plot_data * pd)
+{
+  int i,j;
+  long double x[POWSIZE],basis[MAX_DIM];
+  long double aPrev[MAX_DIM];
+  long double scale,change;
+  int numDownweighted,numRejected;//number of data points beyond the tuning constant, number with zero weight
+  int maxIter=50;
+  long double tolerance=1.0E-10;
+
+  getDataPoint(d,p,0,x);
+  int numFitPar=getFitBasis(p,x,basis);
+
+  //parameters used when fitting in between iterations (no printing or plotting)
+  parameters *np=(parameters*)calloc(1,sizeof(parameters));
+  memcpy(np,p,sizeof(parameters));
+  np->plotData=0;
+  np->verbose=1;
+
+  //residuals and robust weights of the data points (no robust weights are used
+  //in the initial fit)
+  long double *res=(long double*)calloc(d->lines,sizeof(long double));
+  long double *absRes=(long double*)calloc(d->lines,sizeof(long double));
+  double *u=(double*)calloc(d->lines,sizeof(double));
+  free(d->robustWt);
+  d->robustWt=NULL;
+  double *wt=(double*)malloc(((d->lines>0) ? d->lines : 1)*sizeof(double));
+  if((res==NULL)||(absRes==NULL)||(u==NULL)||(wt==NULL))
+    {
+      printf("ERROR: could not allocate memory for robust fitting.\n");
+      exit(-1);
+    }
+
+  if(p->verbose<1)
+    {
+      if(p->robustFit==1)
+        printf("\nRobust fit using Huber weights, c = %0.3LE.\n",p->robustConst);
+      else
+        printf("\nRobust fit using Tukey bisquare weights, c = %0.3LE.\n",p->robustConst);
+    }
+
+  //ranges of data points handled by each thread
+  int numThreads=getNumThreads(d->lines,DATA_THREAD_MIN_POINTS); //see threads.c
+  robust_thread_data t[MAX_THREADS];
+  for(i=0;i<numThreads;i++)
+    {
+      t[i].p=p;
+      t[i].d=d;
+      t[i].fr=fr;
+      t[i].start=getThreadRangeStart(d->lines,i,numThreads);
+      t[i].end=getThreadRangeStart(d->lines,i+1,numThreads);
+      t[i].res=res;
+      t[i].absRes=absRes;
+      t[i].u=u;
+      t[i].wt=wt;
+    }
+
+  //initial (non-robust) fit
+  fitData(np,d,fr,pd,0);
+
+  int converged=0;
+  int iter=0;
+  while((iter<maxIter)&&(converged==0))
+    {
+      if(d->lines<1)
+        {
+          converged=1;//no data to reweight
+          break;
+        }
+
+      //get normalized residuals and robust scale estimate
+      runThreads(robustResidualThread,t,sizeof(robust_thread_data),numThreads);
+      scale=1.4826*selectVal(absRes,d->lines,d->lines/2);
+      if(scale<=0.)
+        {
+          //residuals are (mostly) zero, fit can't be improved
+          converged=1;
+          break;
+        }
+
+      //reweight the data
+      for(i=0;i<numThreads;i++)
+        t[i].scale=scale;
+      runThreads(robustWeightThread,t,sizeof(robust_thread_data),numThreads);
+      d->robustWt=wt;
+      numDownweighted=0;
+      numRejected=0;
+      for(i=0;i<numThreads;i++)
+        {
+          numDownweighted+=t[i].numDownweighted;
+          numRejected+=t[i].numRejected;
+        }
+
+      //refit with the new weights
+      for(j=0;j<numFitPar;j++)
+        aPrev[j]=fr->a[j];
+      generateSums(d,p);
+      fitData(np,d,fr,pd,0);
+      iter++;
+
+      //check convergence of the fit coefficients
+      change=0.;
+      for(j=0;j<numFitPar;j++)
+        if(fabsl(fr->a[j]-aPrev[j])/(fabsl(aPrev[j])+tolerance) > change)
+          change=fabsl(fr->a[j]-aPrev[j])/(fabsl(aPrev[j])+tolerance);
+      if(change<tolerance)
+        converged=1;
+
+      if(p->verbose<1)
+        {
+          if(p->robustFit==2)
+            printf("Robust fit iteration %i: scale %0.3LE, %i data point(s) with zero weight, max relative change in coefficients %0.3LE.\n",iter,scale,numRejected,change);
+          else
+            printf("Robust fit iteration %i: scale %0.3LE, %i data point(s) downweighted, max relative change in coefficients %0.3LE.\n",iter,scale,numDownweighted,change);
+        }
+    }
+
+  if(p->verbose<1)
+    {
+      if(converged==1)
+        printf("Robust fit converged after %i iteration(s).\n",iter);
+      else
+        printf("WARNING: robust fit did not converge within the maximum number of iterations (%i).\n",maxIter);
+    }
+
+  free(res);
+  free(absRes);
+  free(u);
+  free(np);
+  if(d->robustWt==NULL)
+    free(wt);//no reweighting was done
+  else if(p->verbose<1)
+    printf("Reported chisq and fit parameter uncertainties are weighted by the final robust weights.\n");
+
+  //final fit using the robust weights
+  if((p->refitFilter==1)||(p->refitClip==1))
+    refitClip(p,d,fr,pd);
+  else
+    fitData(p,d,fr,pd,1);
+}
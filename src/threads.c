@@ -0,0 +1,44 @@
+//helpers for splitting work between parallel (POSIX) threads
+//work is split into consecutive ranges, one per thread, and the results of
+//the ranges are merged by the caller in order, so that results don't depend
+//on how many threads are used
+
+//gets the number of threads to split an amount of work between, limited by
+//the number of CPUs and so that each thread has at least minWork to do
+int getNumThreads(long long work, long long minWork)
+{
+  long numCPU=sysconf(_SC_NPROCESSORS_ONLN);
+  int numThreads=(numCPU>0) ? (int)numCPU : 1;
+  if(numThreads>MAX_THREADS)
+    numThreads=MAX_THREADS;
+  if(work/minWork < numThreads)
+    numThreads=(int)(work/minWork);
+  if(numThreads<1)
+    numThreads=1;
+  return numThreads;
+}
+
+//gets the start of the i-th of numThreads consecutive ranges splitting n items
+//(the range ends at the start of the next one)
+int getThreadRangeStart(int n, int i, int numThreads)
+{
+  return (int)(((long long)n*i)/numThreads);
+}
+
+//runs func once for each of numThreads arguments in parallel, returning when
+//all of them are done (the first is run in the calling thread)
+//args: array of arguments, each of size bytes
+void runThreads(void * (*func)(void *), void * args, size_t size, int numThreads)
+{
+  int i;
+  pthread_t thread[MAX_THREADS];
+  for(i=1;i<numThreads;i++)
+    if(pthread_create(&thread[i],NULL,func,(char*)args + i*size)!=0)
+      {
+        printf("ERROR: could not start thread.\n");
+        exit(-1);
+      }
+  func(args);
+  for(i=1;i<numThreads;i++)
+    pthread_join(thread[i],NULL);
+}